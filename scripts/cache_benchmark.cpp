@@ -0,0 +1,280 @@
+// cache_benchmark.cpp
+// Microbenchmark for the A server's in-memory Cache at different sizes:
+// hits, misses, updates and evicting inserts. The original implementation
+// (expiry walk of the whole map plus std::list::remove on every call, and a
+// deep copy of the response on every hit) is timed next to it for the
+// sizes where filling it finishes in reasonable time. A second table
+// compares the cost of replying from a hit by response size, and a third
+// the hit ratio of the entry-limited LRU and the byte-budgeted W-TinyLFU
+// cache on skewed query streams with and without one-off scan queries.
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <list>
+#include <unordered_map>
+#include <streambuf>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+#include "movie.grpc.pb.h"
+#include "server/cache.h"
+
+// The cache as it used to be: every call walks the map for expired entries
+// and moves keys in the LRU list with a linear remove
+class LegacyCache {
+public:
+    LegacyCache(int ttl_seconds, size_t max_size) : ttl_(std::chrono::seconds(ttl_seconds)), max_size_(max_size) {}
+
+    bool get(const std::string& query, movie::SearchResponse& response) {
+        clean_expired();
+        auto it = cache_.find(query);
+        if (it == cache_.end()) return false;
+        lru_list_.remove(query);
+        lru_list_.push_front(query);
+        response = *(it->second.response);
+        return true;
+    }
+
+    void put(const std::string& query, const movie::SearchResponse& response) {
+        clean_expired();
+        auto it = cache_.find(query);
+        if (it != cache_.end()) {
+            it->second.timestamp = std::chrono::system_clock::now();
+            it->second.response = std::make_shared<movie::SearchResponse>(response);
+            lru_list_.remove(query);
+            lru_list_.push_front(query);
+            return;
+        }
+        if (cache_.size() >= max_size_ && !lru_list_.empty()) {
+            cache_.erase(lru_list_.back());
+            lru_list_.pop_back();
+        }
+        cache_[query] = Entry{std::chrono::system_clock::now(), std::make_shared<movie::SearchResponse>(response)};
+        lru_list_.push_front(query);
+    }
+
+private:
+    struct Entry {
+        std::chrono::system_clock::time_point timestamp;
+        std::shared_ptr<movie::SearchResponse> response;
+    };
+
+    void clean_expired() {
+        auto now = std::chrono::system_clock::now();
+        for (auto it = cache_.begin(); it != cache_.end();) {
+            if (now - it->second.timestamp > ttl_) {
+                lru_list_.remove(it->first);
+                it = cache_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    std::unordered_map<std::string, Entry> cache_;
+    std::list<std::string> lru_list_;
+    std::chrono::seconds ttl_;
+    size_t max_size_;
+};
+
+// A hit: the current cache hands out the shared serialized response, the
+// legacy one copies the message
+static bool lookup(Cache& cache, const std::string& key, movie::SearchResponse&) {
+    return cache.get(key) != nullptr;
+}
+
+static bool lookup(LegacyCache& cache, const std::string& key, movie::SearchResponse& result) {
+    return cache.get(key, result);
+}
+
+// Swallows the cache's eviction log while timing
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+};
+
+struct CacheTimes {
+    double hit_ns = 0;
+    double miss_ns = 0;
+    double update_ns = 0;
+    double evict_ns = 0;
+};
+
+// Run `ops` operations and return the average time in nanoseconds
+template <typename OpFn>
+static double timeOps(size_t ops, OpFn op) {
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < ops; i++) {
+        op(i);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / ops;
+}
+
+// Fill a cache with `entries` keys, then time each kind of operation
+template <typename CacheType>
+static CacheTimes benchmarkCache(size_t entries, size_t ops, const movie::SearchResponse& response) {
+    std::vector<std::string> keys(entries * 2);
+    for (size_t i = 0; i < keys.size(); i++) {
+        keys[i] = "query " + std::to_string(i);
+    }
+
+    CacheType cache(3600, entries);
+    for (size_t i = 0; i < entries; i++) {
+        cache.put(keys[i], response);
+    }
+
+    // Pseudo-random resident keys, so hits don't walk the list in order
+    uint64_t state = 88172645463325252ULL;
+    auto nextResident = [&]() {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state % entries;
+    };
+
+    CacheTimes times;
+    movie::SearchResponse result;
+    times.hit_ns = timeOps(ops, [&](size_t) { lookup(cache, keys[nextResident()], result); });
+    times.miss_ns = timeOps(ops, [&](size_t i) { lookup(cache, keys[entries + i % entries], result); });
+    times.update_ns = timeOps(ops, [&](size_t) { cache.put(keys[nextResident()], response); });
+
+    NullBuffer null;
+    std::streambuf* saved = std::cout.rdbuf(&null);
+    times.evict_ns = timeOps(std::min(ops, entries), [&](size_t i) { cache.put(keys[entries + i], response); });
+    std::cout.rdbuf(saved);
+    return times;
+}
+
+static void printRow(const std::string& name, size_t entries, const CacheTimes& times) {
+    std::cout << std::left << std::setw(10) << name << std::setw(10) << entries
+              << std::fixed << std::setprecision(1)
+              << std::setw(14) << times.hit_ns << std::setw(14) << times.miss_ns
+              << std::setw(14) << times.update_ns << std::setw(14) << times.evict_ns
+              << std::setprecision(2) << (times.hit_ns > 0 ? 1e3 / times.hit_ns : 0.0) << std::endl;
+}
+
+// Replay a query stream the way server A does (get, then put on a miss)
+// and return the hit ratio. Every `scan_every`-th request is a query that
+// is never repeated (0 = no scans).
+static double replayHitRatio(Cache& cache, size_t requests, size_t keys, double skew, size_t scan_every,
+                             const movie::SearchResponse& response) {
+    // Zipf distribution over `keys` popular queries
+    std::vector<double> cdf(keys);
+    double sum = 0;
+    for (size_t i = 0; i < keys; i++) {
+        sum += 1.0 / std::pow(static_cast<double>(i + 1), skew);
+        cdf[i] = sum;
+    }
+
+    uint64_t state = 88172645463325252ULL;
+    auto next = [&]() {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    };
+
+    NullBuffer null;
+    std::streambuf* saved = std::cout.rdbuf(&null);
+    CachedResponsePtr payload = std::make_shared<const CachedResponse>(response);
+    uint64_t hits = 0;
+    for (size_t i = 0; i < requests; i++) {
+        std::string query;
+        if (scan_every > 0 && i % scan_every == 0) {
+            query = "scan " + std::to_string(i);
+        } else {
+            double u = (next() >> 11) * (sum / 9007199254740992.0);
+            query = "query " + std::to_string(std::lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin());
+        }
+        if (cache.get(query)) {
+            hits++;
+        } else {
+            cache.put(query, payload);
+        }
+    }
+    std::cout.rdbuf(saved);
+    return static_cast<double>(hits) / requests;
+}
+
+int main(int argc, char** argv) {
+    size_t ops = (argc >= 2) ? std::stoul(argv[1]) : 100000;
+    size_t legacy_limit = (argc >= 3) ? std::stoul(argv[2]) : 10000;
+
+    movie::SearchResponse response;
+    movie::MovieInfo* movie = response.add_results();
+    movie->set_title("The Matrix");
+    movie->set_director("Village Roadshow Pictures, Groucho II Film Partnership");
+    movie->set_genre("Action, Science Fiction");
+    movie->set_year(1999);
+
+    std::cout << "\n====== Cache Benchmark (" << ops << " operations per column, ns/op) ======\n" << std::endl;
+    std::cout << std::left << std::setw(10) << "Cache" << std::setw(10) << "Entries"
+              << std::setw(14) << "Hit" << std::setw(14) << "Miss"
+              << std::setw(14) << "Update" << std::setw(14) << "Evict" << "Mhits/sec" << std::endl;
+    std::cout << std::string(88, '-') << std::endl;
+
+    for (size_t entries : {size_t(100), size_t(10000), size_t(1000000)}) {
+        printRow("O(1) LRU", entries, benchmarkCache<Cache>(entries, ops, response));
+        if (entries <= legacy_limit) {
+            // Every legacy call is O(entries), so time fewer of them
+            printRow("Legacy", entries, benchmarkCache<LegacyCache>(entries, std::max<size_t>(1, ops / entries), response));
+        }
+    }
+
+    // Replying from a hit: the old typed handler copied the cached message
+    // and gRPC serialized the copy; now the cached bytes are referenced
+    std::cout << "\n====== Cache Hit Reply Cost by Response Size (ns/hit) ======\n" << std::endl;
+    std::cout << std::left << std::setw(10) << "Results" << std::setw(12) << "Bytes"
+              << std::setw(20) << "Copy+serialize" << std::setw(16) << "Shared bytes" << "Speedup" << std::endl;
+    std::cout << std::string(66, '-') << std::endl;
+
+    for (int results : {1, 100, 1000, 10000}) {
+        movie::SearchResponse large;
+        for (int i = 0; i < results; i++) {
+            *large.add_results() = *movie;
+        }
+        auto message = std::make_shared<movie::SearchResponse>(large);
+        Cache cache(3600, 10);
+        cache.put("action", large);
+
+        size_t reply_ops = std::max<size_t>(10, ops / results);
+        double copy_ns = timeOps(reply_ops, [&](size_t) {
+            movie::SearchResponse reply = *message;
+            std::string wire = reply.SerializeAsString();
+        });
+        double shared_ns = timeOps(reply_ops, [&](size_t) {
+            CachedResponsePtr cached = cache.get("action");
+            grpc::ByteBuffer reply = cached->buffer();
+        });
+
+        std::cout << std::left << std::setw(10) << results << std::setw(12) << cache.get("action")->size()
+                  << std::fixed << std::setprecision(1) << std::setw(20) << copy_ns << std::setw(16) << shared_ns
+                  << std::setprecision(2) << (shared_ns > 0 ? copy_ns / shared_ns : 0.0) << "x" << std::endl;
+    }
+
+    // Hit ratio with the same memory: an LRU of `capacity` entries against
+    // a byte budget that holds `capacity` entries, on 100x as many queries
+    size_t capacity = 1000;
+    size_t requests = std::max<size_t>(ops * 5, 100000);
+    size_t entry_bytes = std::string("query 00000").size() + response.ByteSizeLong();
+    std::cout << "\n====== Cache Hit Ratio (" << capacity << " entries of memory, " << 100 * capacity
+              << " queries, " << requests << " requests) ======\n" << std::endl;
+    std::cout << std::left << std::setw(26) << "Workload" << std::setw(14) << "LRU (%)"
+              << "W-TinyLFU (%)" << std::endl;
+    std::cout << std::string(58, '-') << std::endl;
+
+    struct Workload { const char* name; double skew; size_t scan_every; };
+    for (const Workload& workload : {Workload{"Zipf 0.9", 0.9, 0}, Workload{"Zipf 0.9 + 1/4 scans", 0.9, 4},
+                                     Workload{"Zipf 0.7", 0.7, 0}, Workload{"Zipf 0.7 + 1/4 scans", 0.7, 4}}) {
+        Cache lru(3600, capacity);
+        Cache tinylfu(3600, 2 * capacity, capacity * entry_bytes);
+        double lru_ratio = replayHitRatio(lru, requests, 100 * capacity, workload.skew, workload.scan_every, response);
+        double tinylfu_ratio = replayHitRatio(tinylfu, requests, 100 * capacity, workload.skew, workload.scan_every, response);
+        std::cout << std::left << std::setw(26) << workload.name << std::fixed << std::setprecision(1)
+                  << std::setw(14) << 100 * lru_ratio << 100 * tinylfu_ratio << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,95 @@
+// cache_contention_benchmark.cpp
+// Multi-threaded cache hit throughput: every thread reads resident keys
+// from one shared cache, like the A server's gRPC handler threads do. The
+// single-lock Cache is compared with ShardedCache at increasing thread
+// counts; hit throughput only scales when the threads run on separate cores.
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <iomanip>
+#include <algorithm>
+#include "movie.grpc.pb.h"
+#include "server/cache.h"
+#include "server/sharded_cache.h"
+
+// Run `threads` readers for `ops` hits each and return total hits per second
+template <typename CacheType>
+static double measureHits(CacheType& cache, const std::vector<std::string>& keys, size_t threads, size_t ops) {
+    std::atomic<size_t> ready(0);
+    std::atomic<bool> go(false);
+    std::vector<std::thread> workers;
+
+    for (size_t t = 0; t < threads; t++) {
+        workers.emplace_back([&, t]() {
+            uint64_t state = 0x9E3779B97F4A7C15ULL * (t + 1);
+            ready++;
+            while (!go.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            for (size_t i = 0; i < ops; i++) {
+                state ^= state << 13;
+                state ^= state >> 7;
+                state ^= state << 17;
+                cache.get(keys[state % keys.size()]);
+            }
+        });
+    }
+
+    while (ready.load() < threads) {
+        std::this_thread::yield();
+    }
+    auto start = std::chrono::high_resolution_clock::now();
+    go.store(true, std::memory_order_release);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+
+    return (threads * ops) / std::chrono::duration<double>(end - start).count();
+}
+
+int main(int argc, char** argv) {
+    size_t ops = (argc >= 2) ? std::stoul(argv[1]) : 200000;
+    size_t entries = (argc >= 3) ? std::stoul(argv[2]) : 10000;
+    size_t max_threads = (argc >= 4) ? std::stoul(argv[3])
+                                     : std::max<size_t>(8, 2 * std::thread::hardware_concurrency());
+
+    movie::SearchResponse response;
+    movie::MovieInfo* movie = response.add_results();
+    movie->set_title("The Matrix");
+    movie->set_director("Village Roadshow Pictures");
+    movie->set_genre("Action, Science Fiction");
+    movie->set_year(1999);
+
+    std::vector<std::string> keys(entries);
+    for (size_t i = 0; i < entries; i++) {
+        keys[i] = "query " + std::to_string(i);
+    }
+
+    Cache single(3600, entries);
+    ShardedCache sharded(3600, entries);
+    for (const auto& key : keys) {
+        single.put(key, response);
+        sharded.put(key, response);
+    }
+
+    std::cout << "\n====== Cache Contention Benchmark (" << entries << " entries, " << sharded.shard_count()
+              << " shards, " << ops << " hits per thread, " << std::thread::hardware_concurrency()
+              << " hardware threads) ======\n" << std::endl;
+    std::cout << std::left << std::setw(10) << "Threads" << std::setw(22) << "Single lock (Mhits/s)"
+              << std::setw(22) << "Sharded (Mhits/s)" << "Speedup" << std::endl;
+    std::cout << std::string(64, '-') << std::endl;
+
+    for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+        double single_rate = measureHits(single, keys, threads, ops);
+        double sharded_rate = measureHits(sharded, keys, threads, ops);
+        std::cout << std::left << std::setw(10) << threads << std::fixed << std::setprecision(2)
+                  << std::setw(22) << single_rate / 1e6 << std::setw(22) << sharded_rate / 1e6
+                  << (single_rate > 0 ? sharded_rate / single_rate : 0.0) << "x" << std::endl;
+    }
+
+    return 0;
+}
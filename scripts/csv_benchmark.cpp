@@ -0,0 +1,130 @@
+// csv_benchmark.cpp
+// Microbenchmark for CSV record parsing on a real data file: the old
+// per-line parser (a vector<string> per line, one char appended at a time,
+// trim copies) against the zero-copy CSVTokenizer.
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <iterator>
+#include <iomanip>
+#include <algorithm>
+#include "server/csv_tokenizer.h"
+
+// Trim whitespace from start and end of string (as the old parser did)
+static std::string legacyTrim(const std::string& str) {
+    std::string s = str;
+    s.erase(s.begin(), std::find_if(s.begin(), s.end(), [](unsigned char ch) {
+        return !std::isspace(ch);
+    }));
+    s.erase(std::find_if(s.rbegin(), s.rend(), [](unsigned char ch) {
+        return !std::isspace(ch);
+    }).base(), s.end());
+    return s;
+}
+
+// The line parser the servers used before CSVTokenizer
+static std::vector<std::string> legacyParseCSVLine(const std::string& line) {
+    std::vector<std::string> result;
+    bool inQuotes = false;
+    std::string field;
+
+    for (char c : line) {
+        if (c == '\"') {
+            inQuotes = !inQuotes;
+        } else if (c == ',' && !inQuotes) {
+            result.push_back(legacyTrim(field));
+            field.clear();
+        } else {
+            field += c;
+        }
+    }
+    result.push_back(legacyTrim(field)); // Add the last field
+
+    return result;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <csv_file> [iterations]" << std::endl;
+        return 1;
+    }
+
+    std::string csv_file = argv[1];
+    int iterations = (argc >= 3) ? std::stoi(argv[2]) : 20;
+
+    std::ifstream file(csv_file, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open file: " << csv_file << std::endl;
+        return 1;
+    }
+    std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    // The old loader split lines with getline before parsing
+    std::vector<std::string> lines;
+    size_t start = 0;
+    while (start < data.size()) {
+        size_t end = data.find('\n', start);
+        if (end == std::string::npos) end = data.size();
+        lines.push_back(data.substr(start, end - start));
+        start = end + 1;
+    }
+
+    size_t legacy_fields = 0;
+    auto legacy_start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        legacy_fields = 0;
+        for (const auto& line : lines) {
+            legacy_fields += legacyParseCSVLine(line).size();
+        }
+    }
+    auto legacy_end = std::chrono::high_resolution_clock::now();
+
+    size_t tokenizer_fields = 0;
+    size_t records = 0;
+    CSVTokenizer tokenizer;
+    auto tokenizer_start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        tokenizer_fields = 0;
+        records = 0;
+        size_t pos = 0;
+        while (pos < data.size()) {
+            pos = tokenizer.parseRecord(data, pos);
+            tokenizer_fields += tokenizer.fields().size();
+            records++;
+        }
+    }
+    auto tokenizer_end = std::chrono::high_resolution_clock::now();
+
+    // Same field values on data without escaped quotes or embedded newlines
+    size_t mismatches = 0;
+    size_t pos = 0;
+    for (const auto& line : lines) {
+        pos = tokenizer.parseRecord(data, pos);
+        std::vector<std::string> expected = legacyParseCSVLine(line);
+        if (!std::equal(expected.begin(), expected.end(), tokenizer.fields().begin(), tokenizer.fields().end())) {
+            mismatches++;
+        }
+    }
+
+    double legacy_s = std::chrono::duration<double>(legacy_end - legacy_start).count() / iterations;
+    double tokenizer_s = std::chrono::duration<double>(tokenizer_end - tokenizer_start).count() / iterations;
+    double mb = data.size() / (1024.0 * 1024.0);
+
+    std::cout << "\n====== CSV Parse Benchmark (" << records << " records, "
+              << std::fixed << std::setprecision(1) << mb << " MB, " << iterations << " iterations) ======\n" << std::endl;
+    std::cout << std::left << std::setw(24) << "Parser" << std::setw(12) << "Time (ms)"
+              << std::setw(12) << "MB/s" << std::setw(14) << "Records/sec" << "Fields" << std::endl;
+    std::cout << std::string(70, '-') << std::endl;
+    std::cout << std::setw(24) << "parseCSVLine (old)" << std::setw(12) << (legacy_s * 1000.0)
+              << std::setw(12) << (mb / legacy_s) << std::setw(14) << static_cast<long long>(lines.size() / legacy_s)
+              << legacy_fields << std::endl;
+    std::cout << std::setw(24) << "CSVTokenizer" << std::setw(12) << (tokenizer_s * 1000.0)
+              << std::setw(12) << (mb / tokenizer_s) << std::setw(14) << static_cast<long long>(records / tokenizer_s)
+              << tokenizer_fields << std::endl;
+    std::cout << "\nSpeedup: " << std::setprecision(2) << (legacy_s / tokenizer_s) << "x, "
+              << mismatches << " records with differing fields" << std::endl;
+
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,261 @@
+// ipc_benchmark.cpp
+// Ping-pong latency of an A -> B request over shared memory. The old
+// protocol (rebuilt here) wrote each request into a key-value segment
+// under its id and had B probe ids 1..9999 on every pass, so a request
+// waited for part of a full scan before B saw it. SharedMemoryChannel
+// hands B the next request and A its response in one slot lookup each.
+// The first two rows busy-poll (yielding) on both sides, so they show
+// only the discovery cost. The rings are then run the way A and B wait:
+// sleeping 10 ms between polls as they used to, and spinning briefly
+// before sleeping on a futex in the segment. A second table shows what
+// an idle listener costs in CPU with each way of waiting.
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <iomanip>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <unordered_set>
+#include <time.h>       // For clock_gettime(CLOCK_THREAD_CPUTIME_ID)
+#include "server/posix_shared_memory.h"
+#include "server/shm_channel.h"
+
+// The previous request and response records
+struct OldRequest {
+    char query[256];
+    uint64_t request_id;
+    bool processed;
+};
+
+struct OldResponse {
+    char serialized_response[8192];
+    size_t response_size;
+    uint64_t request_id;
+    bool valid;
+};
+
+struct LatencyResult {
+    double p50_us = 0;
+    double p99_us = 0;
+    double max_us = 0;
+    double round_trips_per_s = 0;
+};
+
+static LatencyResult summarize(std::vector<double>& latencies, double seconds) {
+    LatencyResult result;
+    std::sort(latencies.begin(), latencies.end());
+    result.p50_us = latencies[latencies.size() / 2];
+    result.p99_us = latencies[latencies.size() * 99 / 100];
+    result.max_us = latencies.back();
+    result.round_trips_per_s = latencies.size() / seconds;
+    return result;
+}
+
+static LatencyResult measureKeyValue(size_t round_trips, size_t response_bytes) {
+    const std::string requests_name = "/ipc_benchmark_requests";
+    const std::string responses_name = "/ipc_benchmark_responses";
+    PosixSharedMemory::destroy(requests_name);
+    PosixSharedMemory::destroy(responses_name);
+    PosixSharedMemory requests(requests_name, 10 * 1024 * 1024);
+    PosixSharedMemory responses(responses_name, 10 * 1024 * 1024);
+
+    // B's listener loop: probe every id, answer the unprocessed ones
+    std::atomic<bool> stop(false);
+    std::thread responder([&]() {
+        PosixSharedMemory request_shm(requests_name, 0, false);
+        PosixSharedMemory response_shm(responses_name, 0, false);
+        std::unordered_set<uint64_t> processed;
+        std::vector<uint8_t> data;
+        std::vector<uint8_t> response_data(sizeof(OldResponse));
+        while (!stop.load(std::memory_order_relaxed)) {
+            for (uint64_t id = 1; id < 10000; id++) {
+                std::string key = std::to_string(id);
+                if (processed.count(id) || !request_shm.read(key, data) || data.size() < sizeof(OldRequest)) {
+                    continue;
+                }
+                OldRequest request;
+                memcpy(&request, data.data(), sizeof(request));
+                if (request.processed) {
+                    processed.insert(id);
+                    continue;
+                }
+                request.processed = true;
+                memcpy(data.data(), &request, sizeof(request));
+                request_shm.write(key, data);
+
+                OldResponse* response = reinterpret_cast<OldResponse*>(response_data.data());
+                response->request_id = id;
+                response->response_size = response_bytes;
+                response->valid = true;
+                response_shm.write(key, response_data);
+                processed.insert(id);
+            }
+            std::this_thread::yield();
+        }
+    });
+
+    std::vector<double> latencies;
+    latencies.reserve(round_trips);
+    std::vector<uint8_t> request_data(sizeof(OldRequest));
+    std::vector<uint8_t> response_data;
+    auto begin = std::chrono::steady_clock::now();
+    for (uint64_t id = 1; id <= round_trips; id++) {
+        auto start = std::chrono::steady_clock::now();
+        OldRequest* request = reinterpret_cast<OldRequest*>(request_data.data());
+        strncpy(request->query, "dark knight", sizeof(request->query) - 1);
+        request->request_id = id;
+        request->processed = false;
+        std::string key = std::to_string(id);
+        requests.write(key, request_data);
+        while (!responses.read(key, response_data)) {
+            std::this_thread::yield();
+        }
+        responses.remove(key);
+        auto end = std::chrono::steady_clock::now();
+        latencies.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    stop = true;
+    responder.join();
+    PosixSharedMemory::destroy(requests_name);
+    PosixSharedMemory::destroy(responses_name);
+    return summarize(latencies, seconds);
+}
+
+enum class Wait { BUSY_POLL, SLEEP_POLL, SPIN_THEN_FUTEX };
+
+static double threadCpuSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// B's listener loop; returns the CPU time it used
+static double respond(const std::string& name, Wait wait, size_t response_bytes, const std::atomic<bool>& stop) {
+    SharedMemoryChannel server(name, false);
+    SharedMemoryChannel::Request request;
+    std::vector<uint8_t> response(response_bytes, 'r');
+    double cpu_start = threadCpuSeconds();
+    while (!stop.load(std::memory_order_relaxed)) {
+        bool taken;
+        if (wait == Wait::SPIN_THEN_FUTEX) {
+            taken = server.waitForRequest(request, std::chrono::milliseconds(100));
+        } else {
+            taken = server.receive(request);
+            if (!taken && wait == Wait::BUSY_POLL) {
+                std::this_thread::yield();
+            } else if (!taken) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+        }
+        if (taken) {
+            server.complete(request.ticket, response.data(), response.size());
+        }
+    }
+    return threadCpuSeconds() - cpu_start;
+}
+
+static LatencyResult measureChannel(size_t round_trips, size_t response_bytes, Wait wait) {
+    const std::string name = "/ipc_benchmark_channel";
+    SharedMemoryChannel::destroy(name);
+    SharedMemoryChannel client(name);
+
+    std::atomic<bool> stop(false);
+    std::thread responder([&]() {
+        respond(name, wait, response_bytes, stop);
+    });
+
+    std::vector<double> latencies;
+    latencies.reserve(round_trips);
+    std::vector<uint8_t> response;
+    auto begin = std::chrono::steady_clock::now();
+    for (uint64_t id = 1; id <= round_trips; id++) {
+        auto start = std::chrono::steady_clock::now();
+        uint64_t ticket;
+        while (!client.submit("dark knight", id, ticket)) {
+            std::this_thread::yield();
+        }
+        if (wait == Wait::SPIN_THEN_FUTEX) {
+            client.wait(ticket, response, std::chrono::milliseconds(5000));
+        } else {
+            while (client.poll(ticket, response) == SharedMemoryChannel::POLL_PENDING) {
+                if (wait == Wait::BUSY_POLL) {
+                    std::this_thread::yield();
+                } else {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                }
+            }
+        }
+        auto end = std::chrono::steady_clock::now();
+        latencies.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    stop = true;
+    client.wakeServer();
+    responder.join();
+    SharedMemoryChannel::destroy(name);
+    return summarize(latencies, seconds);
+}
+
+// CPU share of one core a listener uses while no requests come
+static double measureIdleCpu(Wait wait, double seconds) {
+    const std::string name = "/ipc_benchmark_idle";
+    SharedMemoryChannel::destroy(name);
+    SharedMemoryChannel client(name);
+
+    std::atomic<bool> stop(false);
+    double cpu = 0;
+    std::thread responder([&]() {
+        cpu = respond(name, wait, 0, stop);
+    });
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    stop = true;
+    client.wakeServer();
+    responder.join();
+    SharedMemoryChannel::destroy(name);
+    return 100.0 * cpu / seconds;
+}
+
+static void printRow(const std::string& name, size_t round_trips, const LatencyResult& result) {
+    std::cout << std::left << std::setw(28) << name << std::setw(12) << round_trips
+              << std::fixed << std::setprecision(1)
+              << std::setw(10) << result.p50_us << std::setw(10) << result.p99_us << std::setw(12) << result.max_us
+              << std::setprecision(0) << result.round_trips_per_s << std::endl;
+}
+
+int main(int argc, char** argv) {
+    size_t round_trips = (argc >= 2) ? std::stoul(argv[1]) : 100000;
+    const size_t response_bytes = 200;  // About one small serialized response
+
+    std::cout << "\n====== A -> B Ping-Pong (" << response_bytes << " byte responses, us) ======\n" << std::endl;
+    std::cout << std::left << std::setw(28) << "Protocol" << std::setw(12) << "Requests"
+              << std::setw(10) << "p50" << std::setw(10) << "p99" << std::setw(12) << "max"
+              << "Round trips/s" << std::endl;
+    std::cout << std::string(86, '-') << std::endl;
+    // The old listener never looks past id 9999
+    printRow("Key-value, id scan (old)", std::min<size_t>(round_trips, 9999),
+             measureKeyValue(std::min<size_t>(round_trips, 9999), response_bytes));
+    printRow("Rings, busy poll", round_trips, measureChannel(round_trips, response_bytes, Wait::BUSY_POLL));
+    // Each round trip waits out up to two sleeps, so this row gets few of them
+    size_t sleep_round_trips = std::min<size_t>(round_trips, 200);
+    printRow("Rings, 10 ms sleeps (old)", sleep_round_trips,
+             measureChannel(sleep_round_trips, response_bytes, Wait::SLEEP_POLL));
+    printRow("Rings, spin then futex", round_trips, measureChannel(round_trips, response_bytes, Wait::SPIN_THEN_FUTEX));
+
+    std::cout << "\n====== Idle Listener (1 s without requests, % of one core) ======\n" << std::endl;
+    std::cout << std::left << std::setw(28) << "Wait" << "CPU" << std::endl;
+    std::cout << std::string(40, '-') << std::endl;
+    const std::pair<const char*, Wait> waits[] = {
+        {"Busy poll", Wait::BUSY_POLL},
+        {"10 ms sleeps (old)", Wait::SLEEP_POLL},
+        {"Spin then futex", Wait::SPIN_THEN_FUTEX},
+    };
+    for (const auto& wait : waits) {
+        std::cout << std::left << std::setw(28) << wait.first << std::fixed << std::setprecision(2)
+                  << measureIdleCpu(wait.second, 1.0) << std::endl;
+    }
+    return 0;
+}
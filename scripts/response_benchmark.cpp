@@ -0,0 +1,137 @@
+// response_benchmark.cpp
+// Microbenchmark for building the serialized reply of a local match set:
+// the per-match MovieInfo construction the servers used to do (string
+// copies plus year parsing in a try/catch), copying MovieInfo messages
+// prebuilt at load time, and concatenating the byte ranges ResultPayloads
+// serialized at load time. The first two include serializing the response,
+// which gRPC used to do for every reply.
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <iomanip>
+#include "movie.grpc.pb.h"
+#include "server/movie_struct.h"
+#include "server/movie_store.h"
+#include "server/local_search.h"
+#include "server/result_payloads.h"
+
+// The response construction as it used to be copied into every server
+static void legacyAppendResults(const MovieStore& movies, const std::vector<uint32_t>& rows,
+                                movie::SearchResponse* response) {
+    for (uint32_t row : rows) {
+        MovieStore::ResultFields movie = movies.resultFields(row);
+        movie::MovieInfo* result = response->add_results();
+        result->set_title(std::string(movie.title));
+        result->set_director(std::string(movie.production_companies));
+        result->set_genre(std::string(movie.genres));
+        if (!movie.release_date.empty()) {
+            try {
+                result->set_year(2000 + std::stoi(std::string(movie.release_date.substr(movie.release_date.length() - 2))));
+            } catch (...) {
+                result->set_year(0);
+            }
+        }
+    }
+}
+
+// Build a fresh reply `iterations` times and return the average time in microseconds
+template <typename BuildFn>
+static double timeBuild(int iterations, std::string& last, BuildFn build) {
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        std::string bytes;
+        build(&bytes);
+        if (i == iterations - 1) last.swap(bytes);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::micro>(end - start).count() / iterations;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <csv_file> [iterations] [query...]" << std::endl;
+        return 1;
+    }
+
+    std::string csv_file = argv[1];
+    int iterations = (argc >= 3) ? std::stoi(argv[2]) : 50;
+
+    std::vector<std::string> queries;
+    for (int i = 3; i < argc; i++) {
+        queries.push_back(argv[i]);
+    }
+    if (queries.empty()) {
+        queries = {"dark knight", "comedy", "action", "inception", "a"};
+    }
+
+    MovieStore store(loadMoviesFromCSV(csv_file));
+    if (store.empty()) {
+        std::cerr << "No movies loaded from " << csv_file << std::endl;
+        return 1;
+    }
+    TrigramIndex index;
+    index.build(store);
+
+    auto build_start = std::chrono::high_resolution_clock::now();
+    ResultPayloads payloads;
+    payloads.build(store);
+    auto build_end = std::chrono::high_resolution_clock::now();
+    std::cout << "\nBuilt " << payloads.size() << " result payloads in " << std::fixed << std::setprecision(1)
+              << std::chrono::duration<double, std::milli>(build_end - build_start).count() << " ms" << std::endl;
+
+    // The previous prebuilt representation: one MovieInfo per movie
+    std::vector<movie::MovieInfo> messages(store.size());
+    for (size_t row = 0; row < store.size(); row++) {
+        movie::SearchResponse entry;
+        entry.ParseFromArray(payloads[row].data(), static_cast<int>(payloads[row].size()));
+        messages[row].Swap(entry.mutable_results(0));
+    }
+
+    std::cout << "\n====== Response Build Benchmark (" << store.size() << " movies, "
+              << iterations << " iterations) ======\n" << std::endl;
+    std::cout << std::left << std::setw(16) << "Query" << std::setw(10) << "Results"
+              << std::setw(16) << "Per-match (us)" << std::setw(16) << "Messages (us)"
+              << std::setw(18) << "Byte ranges (us)" << std::setw(14) << "ns/result" << "Speedup" << std::endl;
+    std::cout << std::string(98, '-') << std::endl;
+
+    for (const auto& query : queries) {
+        std::vector<uint32_t> rows = findMatchingMovies(store, index, toLowerCopy(query));
+
+        std::string legacy;
+        double legacy_us = timeBuild(iterations, legacy, [&](std::string* bytes) {
+            movie::SearchResponse response;
+            legacyAppendResults(store, rows, &response);
+            response.SerializeToString(bytes);
+        });
+
+        std::string copied;
+        double copied_us = timeBuild(iterations, copied, [&](std::string* bytes) {
+            movie::SearchResponse response;
+            auto* results = response.mutable_results();
+            results->Reserve(static_cast<int>(rows.size()));
+            for (uint32_t row : rows) {
+                *results->Add() = messages[row];
+            }
+            response.SerializeToString(bytes);
+        });
+
+        std::string prebuilt;
+        double prebuilt_us = timeBuild(iterations, prebuilt, [&](std::string* bytes) {
+            payloads.appendTo(rows, bytes);
+        });
+
+        if (legacy != copied || legacy != prebuilt) {
+            std::cerr << "Response mismatch for '" << query << "'" << std::endl;
+            return 1;
+        }
+
+        std::cout << std::left << std::setw(16) << query << std::setw(10) << rows.size()
+                  << std::setw(16) << std::fixed << std::setprecision(1) << legacy_us
+                  << std::setw(16) << copied_us << std::setw(18) << prebuilt_us
+                  << std::setw(14) << (rows.empty() ? 0.0 : prebuilt_us * 1000.0 / rows.size())
+                  << std::setprecision(2) << (prebuilt_us > 0 ? legacy_us / prebuilt_us : 0.0) << "x" << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,193 @@
+// search_benchmark.cpp
+// Microbenchmark for the local scan path every server runs on a cache miss.
+// Compares the old per-query lowercasing matcher, the load-time lowercased
+// search fields, the columnar store scan (serial and split across a worker
+// pool) and the trigram index lookup on a real data file.
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <iomanip>
+#include "server/movie_struct.h"
+#include "server/movie_store.h"
+#include "server/local_search.h"
+
+// The matcher as it used to be copied into every server: lowercases the
+// query and four fields of every movie on every call
+static bool legacyMovieMatchesQuery(const Movie& movie, const std::string& query) {
+    std::string lowerQuery = query;
+    std::transform(lowerQuery.begin(), lowerQuery.end(), lowerQuery.begin(), ::tolower);
+
+    std::string lowerTitle = movie.title;
+    std::transform(lowerTitle.begin(), lowerTitle.end(), lowerTitle.begin(), ::tolower);
+
+    std::string lowerGenres = movie.genres;
+    std::transform(lowerGenres.begin(), lowerGenres.end(), lowerGenres.begin(), ::tolower);
+
+    std::string lowerOverview = movie.overview;
+    std::transform(lowerOverview.begin(), lowerOverview.end(), lowerOverview.begin(), ::tolower);
+
+    std::string lowerKeywords = movie.keywords;
+    std::transform(lowerKeywords.begin(), lowerKeywords.end(), lowerKeywords.begin(), ::tolower);
+
+    return
+        lowerTitle.find(lowerQuery) != std::string::npos ||
+        lowerGenres.find(lowerQuery) != std::string::npos ||
+        lowerOverview.find(lowerQuery) != std::string::npos ||
+        lowerKeywords.find(lowerQuery) != std::string::npos;
+}
+
+// Run a scan function over all movies `iterations` times and return the
+// average time per query in microseconds
+template <typename ScanFn>
+static double timeScan(int iterations, size_t& matches, ScanFn scan) {
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        matches = scan();
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::micro>(end - start).count() / iterations;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <csv_file> [iterations] [query...]" << std::endl;
+        return 1;
+    }
+
+    std::string csv_file = argv[1];
+    int iterations = (argc >= 3) ? std::stoi(argv[2]) : 20;
+
+    std::vector<std::string> queries;
+    for (int i = 3; i < argc; i++) {
+        queries.push_back(argv[i]);
+    }
+    if (queries.empty()) {
+        // Same query mix as performance_test.cpp
+        queries = {"inception", "interstellar", "dark knight", "shawshank", "matrix",
+                   "sci-fi", "comedy", "action", "spielberg", "kubrick"};
+    }
+
+    std::vector<Movie> movies = loadMoviesFromCSV(csv_file);
+    if (movies.empty()) {
+        std::cerr << "No movies loaded from " << csv_file << std::endl;
+        return 1;
+    }
+
+    MovieStore store(movies);
+    std::cout << "\nMovie store: " << (store.searchBytes() / 1024) << " KB searched columns, "
+              << (store.otherBytes() / 1024) << " KB result/cold columns" << std::endl;
+
+    auto build_start = std::chrono::high_resolution_clock::now();
+    TrigramIndex index;
+    index.build(store);
+    auto build_end = std::chrono::high_resolution_clock::now();
+    TrigramIndex::Stats stats = index.stats();
+
+    std::cout << "Trigram index: " << stats.trigrams << " trigrams, "
+              << stats.postings << " postings, "
+              << std::fixed << std::setprecision(1) << (stats.bytes / (1024.0 * 1024.0)) << " MB, built in "
+              << std::chrono::duration<double, std::milli>(build_end - build_start).count() << " ms" << std::endl;
+
+    // Parallel full scan with the same chunking the servers use, forced on for every query
+    ParallelScan parallel;
+    parallel.pool = std::make_shared<WorkStealingPool>(std::max(2u, std::thread::hardware_concurrency()));
+    parallel.threshold = 0;
+
+    std::cout << "\n====== Local Scan Benchmark (" << movies.size() << " movies, "
+              << iterations << " iterations, " << parallel.pool->threadCount()
+              << " scan threads) ======\n" << std::endl;
+    std::cout << std::left
+              << std::setw(20) << "Query"
+              << std::setw(10) << "Matches"
+              << std::setw(16) << "Legacy (us)"
+              << std::setw(16) << "Folded (us)"
+              << std::setw(16) << "Columnar (us)"
+              << std::setw(16) << "Parallel (us)"
+              << std::setw(16) << "Indexed (us)"
+              << std::setw(10) << "Speedup" << std::endl;
+    std::cout << std::string(120, '-') << std::endl;
+
+    double legacy_total = 0.0;
+    double folded_total = 0.0;
+    double columnar_total = 0.0;
+    double parallel_total = 0.0;
+    double indexed_total = 0.0;
+
+    for (const auto& query : queries) {
+        size_t legacy_matches = 0;
+        double legacy_us = timeScan(iterations, legacy_matches, [&]() {
+            size_t count = 0;
+            for (const auto& movie : movies) {
+                if (legacyMovieMatchesQuery(movie, query)) count++;
+            }
+            return count;
+        });
+
+        size_t folded_matches = 0;
+        double folded_us = timeScan(iterations, folded_matches, [&]() {
+            std::string lowerQuery = toLowerCopy(query);
+            size_t count = 0;
+            for (const auto& movie : movies) {
+                if (movieMatchesQuery(movie, lowerQuery)) count++;
+            }
+            return count;
+        });
+
+        size_t columnar_matches = 0;
+        double columnar_us = timeScan(iterations, columnar_matches, [&]() {
+            return store.scan(toLowerCopy(query)).size();
+        });
+
+        size_t parallel_matches = 0;
+        double parallel_us = timeScan(iterations, parallel_matches, [&]() {
+            std::string lowerQuery = toLowerCopy(query);
+            MovieStore::PreparedQuery prepared = store.prepare(lowerQuery);
+            return parallel.collect(store.size(), [&](size_t begin, size_t end, std::vector<uint32_t>& out) {
+                store.scan(prepared, begin, end, out);
+            }).size();
+        });
+
+        size_t indexed_matches = 0;
+        double indexed_us = timeScan(iterations, indexed_matches, [&]() {
+            return findMatchingMovies(store, index, toLowerCopy(query)).size();
+        });
+
+        if (legacy_matches != folded_matches || legacy_matches != columnar_matches ||
+            legacy_matches != parallel_matches || legacy_matches != indexed_matches) {
+            std::cerr << "Match count mismatch for '" << query << "': " << legacy_matches << " vs "
+                      << folded_matches << " vs " << columnar_matches << " vs " << parallel_matches
+                      << " vs " << indexed_matches << std::endl;
+            return 1;
+        }
+
+        legacy_total += legacy_us;
+        folded_total += folded_us;
+        columnar_total += columnar_us;
+        parallel_total += parallel_us;
+        indexed_total += indexed_us;
+
+        std::cout << std::left
+                  << std::setw(20) << query
+                  << std::setw(10) << folded_matches
+                  << std::setw(16) << std::fixed << std::setprecision(1) << legacy_us
+                  << std::setw(16) << folded_us
+                  << std::setw(16) << columnar_us
+                  << std::setw(16) << parallel_us
+                  << std::setw(16) << indexed_us
+                  << std::setprecision(2) << (legacy_us / indexed_us) << "x" << std::endl;
+    }
+
+    std::cout << std::string(120, '-') << std::endl;
+    std::cout << std::left
+              << std::setw(30) << "Average per query"
+              << std::setw(16) << std::fixed << std::setprecision(1) << (legacy_total / queries.size())
+              << std::setw(16) << (folded_total / queries.size())
+              << std::setw(16) << (columnar_total / queries.size())
+              << std::setw(16) << (parallel_total / queries.size())
+              << std::setw(16) << (indexed_total / queries.size())
+              << std::setprecision(2) << (legacy_total / indexed_total) << "x" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,311 @@
+// shm_benchmark.cpp
+// PosixSharedMemory read/write cost at 100, 1k and 100k entries. The
+// hash-indexed segment is compared with a model of the old layout's
+// linear key scan: the same entry layout, scan and in-place overwrite,
+// but in process memory and without the semaphore, so it only shows the
+// scan and understates the old cost a little. Misses matter as much as hits: B's listener probes
+// thousands of request ids per pass and almost all of them are absent.
+// A second table runs 1..N reader threads, each with its own mapping,
+// against one writer; reads take no lock, so they scale with cores. A
+// third measures single writes while entries of random size keep being
+// replaced: compacting the whole segment when a write fails (what the
+// segment used to do inline) against leaving it to the background
+// compactor.
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <iomanip>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include "server/posix_shared_memory.h"
+
+// The previous lookup: a list of entry offsets, compared one key at a time
+class LinearIndex {
+public:
+    void append(const std::string& key, const std::vector<uint8_t>& value) {
+        offsets_.push_back(data_.size());
+        EntryHeader entry{key.size(), value.size(), 0};
+        const uint8_t* header = reinterpret_cast<const uint8_t*>(&entry);
+        data_.insert(data_.end(), header, header + sizeof(entry));
+        data_.insert(data_.end(), key.begin(), key.end());
+        data_.insert(data_.end(), value.begin(), value.end());
+    }
+
+    bool read(const std::string& key, std::vector<uint8_t>& value) {
+        EntryHeader* entry = find(key);
+        if (!entry) {
+            return false;
+        }
+        const uint8_t* valuePtr = reinterpret_cast<const uint8_t*>(entry + 1) + entry->keySize;
+        value.assign(valuePtr, valuePtr + entry->valueSize);
+        return true;
+    }
+
+    // Overwrite a resident key with a value no larger than the old one, in place like the old write()
+    bool overwrite(const std::string& key, const std::vector<uint8_t>& value) {
+        EntryHeader* entry = find(key);
+        if (!entry || value.size() > entry->valueSize) {
+            return false;
+        }
+        entry->timestamp = time(nullptr);
+        entry->valueSize = value.size();
+        memcpy(reinterpret_cast<uint8_t*>(entry + 1) + entry->keySize, value.data(), value.size());
+        return true;
+    }
+
+private:
+    struct EntryHeader {
+        size_t keySize;
+        size_t valueSize;
+        time_t timestamp;
+    };
+
+    EntryHeader* find(const std::string& key) {
+        for (size_t offset : offsets_) {
+            EntryHeader* entry = reinterpret_cast<EntryHeader*>(data_.data() + offset);
+            if (entry->keySize != key.size()) {
+                continue;
+            }
+            const uint8_t* keyPtr = reinterpret_cast<const uint8_t*>(entry + 1);
+            if (memcmp(keyPtr, key.data(), key.size()) == 0) {
+                return entry;
+            }
+        }
+        return nullptr;
+    }
+
+    std::vector<size_t> offsets_;
+    std::vector<uint8_t> data_;
+};
+
+struct ShmTimes {
+    double write_ns = 0;
+    double hit_ns = 0;
+    double miss_ns = 0;
+};
+
+// Run `ops` operations and return the average time in nanoseconds
+template <typename OpFn>
+static double timeOps(size_t ops, OpFn op) {
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < ops; i++) {
+        op(i);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / ops;
+}
+
+static std::string requestKey(size_t i) {
+    return std::to_string(i + 1);  // Like the A-B request ids
+}
+
+static ShmTimes benchmarkSegment(size_t entries, size_t ops, const std::vector<uint8_t>& value) {
+    const std::string name = "/shm_benchmark";
+    PosixSharedMemory::destroy(name);
+    ShmTimes times;
+    {
+        PosixSharedMemory shm(name, std::max<size_t>(1 << 20, entries * 1024));
+        for (size_t i = 0; i < entries; i++) {
+            shm.write(requestKey(i), value);
+        }
+
+        std::vector<uint8_t> read;
+        uint64_t state = 88172645463325252ULL;
+        times.hit_ns = timeOps(ops, [&](size_t) {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            shm.read(requestKey(state % entries), read);
+        });
+        times.miss_ns = timeOps(ops, [&](size_t i) {
+            shm.read(requestKey(entries + i), read);
+        });
+        // Same-size overwrites of random resident keys, updated in place
+        times.write_ns = timeOps(ops, [&](size_t) {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            shm.write(requestKey(state % entries), value);
+        });
+    }
+    PosixSharedMemory::destroy(name);
+    return times;
+}
+
+static ShmTimes benchmarkLinear(size_t entries, size_t ops, const std::vector<uint8_t>& value) {
+    LinearIndex index;
+    for (size_t i = 0; i < entries; i++) {
+        index.append(requestKey(i), value);
+    }
+
+    ShmTimes times;
+    std::vector<uint8_t> read;
+    uint64_t state = 88172645463325252ULL;
+    times.hit_ns = timeOps(ops, [&](size_t) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        index.read(requestKey(state % entries), read);
+    });
+    times.miss_ns = timeOps(ops, [&](size_t i) {
+        index.read(requestKey(entries + i), read);
+    });
+    // Same-size overwrites of random resident keys, updated in place
+    times.write_ns = timeOps(ops, [&](size_t) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        index.overwrite(requestKey(state % entries), value);
+    });
+    return times;
+}
+
+// Total read hits per second of `threads` readers while one thread keeps writing
+static double measureConcurrentReads(size_t threads, double seconds, const std::vector<uint8_t>& value) {
+    const std::string name = "/shm_benchmark_readers";
+    const size_t entries = 1000;
+    PosixSharedMemory::destroy(name);
+    PosixSharedMemory writer(name, 4 << 20);
+    for (size_t i = 0; i < entries; i++) {
+        writer.write(requestKey(i), value);
+    }
+
+    std::atomic<bool> stop(false);
+    std::atomic<uint64_t> hits(0);
+    std::vector<std::thread> readers;
+    for (size_t t = 0; t < threads; t++) {
+        readers.emplace_back([&, t]() {
+            PosixSharedMemory shm(name, 0, false);
+            std::vector<uint8_t> read;
+            uint64_t state = 0x9E3779B97F4A7C15ULL * (t + 1);
+            uint64_t local = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                state ^= state << 13;
+                state ^= state >> 7;
+                state ^= state << 17;
+                local += shm.read(requestKey(state % entries), read);
+            }
+            hits += local;
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto end = start + std::chrono::duration<double>(seconds);
+    for (size_t i = 0; std::chrono::steady_clock::now() < end; i++) {
+        writer.write(requestKey(i % entries), value);
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+    stop = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    PosixSharedMemory::destroy(name);
+    return hits / elapsed;
+}
+
+enum class Compaction { NONE, ON_FAILURE, BACKGROUND };
+
+struct ChurnResult {
+    double p50_us = 0;
+    double p99_us = 0;
+    double max_us = 0;
+    size_t failures = 0;
+};
+
+// Latency of single writes with 200 B to 20 KB values over a 10 MB segment
+static ChurnResult measureChurn(Compaction compaction, size_t writes) {
+    const std::string name = "/shm_benchmark_churn";
+    const size_t keys = 700;  // About 7 MB of values, so free space is short and fragmented
+    PosixSharedMemory::destroy(name);
+    PosixSharedMemory shm(name, 10 * 1024 * 1024);
+    if (compaction == Compaction::BACKGROUND) {
+        shm.startCompactor(std::chrono::milliseconds(10));
+    }
+
+    std::vector<double> latencies;
+    latencies.reserve(writes);
+    ChurnResult result;
+    uint64_t state = 88172645463325252ULL;
+    for (size_t i = 0; i < writes; i++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        std::vector<uint8_t> value(200 + state % (20 * 1024 - 200), static_cast<uint8_t>(i));
+        std::string key = requestKey((state >> 32) % keys);
+
+        auto start = std::chrono::steady_clock::now();
+        bool stored = shm.write(key, value);
+        if (!stored && compaction == Compaction::ON_FAILURE) {
+            shm.compact();
+            stored = shm.write(key, value);
+        }
+        auto end = std::chrono::steady_clock::now();
+        latencies.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+        result.failures += !stored;
+    }
+    shm.stopCompactor();
+    PosixSharedMemory::destroy(name);
+
+    std::sort(latencies.begin(), latencies.end());
+    result.p50_us = latencies[latencies.size() / 2];
+    result.p99_us = latencies[latencies.size() * 99 / 100];
+    result.max_us = latencies.back();
+    return result;
+}
+
+static void printRow(const std::string& name, size_t entries, const ShmTimes& times) {
+    std::cout << std::left << std::setw(30) << name << std::setw(10) << entries
+              << std::fixed << std::setprecision(1)
+              << std::setw(14) << times.write_ns << std::setw(14) << times.hit_ns << times.miss_ns << std::endl;
+}
+
+int main(int argc, char** argv) {
+    size_t ops = (argc >= 2) ? std::stoul(argv[1]) : 100000;
+    std::vector<uint8_t> value(200, 'x');  // About one small serialized response
+
+    std::cout << "\n====== Shared Memory Lookup (" << ops << " operations, " << value.size()
+              << " byte values, ns per operation) ======\n" << std::endl;
+    std::cout << std::left << std::setw(30) << "Index" << std::setw(10) << "Entries"
+              << std::setw(14) << "Write" << std::setw(14) << "Read hit" << "Read miss" << std::endl;
+    std::cout << std::string(78, '-') << std::endl;
+
+    for (size_t entries : {100, 1000, 100000}) {
+        // The scan is O(entries) per operation, so it gets fewer of them
+        size_t linear_ops = std::max<size_t>(100, ops * 1000 / std::max<size_t>(entries, 1000));
+        printRow("Linear scan, unlocked model", entries, benchmarkLinear(entries, linear_ops, value));
+        printRow("Hash index", entries, benchmarkSegment(entries, ops, value));
+    }
+
+    size_t max_threads = std::max(4u, std::thread::hardware_concurrency());
+    std::cout << "\n====== Concurrent Lock-Free Reads (1000 entries, one writer every 50 us, "
+              << std::thread::hardware_concurrency() << " hardware threads) ======\n" << std::endl;
+    std::cout << std::left << std::setw(12) << "Readers" << "Hits/s" << std::endl;
+    std::cout << std::string(30, '-') << std::endl;
+    for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+        std::cout << std::left << std::setw(12) << threads << std::fixed << std::setprecision(0)
+                  << measureConcurrentReads(threads, 1.0, value) << std::endl;
+    }
+
+    size_t writes = std::max<size_t>(1000, ops / 5);
+    std::cout << "\n====== Writes Under Churn (" << writes << " writes of 200 B - 20 KB into 10 MB, us) ======\n"
+              << std::endl;
+    std::cout << std::left << std::setw(28) << "Compaction" << std::setw(10) << "p50" << std::setw(10) << "p99"
+              << std::setw(12) << "max" << "Failed writes" << std::endl;
+    std::cout << std::string(75, '-') << std::endl;
+    const std::pair<const char*, Compaction> modes[] = {
+        {"None", Compaction::NONE},
+        {"Full, on failed write (old)", Compaction::ON_FAILURE},
+        {"Background, incremental", Compaction::BACKGROUND},
+    };
+    for (const auto& mode : modes) {
+        ChurnResult churn = measureChurn(mode.second, writes);
+        std::cout << std::left << std::setw(28) << mode.first << std::fixed << std::setprecision(1)
+                  << std::setw(10) << churn.p50_us << std::setw(10) << churn.p99_us << std::setw(12) << churn.max_us
+                  << churn.failures << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,103 @@
+// stampede_benchmark.cpp
+// Load test of A's miss path during cache expiry bursts. Handler threads
+// request a few popular queries from a cache with a 1 second TTL; a miss
+// costs one simulated search and fan-out (a sleep of the given latency).
+// Every time the entries expire, all threads miss together. Without
+// coalescing each of them goes downstream; with SingleFlight one search
+// per key does, and the rest wait for its result.
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <iomanip>
+#include "movie.grpc.pb.h"
+#include "server/sharded_cache.h"
+#include "server/single_flight.h"
+
+struct LoadResult {
+    uint64_t requests = 0;
+    uint64_t downstream = 0;
+    uint64_t coalesced = 0;
+    double seconds = 0;
+};
+
+// Run `threads` handlers for `seconds` against a fresh cache
+static LoadResult runLoad(bool coalesce, size_t threads, double seconds, int latency_ms, size_t keys) {
+    ShardedCache cache(1, 1000);
+    SingleFlight<CachedResponsePtr> in_flight;
+    std::atomic<uint64_t> requests(0);
+    std::atomic<uint64_t> downstream(0);
+    std::atomic<bool> stop(false);
+
+    movie::SearchResponse response;
+    movie::MovieInfo* movie = response.add_results();
+    movie->set_title("The Matrix");
+    movie->set_genre("Action, Science Fiction");
+
+    // The miss path: search and fan out, then cache the result
+    auto search = [&](const std::string& key) {
+        downstream++;
+        std::this_thread::sleep_for(std::chrono::milliseconds(latency_ms));
+        auto entry = std::make_shared<const CachedResponse>(response);
+        cache.put(key, entry);
+        return CachedResponsePtr(entry);
+    };
+
+    std::vector<std::thread> workers;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t t = 0; t < threads; t++) {
+        workers.emplace_back([&, t]() {
+            for (size_t i = t; !stop.load(std::memory_order_relaxed); i++) {
+                std::string key = "popular " + std::to_string(i % keys);
+                CachedResponsePtr result = cache.get(key);
+                if (!result) {
+                    result = coalesce ? in_flight.run(key, [&]() {
+                                            CachedResponsePtr stored = cache.peek(key);
+                                            return stored ? stored : search(key);
+                                        })
+                                      : search(key);
+                }
+                requests++;
+                std::this_thread::sleep_for(std::chrono::microseconds(200));  // Client think time
+            }
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    stop = true;
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    LoadResult result;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.requests = requests;
+    result.downstream = downstream;
+    result.coalesced = in_flight.coalesced_count();
+    return result;
+}
+
+static void printRow(const std::string& name, const LoadResult& result) {
+    std::cout << std::left << std::setw(16) << name << std::setw(12) << result.requests
+              << std::setw(18) << result.downstream << std::fixed << std::setprecision(1)
+              << std::setw(18) << result.downstream / result.seconds << result.coalesced << std::endl;
+}
+
+int main(int argc, char** argv) {
+    size_t threads = (argc >= 2) ? std::stoul(argv[1]) : 64;
+    double seconds = (argc >= 3) ? std::stod(argv[2]) : 5.0;
+    int latency_ms = (argc >= 4) ? std::stoi(argv[3]) : 50;
+    size_t keys = (argc >= 5) ? std::stoul(argv[4]) : 4;
+
+    std::cout << "\n====== Cache Stampede Load Test (" << threads << " handler threads, " << keys
+              << " popular queries, 1 s TTL, " << latency_ms << " ms fan-out, " << seconds << " s) ======\n" << std::endl;
+    std::cout << std::left << std::setw(16) << "Miss path" << std::setw(12) << "Requests"
+              << std::setw(18) << "Downstream calls" << std::setw(18) << "Downstream QPS" << "Coalesced" << std::endl;
+    std::cout << std::string(74, '-') << std::endl;
+
+    printRow("Per request", runLoad(false, threads, seconds, latency_ms, keys));
+    printRow("Single-flight", runLoad(true, threads, seconds, latency_ms, keys));
+    return 0;
+}
@@ -0,0 +1,119 @@
+// startup_benchmark.cpp
+// Measures how long a server takes to get its local data ready: parsing the
+// CSV (sequentially, or chunked across all cores) and building the store
+// and trigram index, versus mapping a binary snapshot of the same data
+// (with and without checksum verification).
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <iomanip>
+#include "server/movie_struct.h"
+#include "server/movie_store.h"
+#include "server/local_search.h"
+
+// Run `load` `iterations` times and return the average time in milliseconds
+template <typename LoadFn>
+static double timeLoad(int iterations, size_t& rows, LoadFn load) {
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        rows = load();
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <csv_file> [iterations] [snapshot_file]" << std::endl;
+        return 1;
+    }
+
+    std::string csv_file = argv[1];
+    int iterations = (argc >= 3) ? std::stoi(argv[2]) : 5;
+    std::string snapshot_file = (argc >= 4) ? argv[3] : csv_file + ".snap";
+
+    try {
+        {
+            MovieStore store(loadMoviesFromCSV(csv_file));
+            TrigramIndex index;
+            index.build(store);
+            writeMovieSnapshot(snapshot_file, store, index);
+        }
+
+        // Parsing alone, the part the chunked loader speeds up
+        size_t sequential_parse_rows = 0;
+        double sequential_parse_ms = timeLoad(iterations, sequential_parse_rows, [&]() {
+            return loadMoviesFromCSV(csv_file).size();
+        });
+
+        size_t parallel_parse_rows = 0;
+        double parallel_parse_ms = timeLoad(iterations, parallel_parse_rows, [&]() {
+            return CSVLoader::load(csv_file).size();
+        });
+
+        size_t csv_rows = 0;
+        double csv_ms = timeLoad(iterations, csv_rows, [&]() {
+            MovieStore store(loadMoviesFromCSV(csv_file));
+            TrigramIndex index;
+            index.build(store);
+            return store.size();
+        });
+
+        size_t parallel_rows = 0;
+        double parallel_ms = timeLoad(iterations, parallel_rows, [&]() {
+            MovieStore store(CSVLoader::load(csv_file));
+            TrigramIndex index;
+            index.build(store);
+            return store.size();
+        });
+
+        size_t snapshot_rows = 0;
+        double snapshot_ms = timeLoad(iterations, snapshot_rows, [&]() {
+            MovieStore store;
+            TrigramIndex index;
+            loadMovieSnapshot(snapshot_file, store, index);
+            return store.size();
+        });
+
+        size_t unverified_rows = 0;
+        double unverified_ms = timeLoad(iterations, unverified_rows, [&]() {
+            MovieStore store;
+            TrigramIndex index;
+            loadMovieSnapshot(snapshot_file, store, index, false);
+            return store.size();
+        });
+
+        if (csv_rows != snapshot_rows || csv_rows != unverified_rows || csv_rows != parallel_rows ||
+            csv_rows != sequential_parse_rows || csv_rows != parallel_parse_rows) {
+            std::cerr << "Row count mismatch: " << csv_rows << " vs " << parallel_rows << " vs "
+                      << snapshot_rows << " vs " << unverified_rows << std::endl;
+            return 1;
+        }
+
+        std::cout << "\n====== Startup Benchmark (" << csv_rows << " movies, "
+                  << iterations << " iterations) ======\n" << std::endl;
+        auto row = [&](const std::string& name, double ms, double baseline_ms) {
+            std::cout << std::left << std::fixed << std::setprecision(2)
+                      << std::setw(40) << name << std::setw(12) << ms
+                      << std::setw(14) << static_cast<long long>(csv_rows / (ms / 1000.0))
+                      << (baseline_ms / ms) << "x" << std::endl;
+        };
+
+        std::cout << std::left << std::setw(40) << "Load path" << std::setw(12) << "Time (ms)"
+                  << std::setw(14) << "Rows/sec" << "Speedup" << std::endl;
+        std::cout << std::string(74, '-') << std::endl;
+        row("CSV parse, sequential", sequential_parse_ms, sequential_parse_ms);
+        row("CSV parse, chunked parallel", parallel_parse_ms, sequential_parse_ms);
+        std::cout << std::string(74, '-') << std::endl;
+        row("CSV sequential + store + index", csv_ms, csv_ms);
+        row("CSV parallel + store + index", parallel_ms, csv_ms);
+        row("Snapshot map (checksum verified)", snapshot_ms, csv_ms);
+        row("Snapshot map (no checksum)", unverified_ms, csv_ms);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
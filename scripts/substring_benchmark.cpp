@@ -0,0 +1,103 @@
+// substring_benchmark.cpp
+// Microbenchmark for the substring kernels on real overview text: compares
+// std::string::find (what the match path used before) against the scalar,
+// SSE4.2 and AVX2 case-insensitive kernels.
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <iomanip>
+#include "server/movie_struct.h"
+#include "server/substring_search.h"
+
+// Time one pass of `fn` over all overviews and return MB/s and match count
+template <typename SearchFn>
+static double measure(const std::vector<Movie>& movies, size_t totalBytes, int iterations,
+                      size_t& matches, SearchFn fn) {
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        matches = 0;
+        for (const auto& movie : movies) {
+            if (fn(movie.overview_lower)) matches++;
+        }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    double seconds = std::chrono::duration<double>(end - start).count();
+    return (static_cast<double>(totalBytes) * iterations) / (1024.0 * 1024.0) / seconds;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <csv_file> [iterations] [query...]" << std::endl;
+        return 1;
+    }
+
+    std::string csv_file = argv[1];
+    int iterations = (argc >= 3) ? std::stoi(argv[2]) : 20;
+
+    std::vector<std::string> queries;
+    for (int i = 3; i < argc; i++) {
+        queries.push_back(toLowerCopy(argv[i]));
+    }
+    if (queries.empty()) {
+        queries = {"inception", "dark knight", "matrix", "war", "a", "kubrick", "the world"};
+    }
+
+    std::vector<Movie> movies = loadMoviesFromCSV(csv_file);
+    if (movies.empty()) {
+        std::cerr << "No movies loaded from " << csv_file << std::endl;
+        return 1;
+    }
+
+    size_t totalBytes = 0;
+    for (const auto& movie : movies) {
+        totalBytes += movie.overview_lower.size();
+    }
+
+    using Kernel = CaseInsensitiveSearch::Kernel;
+    std::vector<Kernel> kernels;
+    for (Kernel kernel : {Kernel::Scalar, Kernel::SSE42, Kernel::AVX2}) {
+        if (CaseInsensitiveSearch::supported(kernel)) {
+            kernels.push_back(kernel);
+        }
+    }
+
+    std::cout << "\n====== Overview Substring Benchmark (" << movies.size() << " overviews, "
+              << (totalBytes / 1024) << " KB, selected kernel: "
+              << CaseInsensitiveSearch::kernelName(CaseInsensitiveSearch::selectedKernel())
+              << ") ======\n" << std::endl;
+
+    std::cout << std::left << std::setw(16) << "Query" << std::setw(10) << "Matches"
+              << std::setw(14) << "find MB/s";
+    for (Kernel kernel : kernels) {
+        std::cout << std::setw(14) << (std::string(CaseInsensitiveSearch::kernelName(kernel)) + " MB/s");
+    }
+    std::cout << std::endl;
+    std::cout << std::string(40 + 14 * kernels.size(), '-') << std::endl;
+
+    for (const auto& query : queries) {
+        size_t findMatches = 0;
+        double findRate = measure(movies, totalBytes, iterations, findMatches, [&](const std::string& text) {
+            return text.find(query) != std::string::npos;
+        });
+
+        std::cout << std::left << std::setw(16) << query << std::setw(10) << findMatches
+                  << std::setw(14) << std::fixed << std::setprecision(0) << findRate;
+
+        for (Kernel kernel : kernels) {
+            size_t kernelMatches = 0;
+            double rate = measure(movies, totalBytes, iterations, kernelMatches, [&](const std::string& text) {
+                return CaseInsensitiveSearch::containsWith(kernel, text, query);
+            });
+            if (kernelMatches != findMatches) {
+                std::cerr << "\nMatch count mismatch for '" << query << "' with "
+                          << CaseInsensitiveSearch::kernelName(kernel) << std::endl;
+                return 1;
+            }
+            std::cout << std::setw(14) << rate;
+        }
+        std::cout << std::endl;
+    }
+
+    return 0;
+}
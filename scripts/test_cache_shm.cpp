@@ -3,11 +3,22 @@
 #include <vector>
 #include <chrono>
 #include <thread>
+#include <atomic>
 #include <iomanip>
+#include <fstream>
+#include <cstdio>
+#include <algorithm>
 #include "movie.grpc.pb.h"
 #include "server/cache.h"
+#include "server/sharded_cache.h"
+#include "server/query_key.h"
+#include "server/single_flight.h"
+#include "server/tier_cache.h"
+#include "server/cache_snapshot.h"
 #include "server/posix_shared_memory.h"
+#include "server/shm_channel.h"
 #include "server/response_serializer.h"
+#include "server/result_payloads.h"
 
 using movie::MovieInfo;
 using movie::SearchResponse;
@@ -124,6 +135,611 @@ bool testCache() {
     }
 }
 
+// Test that reads refresh LRU order and expired entries make room
+bool testCacheRecency() {
+    std::cout << "\n===== Testing Cache Recency =====\n" << std::endl;
+    
+    try {
+        Cache cache(1, 3);
+        SearchResponse result;
+        
+        cache.put("alien", createTestResponse("Alien", 1));
+        cache.put("heat", createTestResponse("Heat", 1));
+        cache.put("jaws", createTestResponse("Jaws", 1));
+        
+        // Reading 'alien' makes 'heat' the least recently used entry
+        cache.get("alien", result);
+        cache.put("rocky", createTestResponse("Rocky", 1));
+        
+        if (!cache.get("alien", result) || cache.get("heat", result) ||
+            !cache.get("jaws", result) || !cache.get("rocky", result)) {
+            std::cerr << "Reading 'alien' should have made 'heat' the entry to evict" << std::endl;
+            return false;
+        }
+        
+        std::cout << "LRU order refreshed on read ('heat' was evicted)" << std::endl;
+        
+        // Updating an entry must not grow the cache
+        cache.put("jaws", createTestResponse("Jaws", 2));
+        if (cache.size() != 3 || !cache.get("jaws", result) || result.results_size() != 2) {
+            std::cerr << "Updating 'jaws' should replace its entry in place" << std::endl;
+            return false;
+        }
+        
+        // Once everything has expired, a new entry replaces the stale ones
+        std::this_thread::sleep_for(std::chrono::milliseconds(2100));
+        cache.put("up", createTestResponse("Up", 1));
+        if (cache.size() != 1 || !cache.get("up", result)) {
+            std::cerr << "Expired entries should have been dropped, size is " << cache.size() << std::endl;
+            return false;
+        }
+        
+        std::cout << "Expired entries dropped on insert" << std::endl;
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Cache recency test failed with exception: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+// Test that hits share one serialized response instead of copying it
+bool testSharedResponses() {
+    std::cout << "\n===== Testing Shared Cached Responses =====\n" << std::endl;
+    
+    try {
+        Cache cache(300, 10);
+        SearchResponse original = createTestResponse("Action", 50);
+        cache.put("action", original);
+        
+        CachedResponsePtr first = cache.get("action");
+        CachedResponsePtr second = cache.get("action");
+        if (!first || first != second) {
+            std::cerr << "Hits should share the same cached response" << std::endl;
+            return false;
+        }
+        
+        // The reply buffer holds exactly the message's wire encoding
+        grpc::ByteBuffer reply = first->buffer();
+        std::vector<grpc::Slice> slices;
+        std::string wire;
+        if (!reply.Dump(&slices).ok()) {
+            std::cerr << "Could not read the reply buffer" << std::endl;
+            return false;
+        }
+        for (const auto& slice : slices) {
+            wire.append(reinterpret_cast<const char*>(slice.begin()), slice.size());
+        }
+        
+        SearchResponse parsed;
+        if (wire != original.SerializeAsString() || !cache.get("action", parsed) ||
+            parsed.results_size() != 50 || parsed.results(49).title() != "Action Movie 50") {
+            std::cerr << "Cached bytes don't match the original response" << std::endl;
+            return false;
+        }
+        
+        // Bytes handed over as a string are adopted, not copied, and outlive their owner
+        std::string bytes = original.SerializeAsString();
+        const char* data = bytes.data();
+        grpc::ByteBuffer kept;
+        {
+            CachedResponse adopted(std::move(bytes));
+            if (adopted.bytes().data() != data) {
+                std::cerr << "Moved bytes should be adopted, not copied" << std::endl;
+                return false;
+            }
+            kept = adopted.buffer();
+        }
+        slices.clear();
+        wire.clear();
+        if (!kept.Dump(&slices).ok()) {
+            std::cerr << "Could not read the adopted reply buffer" << std::endl;
+            return false;
+        }
+        for (const auto& slice : slices) {
+            wire.append(reinterpret_cast<const char*>(slice.begin()), slice.size());
+        }
+        if (wire != original.SerializeAsString()) {
+            std::cerr << "Adopted bytes don't match the original response" << std::endl;
+            return false;
+        }
+        
+        std::cout << "Cache hits share one " << first->size() << "-byte serialized response" << std::endl;
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Shared response test failed with exception: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+// Test that replies concatenate results serialized at load time
+bool testResultPayloads() {
+    std::cout << "\n===== Testing Result Payloads =====\n" << std::endl;
+    
+    try {
+        std::vector<Movie> movies(3);
+        movies[0].title = "Inception";
+        movies[0].production_companies = "Warner Bros";
+        movies[0].genres = "Action, Sci-Fi";
+        movies[0].release_date = "7/15/10";
+        movies[1].title = "Heat";
+        movies[2].title = "Up";
+        movies[2].production_companies = "Pixar";
+        movies[2].genres = "Animation";
+        movies[2].release_date = "5/29/09";
+        for (auto& movie : movies) {
+            prepareSearchFields(movie);
+        }
+        MovieStore store(movies);
+        ResultPayloads payloads;
+        payloads.build(store);
+        
+        // The concatenated entries are the same bytes as the whole message
+        SearchResponse expected;
+        MovieInfo* up = expected.add_results();
+        up->set_title("Up");
+        up->set_director("Pixar");
+        up->set_genre("Animation");
+        up->set_year(2009);
+        MovieInfo* inception = expected.add_results();
+        inception->set_title("Inception");
+        inception->set_director("Warner Bros");
+        inception->set_genre("Action, Sci-Fi");
+        inception->set_year(2010);
+        expected.add_results()->set_title("Heat");
+        
+        std::string bytes;
+        payloads.appendTo({2, 0, 1}, &bytes);
+        SearchResponse parsed;
+        if (payloads.size() != 3 || bytes != expected.SerializeAsString() ||
+            !payloads.append({2, 0, 1}, &parsed) || parsed.SerializeAsString() != bytes) {
+            std::cerr << "Concatenated results don't match the response built field by field" << std::endl;
+            return false;
+        }
+        
+        // Appending to a reply that already holds results keeps them
+        payloads.appendTo({}, &bytes);
+        payloads.appendTo({1}, &bytes);
+        parsed.Clear();
+        if (!parsed.ParseFromString(bytes) || parsed.results_size() != 4 || parsed.results(3).title() != "Heat") {
+            std::cerr << "Appended results should follow the existing ones" << std::endl;
+            return false;
+        }
+        
+        std::cout << "Replies concatenate " << payloads.size() << " prebuilt results byte for byte" << std::endl;
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Result payload test failed with exception: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+// Test the byte budget and frequency-based admission
+bool testByteBudget() {
+    std::cout << "\n===== Testing Byte-Budgeted Cache =====\n" << std::endl;
+    
+    try {
+        SearchResponse small = createTestResponse("Hot", 1);
+        size_t entry_bytes = small.ByteSizeLong() + std::string("hot 0").size();
+        Cache cache(300, 1000, 40 * entry_bytes);
+        SearchResponse result;
+        
+        // Ten popular queries, each requested several times like the server does (get, then put on a miss)
+        for (int round = 0; round < 5; round++) {
+            for (int i = 0; i < 10; i++) {
+                std::string query = "hot " + std::to_string(i);
+                if (!cache.get(query, result)) {
+                    cache.put(query, createTestResponse("Hot", 1));
+                }
+            }
+        }
+        
+        // A scan of one-off queries must not push the popular ones out
+        for (int i = 0; i < 500; i++) {
+            std::string query = "scan " + std::to_string(i);
+            if (!cache.get(query, result)) {
+                cache.put(query, createTestResponse("Hot", 1));
+            }
+        }
+        
+        int hot_hits = 0;
+        for (int i = 0; i < 10; i++) {
+            if (cache.get("hot " + std::to_string(i), result)) hot_hits++;
+        }
+        if (hot_hits != 10 || cache.bytes() > cache.max_bytes() || cache.rejected_count() == 0) {
+            std::cerr << "Scan displaced popular entries: " << hot_hits << "/10 hits, " << cache.bytes()
+                      << " of " << cache.max_bytes() << " bytes, " << cache.rejected_count() << " rejected" << std::endl;
+            return false;
+        }
+        
+        std::cout << "Popular entries survived a 500-query scan (" << cache.rejected_count() << " rejected, "
+                  << cache.bytes() << "/" << cache.max_bytes() << " bytes)" << std::endl;
+        
+        // Same scan when the entry limit binds long before the byte budget
+        Cache counted(300, 20, 10000 * entry_bytes);
+        for (int round = 0; round < 5; round++) {
+            for (int i = 0; i < 10; i++) {
+                std::string query = "hot " + std::to_string(i);
+                if (!counted.get(query, result)) {
+                    counted.put(query, createTestResponse("Hot", 1));
+                }
+            }
+        }
+        for (int i = 0; i < 500; i++) {
+            std::string query = "scan " + std::to_string(i);
+            if (!counted.get(query, result)) {
+                counted.put(query, createTestResponse("Hot", 1));
+            }
+        }
+        hot_hits = 0;
+        for (int i = 0; i < 10; i++) {
+            if (counted.get("hot " + std::to_string(i), result)) hot_hits++;
+        }
+        if (hot_hits != 10 || counted.size() > 20 || counted.rejected_count() == 0) {
+            std::cerr << "Scan displaced popular entries under the entry limit: " << hot_hits << "/10 hits, "
+                      << counted.size() << " entries, " << counted.rejected_count() << " rejected" << std::endl;
+            return false;
+        }
+        
+        std::cout << "Popular entries survived a 500-query scan under a 20-entry limit ("
+                  << counted.rejected_count() << " rejected)" << std::endl;
+        
+        // An entry larger than the whole budget is not cached
+        cache.put("drama", createTestResponse("Drama", 500));
+        if (cache.get("drama", result)) {
+            std::cerr << "Oversized 'drama' response should not be cached" << std::endl;
+            return false;
+        }
+        
+        std::cout << "Oversized entry rejected" << std::endl;
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Byte budget test failed with exception: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+// Test the lock-striped cache used by server A
+bool testShardedCache() {
+    std::cout << "\n===== Testing Sharded Cache =====\n" << std::endl;
+    
+    try {
+        // Small caches keep one shard so LRU stays exact
+        if (ShardedCache(300, 5, 16).shard_count() != 1 || ShardedCache(300, 1000, 8).shard_count() != 8) {
+            std::cerr << "Unexpected shard counts" << std::endl;
+            return false;
+        }
+        
+        ShardedCache cache(300, 1000, 8);
+        SearchResponse result;
+        for (int i = 0; i < 200; i++) {
+            cache.put("query " + std::to_string(i), createTestResponse("Query " + std::to_string(i), 1));
+        }
+        for (int i = 0; i < 200; i++) {
+            if (!cache.get("query " + std::to_string(i), result) ||
+                result.results(0).title() != "Query " + std::to_string(i) + " Movie 1") {
+                std::cerr << "'query " << i << "' not found in its shard" << std::endl;
+                return false;
+            }
+        }
+        cache.get("missing", result);
+        
+        if (cache.size() != 200 || cache.hit_count() != 200 || cache.miss_count() != 1) {
+            std::cerr << "Shard totals don't add up: " << cache.size() << " entries, "
+                      << cache.hit_count() << " hits, " << cache.miss_count() << " misses" << std::endl;
+            return false;
+        }
+        
+        std::cout << "Sharded cache found all 200 entries across " << cache.shard_count() << " shards" << std::endl;
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Sharded cache test failed with exception: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+// Test canonical query keys and deriving results from shorter cached queries
+bool testQueryKeys() {
+    std::cout << "\n===== Testing Query Keys =====\n" << std::endl;
+    
+    try {
+        for (const char* spelling : {"Matrix", "matrix", " matrix ", "MATRIX\t"}) {
+            if (QueryKey::canonical(spelling) != "matrix") {
+                std::cerr << "'" << spelling << "' should have key 'matrix', got '" << QueryKey::canonical(spelling) << "'" << std::endl;
+                return false;
+            }
+        }
+        if (QueryKey::canonical("  Dark \n Knight  ") != "dark knight" || !QueryKey::canonical(" \t ").empty()) {
+            std::cerr << "Whitespace isn't collapsed and trimmed" << std::endl;
+            return false;
+        }
+        
+        ShardedCache cache(300, 100);
+        auto lookup = [&](const std::string& base) { return cache.peek(base); };
+        
+        // Every cached "dark" result has "dark knight" in its title: it is the exact result
+        SearchResponse dark;
+        dark.add_results()->set_title("The Dark Knight");
+        dark.add_results()->set_title("The Dark Knight Rises");
+        cache.put("dark", dark);
+        CachedResponsePtr derived = QueryKey::derive("dark knight", lookup);
+        if (!derived || derived != cache.peek("dark")) {
+            std::cerr << "'dark knight' should be derived from 'dark'" << std::endl;
+            return false;
+        }
+        
+        // "Dark City" may match "dark knight" through its overview, so the tree must be asked
+        dark.add_results()->set_title("Dark City");
+        cache.put("dark", dark);
+        if (QueryKey::derive("dark knight", lookup)) {
+            std::cerr << "'dark knight' can't be decided from a 'dark' result with 'Dark City'" << std::endl;
+            return false;
+        }
+        
+        // No result for a contained query means no result for the longer one
+        cache.put("zzq", SearchResponse());
+        derived = QueryKey::derive("zzqx", lookup);
+        SearchResponse result;
+        if (!derived || !derived->parseTo(result) || result.results_size() != 0) {
+            std::cerr << "'zzqx' should be derived as empty from 'zzq'" << std::endl;
+            return false;
+        }
+        
+        // Peeking counts nothing
+        if (cache.hit_count() != 0 || cache.miss_count() != 0) {
+            std::cerr << "peek() changed the hit/miss counters" << std::endl;
+            return false;
+        }
+        cache.recordDerivedHit("zzqx");
+        if (cache.derived_hit_count() != 1) {
+            std::cerr << "Derived hit not counted" << std::endl;
+            return false;
+        }
+        
+        std::cout << "Spellings share one key; contained queries answer longer ones only when exact" << std::endl;
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Query key test failed with exception: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+// Test that concurrent misses for one key share a single search
+bool testSingleFlight() {
+    std::cout << "\n===== Testing Single-Flight Coalescing =====\n" << std::endl;
+    
+    try {
+        SingleFlight<CachedResponsePtr> in_flight;
+        std::atomic<int> searches(0);
+        std::atomic<int> shared(0);
+        const int THREADS = 8;
+        
+        std::vector<std::thread> threads;
+        std::vector<CachedResponsePtr> results(THREADS);
+        for (int t = 0; t < THREADS; t++) {
+            threads.emplace_back([&, t]() {
+                bool waited = false;
+                results[t] = in_flight.run("matrix", [&]() {
+                    searches++;
+                    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+                    return CachedResponsePtr(std::make_shared<const CachedResponse>(createTestResponse("Matrix", 2)));
+                }, &waited);
+                if (waited) shared++;
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        
+        for (const auto& result : results) {
+            if (result != results[0]) {
+                std::cerr << "Waiters got a different result than the search" << std::endl;
+                return false;
+            }
+        }
+        if (searches != 1 || shared != THREADS - 1 || in_flight.coalesced_count() != THREADS - 1 || in_flight.in_flight() != 0) {
+            std::cerr << searches << " searches for " << THREADS << " concurrent misses, "
+                      << in_flight.coalesced_count() << " coalesced" << std::endl;
+            return false;
+        }
+        std::cout << THREADS << " concurrent misses ran 1 search" << std::endl;
+        
+        // A failed search reaches its caller and doesn't stick to the key
+        try {
+            in_flight.run("matrix", []() -> CachedResponsePtr { throw std::runtime_error("B unavailable"); });
+            std::cerr << "Search failure was swallowed" << std::endl;
+            return false;
+        } catch (const std::runtime_error&) {
+        }
+        if (!in_flight.run("matrix", []() { return CachedResponsePtr(); }) && in_flight.in_flight() == 0) {
+            std::cout << "Failed search propagated, next miss searched again" << std::endl;
+            return true;
+        }
+        std::cerr << "Key still in flight after a failure" << std::endl;
+        return false;
+    } catch (const std::exception& e) {
+        std::cerr << "Single-flight test failed with exception: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+// Test that entries past the soft TTL are still served, flagged stale
+bool testSoftTtl() {
+    std::cout << "\n===== Testing Soft TTL =====\n" << std::endl;
+    
+    try {
+        ShardedCache cache(2, 10, 1, 0, 1);
+        cache.put("matrix", createTestResponse("Matrix", 2));
+        
+        bool stale = true;
+        if (!cache.get("matrix", &stale) || stale) {
+            std::cerr << "Fresh entry should be a hit and not stale" << std::endl;
+            return false;
+        }
+        
+        std::this_thread::sleep_for(std::chrono::milliseconds(1200));
+        CachedResponsePtr cached = cache.get("matrix", &stale);
+        if (!cached || !stale || cache.stale_hit_count() != 1) {
+            std::cerr << "Entry past the soft TTL should be served and flagged stale" << std::endl;
+            return false;
+        }
+        std::cout << "Stale entry served after the soft TTL" << std::endl;
+        
+        // A refresh replaces it and it is fresh again
+        cache.put("matrix", createTestResponse("Matrix", 3));
+        if (!cache.get("matrix", &stale) || stale) {
+            std::cerr << "Refreshed entry should be fresh" << std::endl;
+            return false;
+        }
+        
+        std::this_thread::sleep_for(std::chrono::milliseconds(2200));
+        if (cache.get("matrix")) {
+            std::cerr << "Entry should be gone after the hard TTL" << std::endl;
+            return false;
+        }
+        std::cout << "Entry dropped after the hard TTL" << std::endl;
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Soft TTL test failed with exception: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+// Test the optional result cache of the interior nodes
+bool testTierCache() {
+    std::cout << "\n===== Testing Tier Cache =====\n" << std::endl;
+    
+    try {
+        const char* no_cache[] = {"B_server"};
+        SearchResponse result;
+        TierCache disabled = TierCache::fromOptions(ServerOptions(1, const_cast<char**>(no_cache)), "[test]");
+        disabled.put("matrix", createTestResponse("Matrix", 2), true);
+        if (disabled.enabled() || disabled.get("matrix", result)) {
+            std::cerr << "Cache should be off without --cache-size" << std::endl;
+            return false;
+        }
+        
+        const char* argv[] = {"B_server", "--cache-size=100", "--negative-ttl=1"};
+        TierCache cache = TierCache::fromOptions(ServerOptions(3, const_cast<char**>(argv)), "[test]");
+        cache.put("matrix", createTestResponse("Matrix", 2), true);
+        cache.put("zzqx", SearchResponse(), true);
+        cache.put("partial", createTestResponse("Partial", 1), false);
+        
+        if (!cache.get("matrix", result) || result.results_size() != 2) {
+            std::cerr << "Complete answer should be cached" << std::endl;
+            return false;
+        }
+        result.Clear();
+        if (!cache.get("zzqx", result) || result.results_size() != 0 || cache.negative_hit_count() != 1) {
+            std::cerr << "Empty answer should be a negative hit" << std::endl;
+            return false;
+        }
+        if (cache.get("partial", result)) {
+            std::cerr << "Answer missing a downstream node should not be cached" << std::endl;
+            return false;
+        }
+        
+        // Serialized answers, as C and D store them
+        cache.put("heat", std::make_shared<const CachedResponse>(createTestResponse("Heat", 3)), true);
+        cache.put("nope", std::make_shared<const CachedResponse>(SearchResponse()), true);
+        cache.put("half", std::make_shared<const CachedResponse>(createTestResponse("Half", 1)), false);
+        CachedResponsePtr heat = cache.get("heat");
+        CachedResponsePtr nope = cache.get("nope");
+        result.Clear();
+        if (!heat || !heat->parseTo(result) || result.results_size() != 3 || !nope || nope->size() != 0 ||
+            cache.get("half") || cache.get("absent")) {
+            std::cerr << "Serialized answers should be cached like typed ones" << std::endl;
+            return false;
+        }
+        
+        // Negative entries expire on their own, shorter TTL
+        std::this_thread::sleep_for(std::chrono::milliseconds(1200));
+        result.Clear();
+        if (cache.get("zzqx", result) || !cache.get("matrix", result)) {
+            std::cerr << "Negative entry should expire before the result entry" << std::endl;
+            return false;
+        }
+        
+        std::cout << "Results and empty answers cached with their own TTLs, partial answers skipped" << std::endl;
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Tier cache test failed with exception: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool testCacheSnapshot() {
+    std::cout << "\n===== Testing Cache Snapshot =====\n" << std::endl;
+    
+    const std::string path = "/tmp/test_cache_snapshot.bin";
+    try {
+        ShardedCache cache(60, 1000, 4);
+        cache.put("matrix", createTestResponse("Matrix", 2));
+        cache.put("inception", createTestResponse("Inception", 1));
+        cache.put("alien", createTestResponse("Alien", 3));
+        for (int i = 0; i < 3; i++) cache.get("matrix");
+        cache.get("inception");
+        
+        std::vector<Cache::Record> hottest = cache.hottest(2);
+        if (hottest.size() != 2 || hottest[0].query != "matrix" || hottest[0].hits != 3 ||
+            hottest[1].query != "inception") {
+            std::cerr << "Hottest entries should be ranked by hits" << std::endl;
+            return false;
+        }
+        writeCacheSnapshot(path, hottest);
+        
+        // A restarted cache gets the saved entries back, with their hits
+        std::vector<Cache::Record> loaded = loadCacheSnapshot(path);
+        ShardedCache restarted(60, 1000, 4);
+        for (auto it = loaded.rbegin(); it != loaded.rend(); ++it) {
+            restarted.restore(*it);
+        }
+        SearchResponse result;
+        if (restarted.size() != 2 || !restarted.get("matrix", result) || result.results_size() != 2 ||
+            restarted.peek("alien")) {
+            std::cerr << "Restored cache should hold the saved entries" << std::endl;
+            return false;
+        }
+        if (restarted.hottest(1)[0].hits != 4) {
+            std::cerr << "Restored entry should keep its hit count" << std::endl;
+            return false;
+        }
+        
+        // Entries older than the TTL are not restored
+        Cache::Record old = loaded[0];
+        old.query = "old";
+        old.age_ms = 61 * 1000;
+        if (restarted.restore(old)) {
+            std::cerr << "Expired entry should not be restored" << std::endl;
+            return false;
+        }
+        
+        // A damaged file is rejected as a whole
+        {
+            std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+            file.seekp(sizeof(CacheSnapshotHeader) + sizeof(CacheSnapshotRecord));
+            file.put('X');
+        }
+        bool rejected = false;
+        try {
+            loadCacheSnapshot(path);
+        } catch (const std::runtime_error&) {
+            rejected = true;
+        }
+        std::remove(path.c_str());
+        if (!rejected) {
+            std::cerr << "Corrupted snapshot should fail its checksum" << std::endl;
+            return false;
+        }
+        
+        std::cout << "Hottest entries saved and restored with their hits, expired and corrupted entries rejected" << std::endl;
+        return true;
+    } catch (const std::exception& e) {
+        std::remove(path.c_str());
+        std::cerr << "Cache snapshot test failed with exception: " << e.what() << std::endl;
+        return false;
+    }
+}
+
 // Test the shared memory implementation
 bool testSharedMemory() {
     std::cout << "\n===== Testing Shared Memory =====\n" << std::endl;
@@ -208,6 +824,594 @@ bool testSharedMemory() {
     }
 }
 
+// Test the hash index of the shared memory segment
+bool testSharedMemoryIndex() {
+    std::cout << "\n===== Testing Shared Memory Index =====\n" << std::endl;
+    
+    const std::string name = "/test_shm_index";
+    try {
+        PosixSharedMemory::destroy(name);
+        PosixSharedMemory shm(name, 256 * 1024);  // 1024 slots, at most 768 entries
+        auto value = [](int i) {
+            std::string text = "value " + std::to_string(i);
+            return std::vector<uint8_t>(text.begin(), text.end());
+        };
+        
+        for (int i = 0; i < 500; i++) {
+            if (!shm.write("key " + std::to_string(i), value(i))) {
+                std::cerr << "Failed to store key " << i << std::endl;
+                return false;
+            }
+        }
+        for (int i = 0; i < 500; i += 2) {
+            shm.remove("key " + std::to_string(i));
+        }
+        
+        // New keys reuse the slots of removed ones once the tombstones are dropped
+        for (int i = 500; i < 900; i++) {
+            if (!shm.write("key " + std::to_string(i), value(i))) {
+                std::cerr << "Failed to store key " << i << " after removals" << std::endl;
+                return false;
+            }
+        }
+        std::vector<uint8_t> read;
+        for (int i = 0; i < 900; i++) {
+            bool expected = i >= 500 || i % 2 == 1;
+            if (shm.read("key " + std::to_string(i), read) != expected || (expected && read != value(i))) {
+                std::cerr << "Wrong lookup result for key " << i << std::endl;
+                return false;
+            }
+        }
+        if (shm.count() != 650) {
+            std::cerr << "Expected 650 entries, found " << shm.count() << std::endl;
+            return false;
+        }
+        
+        // A full table refuses new keys instead of overwriting anything
+        int stored = 0;
+        while (shm.write("extra " + std::to_string(stored), value(stored))) {
+            stored++;
+        }
+        if (shm.count() != 768 || !shm.read("key 899", read) || read != value(899)) {
+            std::cerr << "Full table should keep its 768 entries, has " << shm.count() << std::endl;
+            return false;
+        }
+        std::cout << "650 keys found after 250 removals, table full at " << shm.count() << " entries" << std::endl;
+        PosixSharedMemory::destroy(name);
+        
+        // A segment with the old layout is refused by openers and rebuilt by its creator
+        int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
+        if (fd == -1 || ftruncate(fd, 64 * 1024) == -1) {
+            std::cerr << "Failed to create old segment" << std::endl;
+            return false;
+        }
+        uint32_t old_magic = 0x53484D30;
+        if (pwrite(fd, &old_magic, sizeof(old_magic), 0) != sizeof(old_magic)) {
+            close(fd);
+            std::cerr << "Failed to write old header" << std::endl;
+            return false;
+        }
+        close(fd);
+        PosixSharedMemory creator(name, 64 * 1024);
+        if (creator.count() != 0 || !creator.write("matrix", value(1)) || !creator.read("matrix", read)) {
+            std::cerr << "Old segment should be rebuilt empty and usable" << std::endl;
+            return false;
+        }
+        std::cout << "Old segment layout detected and rebuilt" << std::endl;
+        
+        PosixSharedMemory::destroy(name);
+        return true;
+    } catch (const std::exception& e) {
+        PosixSharedMemory::destroy(name);
+        std::cerr << "Shared memory index test failed with exception: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+// Test lock-free readers against a concurrent writer
+bool testSharedMemoryConcurrentReads() {
+    std::cout << "\n===== Testing Shared Memory Concurrent Reads =====\n" << std::endl;
+    
+    const std::string name = "/test_shm_readers";
+    try {
+        PosixSharedMemory::destroy(name);
+        PosixSharedMemory writer(name, 256 * 1024);
+        writer.startCompactor(std::chrono::milliseconds(1));
+        
+        // Every value is one repeated byte, so a torn read shows as mixed bytes
+        auto value = [](size_t round) {
+            return std::vector<uint8_t>(1000 + round % 7000, static_cast<uint8_t>('a' + round % 26));
+        };
+        writer.write("matrix", value(0));
+        
+        std::atomic<bool> stop(false);
+        std::atomic<uint64_t> reads(0);
+        std::atomic<uint64_t> torn(0);
+        std::vector<std::thread> readers;
+        for (int t = 0; t < 3; t++) {
+            readers.emplace_back([&]() {
+                PosixSharedMemory shm(name, 0, false);
+                std::vector<uint8_t> data;
+                while (!stop) {
+                    if (!shm.read("matrix", data)) {
+                        continue;  // Between removal and re-insertion of a larger value
+                    }
+                    if (data.size() < 1000 || std::count(data.begin(), data.end(), data[0]) != static_cast<long>(data.size())) {
+                        torn++;
+                    }
+                    reads++;
+                }
+            });
+        }
+        
+        while (reads == 0) {
+            std::this_thread::yield();
+        }
+        
+        // Values grow and shrink, so entries are updated in place or moved to
+        // another block, while the compactor slides blocks down
+        size_t round = 1;
+        for (; round < 20000 || reads < 1000; round++) {
+            writer.write("matrix", value(round));
+            if (round % 50 == 0) {
+                writer.write("filler " + std::to_string(round), value(round));
+                writer.remove("filler " + std::to_string(round));
+            }
+        }
+        stop = true;
+        for (auto& reader : readers) {
+            reader.join();
+        }
+        PosixSharedMemory::destroy(name);
+        
+        if (torn > 0 || reads == 0) {
+            std::cerr << torn << " torn reads out of " << reads << std::endl;
+            return false;
+        }
+        std::cout << reads << " reads during " << round << " writes, none torn" << std::endl;
+        return true;
+    } catch (const std::exception& e) {
+        PosixSharedMemory::destroy(name);
+        std::cerr << "Concurrent read test failed with exception: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+// Test free-list reuse and incremental compaction
+bool testSharedMemoryAllocator() {
+    std::cout << "\n===== Testing Shared Memory Allocator =====\n" << std::endl;
+    
+    const std::string name = "/test_shm_allocator";
+    try {
+        PosixSharedMemory::destroy(name);
+        PosixSharedMemory shm(name, 256 * 1024);
+        auto value = [](int i, size_t size) {
+            return std::vector<uint8_t>(size, static_cast<uint8_t>('a' + i % 26));
+        };
+        auto key = [](int i) {
+            return "key " + std::to_string(i);
+        };
+        
+        // Freed blocks are reused by entries of the same size class
+        for (int i = 0; i < 100; i++) {
+            shm.write(key(i), value(i, 300));
+        }
+        size_t used = shm.usedBytes();
+        for (int i = 0; i < 100; i += 2) {
+            shm.remove(key(i));
+        }
+        if (shm.freeBytes() == 0 || shm.usedBytes() >= used) {
+            std::cerr << "Removed entries should move their blocks to the free lists" << std::endl;
+            return false;
+        }
+        for (int i = 100; i < 150; i++) {
+            shm.write(key(i), value(i, 300));
+        }
+        if (shm.freeBytes() != 0 || shm.usedBytes() != used) {
+            std::cerr << "New entries should reuse the freed blocks, " << shm.freeBytes() << " bytes still free" << std::endl;
+            return false;
+        }
+        std::cout << "50 removed blocks reused by 50 new entries" << std::endl;
+        
+        // Fill the segment with 1 KB entries and free every other one: the
+        // space is there, but only in blocks too small for 4 KB entries
+        shm.clear();
+        int entries = 0;
+        while (shm.write(key(entries), value(entries, 1000))) {
+            entries++;
+        }
+        for (int i = 0; i < entries; i += 2) {
+            shm.remove(key(i));
+        }
+        if (shm.write("large", value(0, 4000))) {
+            std::cerr << "A 4 KB entry should not fit before compaction" << std::endl;
+            return false;
+        }
+        
+        // Each step moves a few blocks; every key stays readable between steps
+        int steps = 0;
+        std::vector<uint8_t> read;
+        while (shm.compactStep(8 * 1024)) {
+            steps++;
+            for (int i = 1; i < entries; i += 2) {
+                if (!shm.read(key(i), read) || read != value(i, 1000)) {
+                    std::cerr << "Key " << i << " lost during compaction step " << steps << std::endl;
+                    return false;
+                }
+            }
+        }
+        if (steps < 10 || shm.freeBytes() != 0 || !shm.write("large", value(0, 4000))) {
+            std::cerr << "Compaction should take several steps and make room, took " << steps << std::endl;
+            return false;
+        }
+        std::cout << entries << " entries, half removed, compacted in " << steps + 1 << " steps" << std::endl;
+        
+        // The background compactor does the same on its own
+        shm.clear();
+        for (int i = 0; i < 100; i++) {
+            shm.write(key(i), value(i, 1000));
+        }
+        for (int i = 0; i < 100; i += 2) {
+            shm.remove(key(i));
+        }
+        shm.startCompactor(std::chrono::milliseconds(10));
+        for (int wait = 0; wait < 200 && shm.freeBytes() > 0; wait++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        shm.stopCompactor();
+        if (shm.freeBytes() != 0 || !shm.read(key(99), read) || read != value(99, 1000)) {
+            std::cerr << "Background compactor did not reclaim the free blocks" << std::endl;
+            return false;
+        }
+        std::cout << "Background compactor reclaimed the free blocks" << std::endl;
+        
+        PosixSharedMemory::destroy(name);
+        return true;
+    } catch (const std::exception& e) {
+        PosixSharedMemory::destroy(name);
+        std::cerr << "Shared memory allocator test failed with exception: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+// Test eviction and expiry when the segment is full
+bool testSharedMemoryEviction() {
+    std::cout << "\n===== Testing Shared Memory Eviction =====\n" << std::endl;
+    
+    const std::string name = "/test_shm_eviction";
+    try {
+        PosixSharedMemory::destroy(name);
+        PosixSharedMemory shm(name, 256 * 1024);  // 1024 slots, about 180 blocks of 1 KB values
+        shm.setEvictionPolicy(true);
+        std::vector<uint8_t> value(1000, 'v');
+        std::vector<uint8_t> read;
+        auto key = [](const std::string& prefix, int i) {
+            return prefix + " " + std::to_string(i);
+        };
+        
+        // A full table evicts instead of refusing new keys
+        std::vector<uint8_t> small(10, 's');
+        for (int i = 0; i < 2000; i++) {
+            if (!shm.write(key("small", i), small)) {
+                std::cerr << "Write " << i << " refused by a full table" << std::endl;
+                return false;
+            }
+        }
+        if (shm.count() > 768 || shm.evictionCount() < 2000 - 768 || !shm.read(key("small", 1999), read)) {
+            std::cerr << "Expected evictions to keep the table at most 768 entries, have " << shm.count() << std::endl;
+            return false;
+        }
+        std::cout << "2000 small writes, " << shm.count() << " entries kept, "
+                  << shm.evictionCount() << " evicted" << std::endl;
+        
+        // Full of bytes: entries read in a later second outlive those never read
+        shm.clear();
+        for (int i = 0; i < 20; i++) {
+            shm.write(key("hot", i), value);
+        }
+        for (int i = 0; i < 150; i++) {
+            shm.write(key("cold", i), value);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+        for (int i = 0; i < 20; i++) {
+            shm.read(key("hot", i), read);
+        }
+        for (int i = 0; i < 50; i++) {
+            if (!shm.write(key("new", i), value)) {
+                std::cerr << "Write " << i << " refused by a full segment" << std::endl;
+                return false;
+            }
+        }
+        for (int i = 0; i < 20; i++) {
+            if (!shm.read(key("hot", i), read)) {
+                std::cerr << "Recently read key " << i << " was evicted" << std::endl;
+                return false;
+            }
+        }
+        std::cout << "50 writes into a full segment, " << shm.evictionCount()
+                  << " evicted, every recently read key kept" << std::endl;
+        
+        // Entries past the TTL are misses, and are evicted first
+        shm.clear();
+        shm.setEvictionPolicy(true, 1);
+        shm.write("old", value);
+        if (!shm.read("old", read)) {
+            std::cerr << "Fresh entry should be readable" << std::endl;
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(2100));
+        if (shm.read("old", read)) {
+            std::cerr << "Expired entry should be a miss" << std::endl;
+            return false;
+        }
+        for (int i = 0; i < 300; i++) {
+            shm.write(key("new", i), value);
+        }
+        if (shm.expiredCount() != 1) {
+            std::cerr << "Expected the expired entry to be evicted, " << shm.expiredCount() << " expired" << std::endl;
+            return false;
+        }
+        std::cout << "Expired entry missed and evicted" << std::endl;
+        
+        PosixSharedMemory::destroy(name);
+        return true;
+    } catch (const std::exception& e) {
+        PosixSharedMemory::destroy(name);
+        std::cerr << "Shared memory eviction test failed with exception: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+// Test the A-B request/response rings
+bool testSharedMemoryChannel() {
+    std::cout << "\n===== Testing Shared Memory Channel =====\n" << std::endl;
+    
+    const std::string name = "/test_shm_channel";
+    try {
+        SharedMemoryChannel::destroy(name);
+        SharedMemoryChannel client(name, true, 4);
+        SharedMemoryChannel server(name, false);
+        SharedMemoryChannel::Request request;
+        std::vector<uint8_t> response;
+        
+        // Round trip, many laps around the ring
+        for (uint64_t i = 0; i < 10; i++) {
+            uint64_t ticket;
+            std::string query = "query " + std::to_string(i);
+            if (!client.submit(query, i, ticket) || !server.receive(request) ||
+                request.ticket != ticket || request.request_id != i || request.query != query) {
+                std::cerr << "Request " << i << " did not arrive intact" << std::endl;
+                return false;
+            }
+            if (client.poll(ticket, response) != SharedMemoryChannel::POLL_PENDING) {
+                std::cerr << "Unanswered request should be pending" << std::endl;
+                return false;
+            }
+            server.complete(ticket, reinterpret_cast<const uint8_t*>(query.data()), query.size());
+            if (client.poll(ticket, response) != SharedMemoryChannel::POLL_READY ||
+                std::string(response.begin(), response.end()) != query) {
+                std::cerr << "Response " << i << " did not arrive intact" << std::endl;
+                return false;
+            }
+        }
+        if (server.receive(request)) {
+            std::cerr << "Drained channel should have no requests" << std::endl;
+            return false;
+        }
+        std::cout << "10 round trips through 4 slots" << std::endl;
+        
+        // A full ring refuses requests until a slot is collected
+        std::vector<uint64_t> tickets(4);
+        for (uint64_t i = 0; i < 4; i++) {
+            client.submit("full", i, tickets[i]);
+        }
+        uint64_t extra;
+        if (client.submit("one too many", 4, extra)) {
+            std::cerr << "Full ring should refuse a fifth request" << std::endl;
+            return false;
+        }
+        for (uint64_t i = 0; i < 4; i++) {
+            server.receive(request);
+            server.complete(request.ticket, nullptr, 0, i != 1);
+        }
+        if (client.poll(tickets[1], response) != SharedMemoryChannel::POLL_FAILED ||
+            client.poll(tickets[0], response) != SharedMemoryChannel::POLL_READY) {
+            std::cerr << "Failed and answered requests should be told apart" << std::endl;
+            return false;
+        }
+        if (!client.submit("after", 5, extra)) {
+            std::cerr << "Collected slots should be reused" << std::endl;
+            return false;
+        }
+        client.poll(tickets[2], response);
+        client.poll(tickets[3], response);
+        server.receive(request);
+        server.complete(request.ticket, nullptr, 0);
+        client.poll(extra, response);
+        std::cout << "Full ring refused a request and reused collected slots" << std::endl;
+        
+        // A truncated payload arrives as sent but must not parse as an answer
+        std::vector<uint8_t> serialized = ResponseSerializer::serialize(createTestResponse("cut", 3));
+        serialized.resize(serialized.size() - 5);
+        SearchResponse parsed;
+        client.submit("cut", 6, extra);
+        server.receive(request);
+        server.complete(extra, serialized.data(), serialized.size());
+        if (client.poll(extra, response) != SharedMemoryChannel::POLL_READY || response != serialized ||
+            ResponseSerializer::deserialize(response, parsed)) {
+            std::cerr << "Truncated response should arrive as sent and fail to parse" << std::endl;
+            return false;
+        }
+        std::cout << "Truncated response delivered and rejected by the parser" << std::endl;
+
+        // Responses larger than a slot go through a segment of their own, removed once read
+        auto spillExists = [&](uint64_t t) {
+            int fd = shm_open((name + "." + std::to_string(t)).c_str(), O_RDONLY, 0);
+            if (fd != -1) {
+                close(fd);
+            }
+            return fd != -1;
+        };
+        uint64_t ticket;
+        client.submit("big", 6, ticket);
+        server.receive(request);
+        std::vector<uint8_t> big(4 * SharedMemoryChannel::MAX_RESPONSE_SIZE + 1);
+        for (size_t i = 0; i < big.size(); i++) {
+            big[i] = static_cast<uint8_t>(i * 31);
+        }
+        if (!server.complete(ticket, big.data(), big.size()) ||
+            client.poll(ticket, response) != SharedMemoryChannel::POLL_READY || response != big ||
+            spillExists(ticket)) {
+            std::cerr << "Large response should arrive intact and its segment be removed" << std::endl;
+            return false;
+        }
+        
+        // Abandoned slots are freed by the server, spilled responses included
+        for (uint64_t i = 0; i < 8; i++) {
+            client.submit("abandoned", i, ticket);
+            client.abandon(ticket);
+            server.receive(request);
+            if (server.complete(ticket, big.data(), i % 2 ? big.size() : 0) || spillExists(ticket)) {
+                std::cerr << "Abandoned request should not count as answered or leave a segment" << std::endl;
+                return false;
+            }
+        }
+
+        // A client that times out and abandons after the answer came removes the segment itself
+        client.submit("late", 6, ticket);
+        server.receive(request);
+        if (client.wait(ticket, response, std::chrono::milliseconds(1)) != SharedMemoryChannel::POLL_PENDING ||
+            !server.complete(ticket, big.data(), big.size()) || !spillExists(ticket)) {
+            std::cerr << "Late large response should be spilled for a timed-out client" << std::endl;
+            return false;
+        }
+        client.abandon(ticket);
+        if (spillExists(ticket)) {
+            std::cerr << "Abandoning an answered request should remove its segment" << std::endl;
+            return false;
+        }
+        std::cout << "Large responses spilled and read back; abandoned requests freed their slots" << std::endl;
+        
+        // A restarted server fails what its predecessor took but never answered
+        client.submit("lost", 7, ticket);
+        server.receive(request);
+        SharedMemoryChannel restarted(name, false);
+        if (restarted.recoverTaken() != 1 || client.poll(ticket, response) != SharedMemoryChannel::POLL_FAILED) {
+            std::cerr << "Taken request should be failed on restart" << std::endl;
+            return false;
+        }
+        std::cout << "Restarted server failed 1 lost request" << std::endl;
+        
+        // Several producers against several consumers (like B's listener threads);
+        // every response reaches its sender
+        std::atomic<bool> stop(false);
+        const int consumers = 3;
+        std::vector<std::thread> consumerThreads;
+        for (int c = 0; c < consumers; c++) {
+            consumerThreads.emplace_back([&]() {
+                SharedMemoryChannel channel(name, false);
+                SharedMemoryChannel::Request taken;
+                while (!stop.load()) {
+                    if (!channel.receive(taken)) {
+                        std::this_thread::yield();
+                        continue;
+                    }
+                    channel.complete(taken.ticket, reinterpret_cast<const uint8_t*>(taken.query.data()),
+                                     taken.query.size());
+                }
+            });
+        }
+        const int producers = 4;
+        const int perProducer = 500;
+        std::atomic<int> mismatches(0);
+        std::vector<std::thread> threads;
+        for (int p = 0; p < producers; p++) {
+            threads.emplace_back([&, p]() {
+                SharedMemoryChannel channel(name, false);
+                std::vector<uint8_t> answer;
+                for (int i = 0; i < perProducer; i++) {
+                    std::string query = std::to_string(p) + ":" + std::to_string(i);
+                    uint64_t mine;
+                    while (!channel.submit(query, i, mine)) {
+                        std::this_thread::yield();
+                    }
+                    SharedMemoryChannel::PollResult result;
+                    while ((result = channel.poll(mine, answer)) == SharedMemoryChannel::POLL_PENDING) {
+                        std::this_thread::yield();
+                    }
+                    if (result != SharedMemoryChannel::POLL_READY || std::string(answer.begin(), answer.end()) != query) {
+                        mismatches++;
+                    }
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        stop = true;
+        for (auto& thread : consumerThreads) {
+            thread.join();
+        }
+        if (mismatches != 0) {
+            std::cerr << mismatches << " responses reached the wrong request" << std::endl;
+            return false;
+        }
+        std::cout << producers << " producers, " << consumers << " consumers, " << producers * perProducer
+                  << " requests, every response matched" << std::endl;
+        
+        // Sleeping waiters are woken by the other side, not by their timeouts
+        std::thread sleeper([&]() {
+            SharedMemoryChannel channel(name, false);
+            SharedMemoryChannel::Request taken;
+            while (!channel.waitForRequest(taken, std::chrono::milliseconds(5000))) {
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));  // Long past the client's spin
+            channel.complete(taken.ticket, nullptr, 0);
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));  // Long past the server's spin
+        auto start = std::chrono::steady_clock::now();
+        client.submit("wake", 8, ticket);
+        SharedMemoryChannel::PollResult result = client.wait(ticket, response, std::chrono::milliseconds(5000));
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+        sleeper.join();
+        if (result != SharedMemoryChannel::POLL_READY || elapsed.count() > 1000) {
+            std::cerr << "Sleeping server and client should wake each other, took " << elapsed.count() << " ms" << std::endl;
+            return false;
+        }
+        
+        std::thread stopped([&]() {
+            SharedMemoryChannel channel(name, false);
+            SharedMemoryChannel::Request taken;
+            channel.waitForRequest(taken, std::chrono::milliseconds(5000));
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        start = std::chrono::steady_clock::now();
+        client.wakeServer();
+        stopped.join();
+        elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+        if (elapsed.count() > 1000) {
+            std::cerr << "wakeServer() should end a server's wait, took " << elapsed.count() << " ms" << std::endl;
+            return false;
+        }
+        client.submit("unanswered", 9, ticket);
+        if (client.wait(ticket, response, std::chrono::milliseconds(20)) != SharedMemoryChannel::POLL_PENDING) {
+            std::cerr << "Waiting on an unanswered request should time out" << std::endl;
+            return false;
+        }
+        client.abandon(ticket);
+        server.receive(request);
+        server.complete(request.ticket, nullptr, 0);
+        std::cout << "Sleeping server and client woken by each other, and by wakeServer()" << std::endl;
+        
+        SharedMemoryChannel::destroy(name);
+        return true;
+    } catch (const std::exception& e) {
+        SharedMemoryChannel::destroy(name);
+        std::cerr << "Shared memory channel test failed with exception: " << e.what() << std::endl;
+        return false;
+    }
+}
+
 // Test combined cache and shared memory
 bool testMultiProcess() {
     std::cout << "\n===== Testing Multi-Process Communication =====\n" << std::endl;
@@ -306,15 +1510,45 @@ int main() {
     std::cout << "Starting cache and shared memory tests..." << std::endl;
     
     bool cacheSuccess = testCache();
+    bool recencySuccess = testCacheRecency();
+    bool sharedSuccess = testSharedResponses();
+    bool payloadSuccess = testResultPayloads();
+    bool budgetSuccess = testByteBudget();
+    bool shardedSuccess = testShardedCache();
+    bool keySuccess = testQueryKeys();
+    bool flightSuccess = testSingleFlight();
+    bool softTtlSuccess = testSoftTtl();
+    bool tierSuccess = testTierCache();
+    bool snapshotSuccess = testCacheSnapshot();
     bool shmSuccess = testSharedMemory();
+    bool shmIndexSuccess = testSharedMemoryIndex();
+    bool shmReadersSuccess = testSharedMemoryConcurrentReads();
+    bool shmAllocatorSuccess = testSharedMemoryAllocator();
+    bool shmEvictionSuccess = testSharedMemoryEviction();
+    bool channelSuccess = testSharedMemoryChannel();
     bool mpSuccess = testMultiProcess();
     
     std::cout << "\n===== Test Results =====\n" << std::endl;
     std::cout << "In-Memory Cache Test: " << (cacheSuccess ? "Passed" : "  Failed") << std::endl;
+    std::cout << "Cache Recency Test: " << (recencySuccess ? "Passed" : "  Failed") << std::endl;
+    std::cout << "Shared Response Test: " << (sharedSuccess ? "Passed" : "  Failed") << std::endl;
+    std::cout << "Result Payload Test: " << (payloadSuccess ? "Passed" : "  Failed") << std::endl;
+    std::cout << "Byte Budget Test: " << (budgetSuccess ? "Passed" : "  Failed") << std::endl;
+    std::cout << "Sharded Cache Test: " << (shardedSuccess ? "Passed" : "  Failed") << std::endl;
+    std::cout << "Query Key Test: " << (keySuccess ? "Passed" : "  Failed") << std::endl;
+    std::cout << "Single-Flight Test: " << (flightSuccess ? "Passed" : "  Failed") << std::endl;
+    std::cout << "Soft TTL Test: " << (softTtlSuccess ? "Passed" : "  Failed") << std::endl;
+    std::cout << "Tier Cache Test: " << (tierSuccess ? "Passed" : "  Failed") << std::endl;
+    std::cout << "Cache Snapshot Test: " << (snapshotSuccess ? "Passed" : "  Failed") << std::endl;
     std::cout << "Shared Memory Test: " << (shmSuccess ? "Passed" : "  Failed") << std::endl;
+    std::cout << "Shared Memory Index Test: " << (shmIndexSuccess ? "Passed" : "  Failed") << std::endl;
+    std::cout << "Shared Memory Concurrent Read Test: " << (shmReadersSuccess ? "Passed" : "  Failed") << std::endl;
+    std::cout << "Shared Memory Allocator Test: " << (shmAllocatorSuccess ? "Passed" : "  Failed") << std::endl;
+    std::cout << "Shared Memory Eviction Test: " << (shmEvictionSuccess ? "Passed" : "  Failed") << std::endl;
+    std::cout << "Shared Memory Channel Test: " << (channelSuccess ? "Passed" : "  Failed") << std::endl;
     std::cout << "Multi-Process Test: " << (mpSuccess ? "Passed" : "  Failed") << std::endl;
     
-    if (cacheSuccess && shmSuccess && mpSuccess) {
+    if (cacheSuccess && recencySuccess && sharedSuccess && payloadSuccess && budgetSuccess && shardedSuccess && keySuccess && flightSuccess && softTtlSuccess && tierSuccess && snapshotSuccess && shmSuccess && shmIndexSuccess && shmReadersSuccess && shmAllocatorSuccess && shmEvictionSuccess && channelSuccess && mpSuccess) {
         std::cout << "\n  All tests passed successfully!  " << std::endl;
         return 0;
     } else {
@@ -4,7 +4,12 @@
 #include <vector>
 #include <algorithm>
 #include <cassert>
+#include <fstream>
+#include <cstdio>
 #include "server/movie_struct.h"
+#include "server/movie_store.h"
+#include "server/local_search.h"
+#include "server/csv_loader.h"
 
 // Simple unit tests for movie search functionality
 
@@ -86,6 +91,366 @@ bool test_movie_matching() {
     return all_passed;
 }
 
+// Test the shared matcher against the load-time lowercased search fields
+bool test_prepared_search_fields() {
+    Movie movie;
+    movie.title = "The Dark Knight";
+    movie.genres = "Action, Crime, Drama";
+    movie.overview = "Batman raises the stakes in his war on crime.";
+    movie.keywords = "DC Comics, Joker";
+    prepareSearchFields(movie);
+
+    if (movie.title_lower != "the dark knight" || movie.keywords_lower != "dc comics, joker") {
+        std::cerr << " Search fields were not lowercased at preparation time" << std::endl;
+        return false;
+    }
+
+    struct TestCase {
+        std::string query;
+        bool expected_result;
+    };
+
+    std::vector<TestCase> testCases = {
+        {"DARK knight", true},      // Title, mixed case query
+        {"crime", true},            // Genre and overview
+        {"batman", true},           // Overview
+        {"joker", true},            // Keywords
+        {"Warner", false},          // Production companies are not searched
+        {"superman", false}         // No match
+    };
+
+    bool all_passed = true;
+    for (const auto& test : testCases) {
+        bool result = movieMatchesQuery(movie, toLowerCopy(test.query));
+        if (result != test.expected_result) {
+            std::cerr << " Prepared match failed for query '" << test.query << "'" << std::endl;
+            all_passed = false;
+        } else {
+            std::cout << "Prepared match passed for query '" << test.query << "'" << std::endl;
+        }
+    }
+
+    return all_passed;
+}
+
+// Test that trigram index lookups return exactly what a full scan returns
+bool test_trigram_index() {
+    std::vector<Movie> movies(3);
+    movies[0].title = "The Dark Knight";
+    movies[0].genres = "Action, Crime";
+    movies[0].overview = "Batman faces the Joker.";
+    movies[1].title = "Knight and Day";
+    movies[1].genres = "Comedy";
+    movies[1].keywords = "spy, dark humor";
+    movies[2].title = "Up";
+    movies[2].genres = "Animation";
+    movies[2].overview = "An old man ties balloons to his house.";
+    for (auto& movie : movies) {
+        prepareSearchFields(movie);
+    }
+
+    MovieStore store(movies);
+    TrigramIndex index;
+    index.build(store);
+
+    // "dark knight" needs both words in one field, "up" is too short for trigrams
+    std::vector<std::string> queries = {"dark knight", "Knight", "dark", "up", "house.", "k j", "zzz", ""};
+    bool all_passed = true;
+    for (const auto& query : queries) {
+        std::string lowerQuery = toLowerCopy(query);
+        std::vector<uint32_t> expected;
+        for (size_t i = 0; i < movies.size(); i++) {
+            if (movieMatchesQuery(movies[i], lowerQuery)) {
+                expected.push_back(static_cast<uint32_t>(i));
+            }
+        }
+        if (findMatchingMovies(store, index, lowerQuery) != expected ||
+            store.scan(lowerQuery) != expected) {
+            std::cerr << " Index lookup differs from scan for query '" << query << "'" << std::endl;
+            all_passed = false;
+        } else {
+            std::cout << "Index lookup passed for query '" << query << "'" << std::endl;
+        }
+    }
+
+    if (index.stats().documents != 3 || index.stats().trigrams == 0) {
+        std::cerr << " Unexpected index statistics" << std::endl;
+        all_passed = false;
+    }
+
+    return all_passed;
+}
+
+// Test that scans split across the worker pool return the serial result
+bool test_parallel_scan() {
+    // Enough rows for several chunks, matches spread over chunk boundaries
+    std::vector<Movie> movies(5000);
+    for (size_t i = 0; i < movies.size(); i++) {
+        movies[i].title = "Movie " + std::to_string(i);
+        movies[i].genres = (i % 3 == 0) ? "Drama" : "Comedy";
+        movies[i].overview = (i % 7 == 0) ? "A dark knight returns." : "Nothing to see.";
+        prepareSearchFields(movies[i]);
+    }
+
+    MovieStore store(movies);
+    TrigramIndex index;
+    index.build(store);
+
+    ParallelScan serial;
+    ParallelScan parallel;
+    parallel.pool = std::make_shared<WorkStealingPool>(4);
+    parallel.threshold = 1;
+
+    std::vector<std::string> queries = {"dark knight", "drama", "movie 4", "e", "zzz"};
+    bool all_passed = true;
+    for (const auto& query : queries) {
+        std::string lowerQuery = toLowerCopy(query);
+        std::vector<uint32_t> expected = store.scan(lowerQuery);
+        if (findMatchingMovies(store, index, lowerQuery, parallel) != expected ||
+            findMatchingMovies(store, index, lowerQuery, serial) != expected) {
+            std::cerr << " Parallel scan differs from serial scan for query '" << query << "'" << std::endl;
+            all_passed = false;
+        } else {
+            std::cout << "Parallel scan passed for query '" << query << "' (" << expected.size() << " matches)" << std::endl;
+        }
+    }
+
+    return all_passed;
+}
+
+// Test every substring kernel supported by this CPU against std::string::find
+bool test_substring_kernels() {
+    using Kernel = CaseInsensitiveSearch::Kernel;
+
+    // Long haystack so the vector loops and the scalar tail both get exercised
+    std::string haystack = "An ex-CIA agent and his DARK past: a Knight's tale, 1999. ";
+    for (int i = 0; i < 3; i++) {
+        haystack += haystack;
+    }
+    haystack += "The Final Twist";
+
+    std::vector<std::string> needles = {"", "a", "z", "dark", "knight's tale", "ex-cia",
+                                        "the final twist", "final twistx", "1999. an",
+                                        toLowerCopy(haystack), toLowerCopy(haystack) + "!"};
+
+    bool all_passed = true;
+    for (Kernel kernel : {Kernel::Scalar, Kernel::SSE42, Kernel::AVX2}) {
+        if (!CaseInsensitiveSearch::supported(kernel)) {
+            std::cout << "Skipping unsupported kernel " << CaseInsensitiveSearch::kernelName(kernel) << std::endl;
+            continue;
+        }
+        for (const auto& needle : needles) {
+            // Check each suffix so matches land at every offset within a block
+            for (size_t start = 0; start < 40; start += 7) {
+                std::string text = haystack.substr(start);
+                bool expected = toLowerCopy(text).find(needle) != std::string::npos;
+                if (CaseInsensitiveSearch::containsWith(kernel, text, needle) != expected) {
+                    std::cerr << " Kernel " << CaseInsensitiveSearch::kernelName(kernel)
+                              << " failed for needle '" << needle.substr(0, 20) << "'" << std::endl;
+                    all_passed = false;
+                }
+            }
+        }
+        std::cout << "Kernel " << CaseInsensitiveSearch::kernelName(kernel) << " checked" << std::endl;
+    }
+
+    return all_passed;
+}
+
+// Test that the columnar store keeps every field of every movie
+bool test_movie_store() {
+    std::vector<Movie> movies(2);
+    movies[0].id = 27205;
+    movies[0].title = "Inception";
+    movies[0].vote_average = 8.364;
+    movies[0].revenue = 825532764;
+    movies[0].adult = false;
+    movies[0].homepage = "http://example.com";
+    movies[0].overview = "A thief who steals corporate secrets.";
+    movies[0].genres = "Action, Sci-Fi";
+    movies[0].production_companies = "Warner Bros";
+    movies[0].release_date = "7/15/10";
+    movies[0].tagline = "Your mind is the scene of the crime.";
+    movies[1].id = 157336;
+    movies[1].title = "Interstellar";
+    movies[1].adult = true;
+    movies[1].poster_path = "/path.jpg";
+    movies[1].keywords = "space, wormhole";
+    for (auto& movie : movies) {
+        prepareSearchFields(movie);
+    }
+
+    MovieStore store(movies);
+    if (store.size() != 2) {
+        std::cerr << " Expected 2 movies in store, got " << store.size() << std::endl;
+        return false;
+    }
+
+    Movie first = store.movie(0);
+    Movie second = store.movie(1);
+    if (first.id != 27205 || first.title != "Inception" || first.vote_average != 8.364 ||
+        first.revenue != 825532764 || first.homepage != "http://example.com" ||
+        first.tagline != "Your mind is the scene of the crime." || first.overview_lower != movies[0].overview_lower ||
+        second.id != 157336 || !second.adult || second.poster_path != "/path.jpg" ||
+        second.keywords != "space, wormhole") {
+        std::cerr << " Movie store did not round-trip movie fields" << std::endl;
+        return false;
+    }
+
+    MovieStore::ResultFields fields = store.resultFields(0);
+    if (fields.title != "Inception" || fields.production_companies != "Warner Bros" ||
+        fields.release_date != "7/15/10" || store.searchField(MovieStore::GENRES, 0) != "action, sci-fi") {
+        std::cerr << " Movie store result/search columns don't match" << std::endl;
+        return false;
+    }
+
+    std::cout << "Movie store test passed" << std::endl;
+    return true;
+}
+
+// Test that repeated low-cardinality values share one dictionary entry
+bool test_dictionary_columns() {
+    std::vector<Movie> movies(4);
+    const char* genres[] = {"Action, Crime", "Comedy", "Action, Crime", "Drama"};
+    for (size_t i = 0; i < movies.size(); i++) {
+        movies[i].title = "Movie " + std::to_string(i);
+        movies[i].genres = genres[i];
+        movies[i].status = "Released";
+        movies[i].original_language = i % 2 ? "fr" : "en";
+        movies[i].production_countries = "United States of America";
+        movies[i].spoken_languages = "English";
+        prepareSearchFields(movies[i]);
+    }
+
+    DictionaryColumn column;
+    for (const auto& movie : movies) {
+        column.append(movie.genres);
+    }
+    column.shrink();
+    if (column.entries() != 3 || column.code(0) != column.code(2) || column.get(3) != "Drama" ||
+        column.lower(0) != "action, crime" || !column.valid(movies.size())) {
+        std::cerr << " Dictionary column did not share repeated values" << std::endl;
+        return false;
+    }
+
+    MovieStore store(movies);
+    for (size_t i = 0; i < movies.size(); i++) {
+        Movie movie = store.movie(i);
+        if (movie.genres != movies[i].genres || movie.status != "Released" ||
+            movie.original_language != movies[i].original_language ||
+            movie.production_countries != movies[i].production_countries ||
+            movie.spoken_languages != "English") {
+            std::cerr << " Dictionary-encoded fields did not round-trip for row " << i << std::endl;
+            return false;
+        }
+    }
+
+    // Genre matches come from the dictionary, the rest from the text columns
+    bool all_passed = true;
+    for (std::string query : {"crime", "comedy", "movie 3", "drama", "thriller"}) {
+        std::vector<uint32_t> expected;
+        for (size_t i = 0; i < movies.size(); i++) {
+            if (movieMatchesQuery(movies[i], query)) {
+                expected.push_back(static_cast<uint32_t>(i));
+            }
+        }
+        MovieStore::PreparedQuery prepared = store.prepare(query);
+        std::vector<uint32_t> verified;
+        for (size_t i = 0; i < store.size(); i++) {
+            if (store.matches(i, prepared)) verified.push_back(static_cast<uint32_t>(i));
+        }
+        if (store.scan(query) != expected || verified != expected) {
+            std::cerr << " Dictionary match differs for query '" << query << "'" << std::endl;
+            all_passed = false;
+        } else {
+            std::cout << "Dictionary match passed for query '" << query << "'" << std::endl;
+        }
+    }
+
+    return all_passed;
+}
+
+// Test writing a snapshot and serving from the mapped file
+bool test_movie_snapshot() {
+    std::vector<Movie> movies(3);
+    movies[0].id = 603;
+    movies[0].title = "The Matrix";
+    movies[0].vote_average = 8.2;
+    movies[0].budget = 63000000;
+    movies[0].overview = "A hacker learns the truth about reality.";
+    movies[0].genres = "Action, Science Fiction";
+    movies[0].production_companies = "Village Roadshow";
+    movies[0].release_date = "3/30/99";
+    movies[1].id = 155;
+    movies[1].title = "The Dark Knight";
+    movies[1].adult = true;
+    movies[1].keywords = "joker, gotham";
+    movies[2].id = 13;
+    movies[2].title = "Forrest Gump";
+    for (auto& movie : movies) {
+        prepareSearchFields(movie);
+    }
+
+    MovieStore store(movies);
+    TrigramIndex index;
+    index.build(store);
+
+    std::string snapshotFile = "temp_test_movies.snap";
+    bool all_passed = true;
+    try {
+        writeMovieSnapshot(snapshotFile, store, index);
+
+        MovieStore mapped;
+        TrigramIndex mappedIndex;
+        loadMovieSnapshot(snapshotFile, mapped, mappedIndex);
+
+        Movie first = mapped.movie(0);
+        Movie second = mapped.movie(1);
+        if (!isMovieSnapshot(snapshotFile) || mapped.size() != 3 || first.id != 603 ||
+            first.title != "The Matrix" || first.vote_average != 8.2 || first.budget != 63000000 ||
+            first.release_date != "3/30/99" || !second.adult || second.keywords != "joker, gotham" ||
+            mappedIndex.stats().postings != index.stats().postings) {
+            std::cerr << " Mapped snapshot did not round-trip the movies" << std::endl;
+            all_passed = false;
+        }
+
+        for (std::string query : {"matrix", "gotham", "the", "zzz", "a"}) {
+            if (findMatchingMovies(mapped, mappedIndex, query) != findMatchingMovies(store, index, query)) {
+                std::cerr << " Mapped snapshot search differs for query '" << query << "'" << std::endl;
+                all_passed = false;
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << " Snapshot round trip failed: " << e.what() << std::endl;
+        all_passed = false;
+    }
+
+    // Flip one byte of the payload; the checksum must reject the file
+    {
+        std::fstream file(snapshotFile, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekg(-1, std::ios::end);
+        char last = 0;
+        file.get(last);
+        file.seekp(-1, std::ios::end);
+        file.put(static_cast<char>(last ^ 0x5A));
+    }
+    try {
+        MovieStore mapped;
+        TrigramIndex mappedIndex;
+        loadMovieSnapshot(snapshotFile, mapped, mappedIndex);
+        std::cerr << " Corrupted snapshot was accepted" << std::endl;
+        all_passed = false;
+    } catch (const std::runtime_error& e) {
+        std::cout << "Corrupted snapshot rejected: " << e.what() << std::endl;
+    }
+    std::remove(snapshotFile.c_str());
+
+    if (all_passed) {
+        std::cout << "Movie snapshot test passed" << std::endl;
+    }
+    return all_passed;
+}
+
 // Test the CSV parsing functionality with a small sample
 bool test_csv_parsing() {
     // Create a temporary CSV file
@@ -117,7 +482,8 @@ bool test_csv_parsing() {
     // Check details of the first movie
     if (movies[0].title != "Inception" || 
         movies[0].vote_average != 8.364 ||
-        movies[0].genres != "Action/Sci-Fi") {
+        movies[0].genres != "Action/Sci-Fi" ||
+        movies[0].title_lower != "inception") {
         std::cerr << " First movie details don't match expected values" << std::endl;
         return false;
     }
@@ -134,6 +500,109 @@ bool test_csv_parsing() {
     return true;
 }
 
+// Test the RFC 4180 tokenizer on quoting edge cases
+bool test_csv_tokenizer() {
+    struct Case {
+        std::string input;
+        std::vector<std::string> expected;
+    };
+    std::vector<Case> cases = {
+        {"a,b,c", {"a", "b", "c"}},
+        {" a , b ,c \r\n", {"a", "b", "c"}},
+        {"\"x, y\",z", {"x, y", "z"}},
+        {"\"He said \"\"hi\"\"\",2", {"He said \"hi\"", "2"}},
+        {"\"\",,\"\"\"\"", {"", "", "\""}},
+        {"\"line one\nline two\",end\nnext", {"line one\nline two", "end"}},
+        {"trailing,", {"trailing", ""}},
+        {"", {""}},
+    };
+
+    bool all_passed = true;
+    CSVTokenizer tokenizer;
+    for (const auto& test : cases) {
+        tokenizer.parseRecord(test.input, 0);
+        std::vector<std::string> fields(tokenizer.fields().begin(), tokenizer.fields().end());
+        if (fields != test.expected) {
+            std::cerr << " Tokenizer mismatch for input '" << test.input << "'" << std::endl;
+            all_passed = false;
+        }
+    }
+
+    // Records follow each other; plain and simply quoted fields are views into the input
+    std::string data = "1,\"Quoted\"\n\"2\"\"\",x\n";
+    size_t pos = tokenizer.parseRecord(data, 0);
+    const char* quoted = tokenizer.fields()[1].data();
+    if (pos != 11 || tokenizer.fields()[0].data() != data.data() || quoted != data.data() + 3) {
+        std::cerr << " Tokenizer copied fields that need no unescaping" << std::endl;
+        all_passed = false;
+    }
+    pos = tokenizer.parseRecord(data, pos);
+    if (pos != data.size() || tokenizer.fields().size() != 2 || tokenizer.fields()[0] != "2\"") {
+        std::cerr << " Tokenizer did not continue with the next record" << std::endl;
+        all_passed = false;
+    }
+
+    if (all_passed) {
+        std::cout << "CSV tokenizer test passed" << std::endl;
+    }
+    return all_passed;
+}
+
+// Test that the chunked parallel loader matches the sequential loader
+bool test_parallel_csv_loading() {
+    std::string tempFileName = "temp_test_movies_parallel.csv";
+    {
+        std::ofstream tempFile(tempFileName);
+        tempFile << "id,title,vote_average,vote_count,status,release_date,revenue,runtime,adult,backdrop_path,budget,homepage,imdb_id,original_language,original_title,overview,popularity,poster_path,tagline,genres,production_companies,production_countries,spoken_languages,keywords\n";
+        // Enough rows (~300 KB) to be split into several chunks
+        for (int i = 0; i < 3000; i++) {
+            if (i % 500 == 250) {
+                tempFile << i << ",Incomplete row\n";
+                continue;
+            }
+            tempFile << (i % 700 == 350 ? "abc" : std::to_string(i)) << ",Movie " << i
+                     << ",7.5,100,Released,1/1/99,1000,120,FALSE,/b.jpg,500,http://example.com,tt" << i
+                     << ",en,Movie " << i << ",\"A story, with commas, about movie " << i
+                     << "\",12.5,/p.jpg,\"Tagline, quoted\",\"Drama, Comedy\",Studio,USA,English,\"key, words\"\n";
+        }
+    }
+
+    std::vector<Movie> expected = loadMoviesFromCSV(tempFileName);
+    bool all_passed = true;
+    for (size_t threads : {1, 3, 4}) {
+        std::vector<Movie> movies = CSVLoader::load(tempFileName, threads);
+        bool same = movies.size() == expected.size();
+        for (size_t i = 0; same && i < movies.size(); i++) {
+            same = movies[i].id == expected[i].id && movies[i].title == expected[i].title &&
+                   movies[i].overview == expected[i].overview && movies[i].keywords == expected[i].keywords &&
+                   movies[i].genres_lower == expected[i].genres_lower;
+        }
+        if (!same) {
+            std::cerr << " Parallel load with " << threads << " threads differs from sequential load" << std::endl;
+            all_passed = false;
+        }
+    }
+
+    // A newline inside quotes continues the record instead of splitting it
+    {
+        std::ofstream tempFile(tempFileName, std::ios::app);
+        tempFile << "9999,Multiline,7.5,100,Released,1/1/99,1000,120,FALSE,/b.jpg,500,http://example.com,tt9999,en,"
+                 << "Multiline,\"First line\nsecond line\",12.5,/p.jpg,Tagline,Drama,Studio,USA,English,keys\n";
+    }
+    std::vector<Movie> movies = CSVLoader::load(tempFileName, 4);
+    std::remove(tempFileName.c_str());
+    if (movies.size() != expected.size() + 1 || movies.back().id != 9999 ||
+        movies.back().overview != "First line\nsecond line") {
+        std::cerr << " Quoted newline was not kept inside its record" << std::endl;
+        all_passed = false;
+    }
+
+    if (all_passed) {
+        std::cout << "Parallel CSV loading test passed (" << expected.size() << " movies)" << std::endl;
+    }
+    return all_passed;
+}
+
 int main() {
     std::cout << "Running movie search unit tests\n" << std::endl;
     
@@ -143,10 +612,46 @@ int main() {
     tests_passed &= test_movie_matching();
     std::cout << std::endl;
     
+    std::cout << "=== Testing prepared search fields ===" << std::endl;
+    tests_passed &= test_prepared_search_fields();
+    std::cout << std::endl;
+    
+    std::cout << "=== Testing substring kernels ===" << std::endl;
+    tests_passed &= test_substring_kernels();
+    std::cout << std::endl;
+    
+    std::cout << "=== Testing movie store ===" << std::endl;
+    tests_passed &= test_movie_store();
+    std::cout << std::endl;
+    
+    std::cout << "=== Testing dictionary columns ===" << std::endl;
+    tests_passed &= test_dictionary_columns();
+    std::cout << std::endl;
+    
+    std::cout << "=== Testing trigram index ===" << std::endl;
+    tests_passed &= test_trigram_index();
+    std::cout << std::endl;
+    
+    std::cout << "=== Testing parallel scan ===" << std::endl;
+    tests_passed &= test_parallel_scan();
+    std::cout << std::endl;
+    
+    std::cout << "=== Testing movie snapshot ===" << std::endl;
+    tests_passed &= test_movie_snapshot();
+    std::cout << std::endl;
+    
     std::cout << "=== Testing CSV parsing ===" << std::endl;
     tests_passed &= test_csv_parsing();
     std::cout << std::endl;
     
+    std::cout << "=== Testing CSV tokenizer ===" << std::endl;
+    tests_passed &= test_csv_tokenizer();
+    std::cout << std::endl;
+    
+    std::cout << "=== Testing parallel CSV loading ===" << std::endl;
+    tests_passed &= test_parallel_csv_loading();
+    std::cout << std::endl;
+    
     if (tests_passed) {
         std::cout << " All tests passed! " << std::endl;
         return 0;
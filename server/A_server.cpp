@@ -5,6 +5,9 @@
 #include <fstream>
 #include <sstream>
 #include <algorithm>
+#include <unordered_set>
+#include <mutex>
+#include <atomic>
 #include <thread>       // For std::thread
 #include <chrono>       // For std::chrono
 #include <csignal>      // For signal handling (instead of std::signal)
@@ -12,9 +15,17 @@
 #include <grpcpp/grpcpp.h>
 #include "movie.grpc.pb.h"
 #include "movie_struct.h" // Include our movie structure header
-#include "cache.h" // Include our cache implementation
+#include "movie_store.h" // Include our columnar movie storage
+#include "local_search.h" // Include our trigram index and parallel local search
+#include "result_payloads.h" // Include our prebuilt search results
+#include "sharded_cache.h" // Include our cache implementation
+#include "query_key.h" // Include our canonical query keys
+#include "single_flight.h" // Include our request coalescing
+#include "cache_snapshot.h" // Include our cache snapshot file
+#include "raw_search_service.h" // Include our serialized-reply Search service
 #include "posix_shared_memory.h" // Include our shared memory implementation
 #include "response_serializer.h" // Include our response serializer
+#include "ab_communication.h" // Include our shared memory or gRPC client for B
 
 using grpc::Server;
 using grpc::ServerBuilder;
@@ -29,118 +40,36 @@ using movie::SearchRequest;
 using movie::SearchResponse;
 using movie::MovieInfo;
 
-// Helper function to check if a movie matches a query
-bool movieMatchesQuery(const Movie& movie, const std::string& query) {
-    // Convert query and relevant fields to lowercase for case-insensitive comparison
-    std::string lowerQuery = query;
-    std::transform(lowerQuery.begin(), lowerQuery.end(), lowerQuery.begin(), ::tolower);
-    
-    std::string lowerTitle = movie.title;
-    std::transform(lowerTitle.begin(), lowerTitle.end(), lowerTitle.begin(), ::tolower);
-    
-    std::string lowerGenres = movie.genres;
-    std::transform(lowerGenres.begin(), lowerGenres.end(), lowerGenres.begin(), ::tolower);
-    
-    std::string lowerOverview = movie.overview;
-    std::transform(lowerOverview.begin(), lowerOverview.end(), lowerOverview.begin(), ::tolower);
-    
-    std::string lowerKeywords = movie.keywords;
-    std::transform(lowerKeywords.begin(), lowerKeywords.end(), lowerKeywords.begin(), ::tolower);
-    
-    return 
-        lowerTitle.find(lowerQuery) != std::string::npos ||
-        lowerGenres.find(lowerQuery) != std::string::npos ||
-        lowerOverview.find(lowerQuery) != std::string::npos ||
-        lowerKeywords.find(lowerQuery) != std::string::npos;
-}
-
-// ---------- A as gRPC Client to B ----------
-class BClient {
-public:
-    BClient(std::shared_ptr<Channel> channel)
-        : stub_(MovieSearch::NewStub(channel)) {
-        // Test connection to B on startup
-        SearchRequest ping;
-        ping.set_title("__ping__");
-        SearchResponse pong;
-        ClientContext context;
-        
-        std::cout << "[A] Testing connection to server B..." << std::endl;
-        Status status = stub_->Search(&context, ping, &pong);
-        
-        if (status.ok()) {
-            std::cout << "[A] Successfully connected to server B" << std::endl;
-            connected_ = true;
-        } else {
-            std::cerr << "[A]  Failed to connect to server B: " 
-                     << status.error_message() 
-                     << " (code: " << status.error_code() << ")" << std::endl;
-            if (status.error_code() == StatusCode::UNAVAILABLE) {
-                std::cerr << "[A] 🔍 This usually means server B is not running or the address is incorrect" << std::endl;
-            }
-            connected_ = false;
-        }
-    }
-
-    SearchResponse Search(const std::string& title) {
-        SearchRequest request;
-        request.set_title(title);
-        SearchResponse response;
-        ClientContext context;
-        
-        // Set a timeout for the request (5 seconds)
-        std::chrono::system_clock::time_point deadline = 
-            std::chrono::system_clock::now() + std::chrono::seconds(5);
-        context.set_deadline(deadline);
-
-        std::cout << "[A] Sending request to server B: \"" << title << "\"" << std::endl;
-        Status status = stub_->Search(&context, request, &response);
-        
-        if (!status.ok()) {
-            std::cerr << "[A → B] gRPC call failed: " << status.error_message() 
-                     << " (code: " << status.error_code() << ")" << std::endl;
-            
-            if (status.error_code() == StatusCode::DEADLINE_EXCEEDED) {
-                std::cerr << "[A] 🕒 Request timed out. Server B might be overloaded or unresponsive." << std::endl;
-            } else if (status.error_code() == StatusCode::UNAVAILABLE) {
-                std::cerr << "[A] 🔌 Server B is unavailable. Network issue or server not running." << std::endl;
-            }
-            
-            connected_ = false;
-        } else {
-            connected_ = true;
-            std::cout << "[A] Received " << response.results_size() << " results from server B" << std::endl;
-        }
-
-        return response;
-    }
-
-    bool isConnected() const {
-        return connected_;
-    }
-
-private:
-    std::unique_ptr<MovieSearch::Stub> stub_;
-    bool connected_ = false;
-};
-
 // ---------- A as gRPC Server ----------
-class MovieSearchServiceImpl final : public MovieSearch::Service {
+class MovieSearchServiceImpl final : public RawSearchService {
 public:
     MovieSearchServiceImpl(const std::string& b_address, const std::string& csv_file, 
-                          int cache_ttl = 300, size_t cache_size = 100)
-        : b_client_(grpc::CreateChannel(b_address, grpc::InsecureChannelCredentials())), 
-          cache_(cache_ttl, cache_size) {
+                          int cache_ttl = 300, size_t cache_size = 100, size_t cache_bytes = 0,
+                          const ParallelScan& parallel = ParallelScan(), size_t cache_shards = 0,
+                          int cache_soft_ttl = 0, int shm_ttl = 0)
+        : b_client_(BServerCommunication::Create(b_address)), 
+          parallel_(parallel),
+          cache_(cache_ttl, cache_size, cache_shards, cache_bytes, cache_soft_ttl) {
+        if (cache_soft_ttl > 0) {
+            refresh_pool_ = std::make_unique<WorkStealingPool>(REFRESH_THREADS);
+        }
         try {
             // Load local movie data
-            movies_ = loadMoviesFromCSV(csv_file);
-            std::cout << "[A] Successfully loaded movies from " << csv_file << std::endl;
+            loadLocalMovies(csv_file, "[A]", movies_, index_);
+            results_.build(movies_);
             
             // Initialize shared memory
             try {
                 const size_t SHM_SIZE = 10 * 1024 * 1024; // 10 MB shared memory
                 shm_ = std::make_unique<PosixSharedMemory>("/movie_search_cache", SHM_SIZE);
+                shm_->startCompactor();  // Returns freed blocks off the write path
+                shm_->setEvictionPolicy(true, static_cast<uint32_t>(shm_ttl));
                 std::cout << "[A] Successfully initialized shared memory" << std::endl;
+                std::cout << "[A] Shared memory evicts least recently read entries when full";
+                if (shm_ttl > 0) {
+                    std::cout << ", expires them after " << shm_ttl << " seconds";
+                }
+                std::cout << std::endl;
                 shm_available_ = true;
             } catch (const std::exception& e) {
                 std::cerr << "[A] ⚠️ Failed to initialize shared memory: " << e.what() << std::endl;
@@ -153,7 +82,7 @@ public:
     }
 
     Status Search(ServerContext* context, const SearchRequest* request,
-                  SearchResponse* response) override {
+                  grpc::ByteBuffer* reply) override {
         auto start_time = std::chrono::high_resolution_clock::now();
         std::string query = request->title();
         std::cout << "[A] Received query: \"" << query << "\"" << std::endl;
@@ -161,14 +90,24 @@ public:
         // Special case for ping
         if (query == "__ping__") {
             std::cout << "[A] Received ping request, sending empty response" << std::endl;
+            *reply = serialize(SearchResponse());
             return Status::OK;
         }
         
-        // Try to get from in-memory cache first
-        bool cache_hit = cache_.get(query, *response);
+        // Spellings that match the same movies ("Matrix", " matrix ") share one key
+        std::string key = QueryKey::canonical(query);
         
-        if (cache_hit) {
+        // Try to get from in-memory cache first (replies with the shared bytes, no copy)
+        bool stale = false;
+        CachedResponsePtr cached = cache_.get(key, &stale);
+        
+        if (cached) {
+            *reply = cached->buffer();
             std::cout << "[A] 🎯 Cache hit for query: \"" << query << "\"" << std::endl;
+            if (stale) {
+                // Past the soft TTL: this reply doesn't wait, the next ones get fresh results
+                refreshInBackground(query, key);
+            }
             auto end_time = std::chrono::high_resolution_clock::now();
             auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
             std::cout << "[A] Query completed in " << duration.count() << "ms (from cache)" << std::endl;
@@ -178,17 +117,20 @@ public:
         // If not in memory cache, try shared memory
         if (shm_available_) {
             std::vector<uint8_t> serialized_data;
-            bool shm_hit = shm_->read(query, serialized_data);
+            bool shm_hit = shm_->read(key, serialized_data);
             
             if (shm_hit) {
-                // Deserialize response from shared memory
-                bool deserialized = ResponseSerializer::deserialize(serialized_data, *response);
+                // Check the entry parses; it is the same encoding we reply with
+                SearchResponse shm_response;
+                bool deserialized = ResponseSerializer::deserialize(serialized_data, shm_response);
                 
                 if (deserialized) {
                     std::cout << "[A] 💾 Shared memory hit for query: \"" << query << "\"" << std::endl;
                     
                     // Also update in-memory cache
-                    cache_.put(query, *response);
+                    auto entry = std::make_shared<const CachedResponse>(serialized_data.data(), serialized_data.size());
+                    cache_.put(key, entry);
+                    *reply = entry->buffer();
                     
                     auto end_time = std::chrono::high_resolution_clock::now();
                     auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
@@ -198,56 +140,191 @@ public:
             }
         }
         
-        // Cache miss, need to search locally and forward request
-        std::cout << "[A] 🔍 Cache miss for query: \"" << query << "\"" << std::endl;
+        // A cached shorter query contained in this one may already hold its exact result
+        CachedResponsePtr derived = QueryKey::derive(key, [this](const std::string& base) {
+            return cache_.peek(base);
+        });
+        if (derived) {
+            cache_.recordDerivedHit(key);
+            cache_.put(key, derived);
+            *reply = derived->buffer();
+            std::cout << "[A] 🧩 Derived result for query: \"" << query << "\" from a cached shorter query" << std::endl;
+            auto end_time = std::chrono::high_resolution_clock::now();
+            auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+            std::cout << "[A] Query completed in " << duration.count() << "ms (derived from cache)" << std::endl;
+            return Status::OK;
+        }
         
-        // Search in A's local data
-        int localMatches = 0;
-        for (const auto& movie : movies_) {
-            if (movieMatchesQuery(movie, query)) {
-                MovieInfo* result = response->add_results();
-                result->set_title(movie.title);
-                result->set_director(movie.production_companies); // Using production companies as "director"
-                result->set_genre(movie.genres);
-                
-                // Parse year from release date (format: MM/DD/YY)
-                if (!movie.release_date.empty()) {
-                    try {
-                        result->set_year(2000 + std::stoi(movie.release_date.substr(movie.release_date.length() - 2)));
-                    } catch (...) {
-                        result->set_year(0); // Default if parsing fails
-                    }
-                }
-                localMatches++;
+        // Concurrent misses for the same key wait for one search and fan-out
+        bool coalesced = false;
+        CachedResponsePtr entry = in_flight_.run(key, [&]() {
+            // A search for this key may have finished since the cache lookup
+            CachedResponsePtr stored = cache_.peek(key);
+            return stored ? stored : searchAndStore(query, key);
+        }, &coalesced);
+        *reply = entry->buffer();
+        
+        auto end_time = std::chrono::high_resolution_clock::now();
+        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+        std::cout << "[A] Query completed in " << duration.count() << "ms ("
+                  << (coalesced ? "from in-flight search" : "from search") << ")" << std::endl;
+        
+        // Print cache statistics
+        std::cout << "[A] Cache stats: " << cache_.size() << " entries, "
+                 << cache_.hit_count() << " hits, "
+                 << cache_.derived_hit_count() << " derived, "
+                 << in_flight_.coalesced_count() << " coalesced, "
+                 << cache_.miss_count() << " misses, "
+                 << std::fixed << std::setprecision(2) << (cache_.hit_ratio() * 100.0) << "% hit ratio" 
+                 << std::endl;
+                 
+        return Status::OK;
+    }
+
+    size_t cacheShards() const {
+        return cache_.shard_count();
+    }
+
+    /**
+     * Save the hottest cache entries to a snapshot file
+     * @param path Snapshot file
+     * @param limit Maximum number of entries
+     */
+    void saveCacheSnapshot(const std::string& path, size_t limit) {
+        try {
+            std::vector<Cache::Record> records = cache_.hottest(limit);
+            writeCacheSnapshot(path, records);
+            std::cout << "[A] 💾 Saved " << records.size() << " cache entries to " << path << std::endl;
+        } catch (const std::exception& e) {
+            std::cerr << "[A] ⚠️ Failed to save cache snapshot: " << e.what() << std::endl;
+        }
+    }
+
+    /**
+     * Warm the cache from a snapshot file, if there is one. Must be called
+     * before the server starts.
+     * @param path Snapshot file
+     * @param revalidate Whether to re-run every restored query in the background
+     */
+    void restoreCacheSnapshot(const std::string& path, bool revalidate) {
+        if (!std::ifstream(path)) {
+            std::cout << "[A] No cache snapshot at " << path << ", starting with an empty cache" << std::endl;
+            return;
+        }
+        std::vector<Cache::Record> records;
+        try {
+            records = loadCacheSnapshot(path);
+        } catch (const std::exception& e) {
+            std::cerr << "[A] ⚠️ Ignoring cache snapshot: " << e.what() << std::endl;
+            return;
+        }
+        
+        // Coldest first, so the hottest entries end up most recently used
+        std::vector<std::string> restored;
+        for (auto it = records.rbegin(); it != records.rend(); ++it) {
+            if (cache_.restore(*it)) {
+                restored.push_back(it->query);
+            }
+        }
+        std::cout << "[A] Restored " << restored.size() << " of " << records.size()
+                  << " cache entries from " << path << std::endl;
+        
+        if (revalidate && !restored.empty()) {
+            if (!refresh_pool_) {
+                refresh_pool_ = std::make_unique<WorkStealingPool>(REFRESH_THREADS);
+            }
+            // Hottest first
+            for (auto it = restored.rbegin(); it != restored.rend(); ++it) {
+                refreshInBackground(*it, *it);
             }
         }
+    }
+
+    // Print cache statistics
+    void printCacheStats() {
+        std::cout << "\n===== Cache Statistics =====" << std::endl;
+        std::cout << "Entries: " << cache_.size() << std::endl;
+        std::cout << "Bytes: " << cache_.bytes() << std::endl;
+        std::cout << "Rejected by admission: " << cache_.rejected_count() << std::endl;
+        std::cout << "Hits: " << cache_.hit_count() << std::endl;
+        std::cout << "Misses: " << cache_.miss_count() << std::endl;
+        std::cout << "Derived from a shorter query: " << cache_.derived_hit_count() << std::endl;
+        std::cout << "Coalesced into in-flight searches: " << in_flight_.coalesced_count() << std::endl;
+        std::cout << "Stale hits (refreshed in background): " << cache_.stale_hit_count() << std::endl;
+        std::cout << "Hit ratio: " << std::fixed << std::setprecision(2) 
+                 << (cache_.hit_ratio() * 100.0) << "%" << std::endl;
+        
+        if (shm_available_) {
+            std::cout << "Shared memory entries: ~" << shm_->count() << std::endl;
+            std::cout << "Shared memory used: " << (shm_->usedBytes() / 1024) << " KB" << std::endl;
+            std::cout << "Shared memory evictions: " << shm_->evictionCount() << " (expired: "
+                      << shm_->expiredCount() << ")" << std::endl;
+        }
+    }
+
+private:
+    /**
+     * Search A's data and B for a query that missed every cache, and store
+     * the result in the caches
+     * @param query The query as received (for logging)
+     * @param key Its canonical form, which is searched and cached
+     * @return The serialized result
+     */
+    CachedResponsePtr searchAndStore(const std::string& query, const std::string& key) {
+        // Cache miss, need to search locally and forward request
+        std::cout << "[A] 🔍 Cache miss for query: \"" << query << "\"" << std::endl;
+        
+        // Search in A's local data (the key is already lowercased, fields at load time)
+        std::vector<uint32_t> matches = findMatchingMovies(movies_, index_, key, parallel_);
+        int localMatches = static_cast<int>(matches.size());
         std::cout << "[A] Found " << localMatches << " matches in local data" << std::endl;
+        
+        // The result starts with the matches' prebuilt bytes; B's results follow
+        std::string bytes;
+        results_.appendTo(matches, &bytes);
 
         // Forward request to Process B if connected
-        if (b_client_.isConnected()) {
-            std::cout << "[A] Forwarding query to server B: \"" << query << "\"" << std::endl;
-            SearchResponse b_response = b_client_.Search(query);
+        bool complete = false;
+        int bMatches = 0;
+        if (b_client_->IsConnected()) {
+            std::cout << "[A] Forwarding query to server B: \"" << key << "\"" << std::endl;
+            SearchResponse b_response;
+            complete = b_client_->Search(key, b_response);
 
-            int bMatches = 0;
-            for (const auto& movie : b_response.results()) {
-                *response->add_results() = movie;
-                bMatches++;
-            }
+            b_response.AppendToString(&bytes);
+            bMatches = b_response.results_size();
             std::cout << "[A] Added " << bMatches << " results from server B" << std::endl;
         } else {
             std::cerr << "[A] ⚠️ Skipping forward to server B - connection is down" << std::endl;
         }
+        
+        // Without B's results, a cached (stale) result is better than a partial one
+        if (!complete) {
+            CachedResponsePtr cached = cache_.peek(key);
+            if (cached) {
+                std::cerr << "[A] ⚠️ Keeping cached result for query: \"" << query << "\" (server B didn't answer)" << std::endl;
+                return cached;
+            }
+        }
 
-        // Store response in caches
-        if (response->results_size() > 0) {
+        // The same bytes are cached, shared and sent
+        auto entry = std::make_shared<const CachedResponse>(std::move(bytes));
+        int totalMatches = localMatches + bMatches;
+        
+        // Store response in caches, unless it lacks B's results. An empty
+        // result is kept too; it lets longer queries containing this one be
+        // answered from cache
+        if (complete) {
             // Store in memory cache
-            cache_.put(query, *response);
-            
+            cache_.put(key, entry);
+        }
+        if (complete && totalMatches > 0) {
             // Store in shared memory if available
             if (shm_available_) {
                 try {
-                    std::vector<uint8_t> serialized_data = ResponseSerializer::serialize(*response);
-                    bool stored = shm_->write(query, serialized_data);
+                    std::string_view bytes = entry->bytes();
+                    std::vector<uint8_t> serialized_data(bytes.begin(), bytes.end());
+                    bool stored = shm_->write(key, serialized_data);
                     
                     if (stored) {
                         std::cout << "[A] 💾 Stored result in shared memory" << std::endl;
@@ -260,52 +337,100 @@ public:
             }
         }
 
-        std::cout << "[A] Returning " << response->results_size() << " total results to client" << std::endl;
-        
-        auto end_time = std::chrono::high_resolution_clock::now();
-        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
-        std::cout << "[A] Query completed in " << duration.count() << "ms (from search)" << std::endl;
-        
-        // Print cache statistics
-        std::cout << "[A] Cache stats: " << cache_.size() << " entries, "
-                 << cache_.hit_count() << " hits, "
-                 << cache_.miss_count() << " misses, "
-                 << std::fixed << std::setprecision(2) << (cache_.hit_ratio() * 100.0) << "% hit ratio" 
-                 << std::endl;
-                 
-        return Status::OK;
+        std::cout << "[A] Returning " << totalMatches << " total results to client" << std::endl;
+        return entry;
     }
-
-    // Print cache statistics
-    void printCacheStats() {
-        std::cout << "\n===== Cache Statistics =====" << std::endl;
-        std::cout << "Entries: " << cache_.size() << std::endl;
-        std::cout << "Hits: " << cache_.hit_count() << std::endl;
-        std::cout << "Misses: " << cache_.miss_count() << std::endl;
-        std::cout << "Hit ratio: " << std::fixed << std::setprecision(2) 
-                 << (cache_.hit_ratio() * 100.0) << "%" << std::endl;
-        
-        if (shm_available_) {
-            std::cout << "Shared memory entries: ~" << shm_->count() << std::endl;
-            std::cout << "Shared memory used: " << (shm_->usedBytes() / 1024) << " KB" << std::endl;
+    
+    /**
+     * Re-run a stale query on the refresh pool, unless a refresh of it is
+     * already queued or running. Misses for the key meanwhile join it.
+     * @param query The query as received (for logging)
+     * @param key Its canonical form
+     */
+    void refreshInBackground(const std::string& query, const std::string& key) {
+        {
+            std::lock_guard<std::mutex> lock(refresh_mutex_);
+            if (!refreshing_.insert(key).second) {
+                return;
+            }
         }
+        std::cout << "[A] ♻️ Refreshing cached entry for query: \"" << query << "\"" << std::endl;
+        refresh_pool_->submit([this, query, key]() {
+            try {
+                in_flight_.run(key, [&]() { return searchAndStore(query, key); });
+            } catch (const std::exception& e) {
+                std::cerr << "[A] ⚠️ Refresh of query \"" << query << "\" failed: " << e.what() << std::endl;
+            }
+            std::lock_guard<std::mutex> lock(refresh_mutex_);
+            refreshing_.erase(key);
+        });
     }
 
-private:
-    BClient b_client_;
-    std::vector<Movie> movies_;
-    Cache cache_;
+    std::unique_ptr<BServerCommunication> b_client_;  // Shared memory when B is local
+    MovieStore movies_;
+    TrigramIndex index_;
+    ResultPayloads results_;
+    ParallelScan parallel_;
+    ShardedCache cache_;
+    SingleFlight<CachedResponsePtr> in_flight_;
     std::unique_ptr<PosixSharedMemory> shm_;
     bool shm_available_ = false;
+    
+    // Background refresh of stale or restored entries (only with a soft TTL
+    // or revalidation); declared last so queued refreshes finish before the
+    // members they use go away
+    static constexpr size_t REFRESH_THREADS = 2;
+    std::mutex refresh_mutex_;
+    std::unordered_set<std::string> refreshing_;
+    std::unique_ptr<WorkStealingPool> refresh_pool_;
+};
+
+/**
+ * Where and how often A saves its hottest cache entries (disabled without a path)
+ */
+struct CacheSnapshotSettings {
+    static constexpr long long DEFAULT_ENTRIES = 1000;
+
+    std::string path;
+    size_t entries = DEFAULT_ENTRIES;
+    int interval = 0;         // Seconds between periodic saves (0 = only on shutdown)
+    bool revalidate = false;  // Re-run restored queries in the background
+
+    static CacheSnapshotSettings fromOptions(const ServerOptions& options) {
+        CacheSnapshotSettings settings;
+        settings.path = options.getString("cache-snapshot", "");
+        settings.entries = static_cast<size_t>(std::max(1LL, options.getInt("cache-snapshot-entries", DEFAULT_ENTRIES)));
+        settings.interval = static_cast<int>(std::max(0LL, options.getInt("cache-snapshot-interval", 0)));
+        settings.revalidate = options.has("cache-snapshot-revalidate");
+        return settings;
+    }
 };
 
+// Set once A serves requests; SIGINT / SIGTERM then stop it gracefully
+static std::atomic<bool> g_serving(false);
+static std::atomic<bool> g_shutdown_requested(false);
+
 void RunServer(const std::string& server_address, const std::string& b_address, 
-               const std::string& csv_file, int cache_ttl, size_t cache_size) {
+               const std::string& csv_file, int cache_ttl, size_t cache_size, size_t cache_bytes,
+               const ParallelScan& parallel, size_t cache_shards, int cache_soft_ttl, int shm_ttl,
+               const CacheSnapshotSettings& snapshot) {
     std::cout << "[A] Starting server on " << server_address << std::endl;
     std::cout << "[A] Will connect to server B at " << b_address << std::endl;
-    std::cout << "[A] Cache TTL: " << cache_ttl << " seconds, max size: " << cache_size << " entries" << std::endl;
+    std::cout << "[A] Cache TTL: " << cache_ttl << " seconds, max size: " << cache_size << " entries";
+    if (cache_bytes > 0) {
+        std::cout << ", " << cache_bytes << " bytes (W-TinyLFU admission)";
+    }
+    if (cache_soft_ttl > 0) {
+        std::cout << ", refreshed in background after " << cache_soft_ttl << " seconds";
+    }
+    std::cout << std::endl;
     
-    MovieSearchServiceImpl service(b_address, csv_file, cache_ttl, cache_size);
+    MovieSearchServiceImpl service(b_address, csv_file, cache_ttl, cache_size, cache_bytes, parallel, cache_shards,
+                                   cache_soft_ttl, shm_ttl);
+    std::cout << "[A] Cache shards: " << service.cacheShards() << std::endl;
+    if (!snapshot.path.empty()) {
+        service.restoreCacheSnapshot(snapshot.path, snapshot.revalidate);
+    }
 
     ServerBuilder builder;
     // Set timeout options
@@ -327,47 +452,116 @@ void RunServer(const std::string& server_address, const std::string& b_address,
         // Detach the thread so it runs independently
         stats_thread.detach();
         
+        // Save the cache periodically, and stop the server once a signal asks for it
+        std::thread shutdown_thread([&]() {
+            auto next_save = std::chrono::steady_clock::now() + std::chrono::seconds(snapshot.interval);
+            while (!g_shutdown_requested) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(200));
+                if (!snapshot.path.empty() && snapshot.interval > 0 && std::chrono::steady_clock::now() >= next_save) {
+                    service.saveCacheSnapshot(snapshot.path, snapshot.entries);
+                    next_save = std::chrono::steady_clock::now() + std::chrono::seconds(snapshot.interval);
+                }
+            }
+            std::cout << "\n[A] Shutting down..." << std::endl;
+            server->Shutdown(std::chrono::system_clock::now() + std::chrono::seconds(5));
+        });
+        g_serving = true;
+        
         server->Wait();
+        shutdown_thread.join();
+        if (!snapshot.path.empty()) {
+            service.saveCacheSnapshot(snapshot.path, snapshot.entries);
+        }
     } else {
         std::cerr << "[A]  Failed to start server on " << server_address << std::endl;
     }
 }
 
 int main(int argc, char** argv) {
-    if (argc < 4) {
-        std::cerr << "Usage: ./A_server <listen_address> <B_address> <csv_file> [cache_ttl] [cache_size]" << std::endl;
-        std::cerr << "Example: ./A_server 0.0.0.0:50001 localhost:50002 movies.csv 300 1000" << std::endl;
+    ServerOptions options(argc, argv);
+    const std::vector<std::string>& args = options.positional();
+
+    if (args.size() < 3) {
+        std::cerr << "Usage: ./A_server <listen_address> <B_address> <csv_or_snapshot_file> [cache_ttl] [cache_size] [cache_bytes] "
+                  << "[--search-threads=N] [--parallel-threshold=ROWS] [--cache-shards=N] [--cache-soft-ttl=SECONDS] "
+                  << "[--cache-snapshot=FILE] [--cache-snapshot-entries=N] [--cache-snapshot-interval=SECONDS] "
+                  << "[--cache-snapshot-revalidate] [--shm-ttl=SECONDS]" << std::endl;
+        std::cerr << "Example: ./A_server 0.0.0.0:50001 localhost:50002 movies.csv 300 1000 67108864" << std::endl;
         std::cerr << "  cache_ttl: Time-to-live for cache entries in seconds (default: 300)" << std::endl;
         std::cerr << "  cache_size: Maximum number of entries in cache (default: 100)" << std::endl;
+        std::cerr << "  cache_bytes: Byte budget for cached responses, enables frequency-based admission (default: 0, entry limit only)" << std::endl;
+        std::cerr << "  --search-threads: Worker threads for large local scans (default: hardware threads, 1 disables)" << std::endl;
+        std::cerr << "  --parallel-threshold: Rows below which a scan stays on the request thread (default: "
+                  << ParallelScan::DEFAULT_THRESHOLD << ")" << std::endl;
+        std::cerr << "  --cache-shards: Independently locked cache shards (default: 4 per hardware thread, at least "
+                  << ShardedCache::MIN_SHARD_ENTRIES << " entries each)" << std::endl;
+        std::cerr << "  --cache-soft-ttl: Age after which a hit is still served but refreshed in the background "
+                  << "(default: 0, disabled; must be below cache_ttl)" << std::endl;
+        std::cerr << "  --cache-snapshot: File the hottest cache entries are saved to on shutdown and restored from "
+                  << "on start (default: none)" << std::endl;
+        std::cerr << "  --cache-snapshot-entries: Entries to save (default: " << CacheSnapshotSettings::DEFAULT_ENTRIES
+                  << ")" << std::endl;
+        std::cerr << "  --cache-snapshot-interval: Also save every SECONDS (default: 0, only on shutdown)" << std::endl;
+        std::cerr << "  --cache-snapshot-revalidate: Re-run restored queries in the background after start" << std::endl;
+        std::cerr << "  --shm-ttl: Lifetime of results in the shared memory cache (default: cache_ttl, 0 = unlimited)"
+                  << std::endl;
         return 1;
     }
 
     try {
-        std::string server_address = argv[1]; // e.g., 0.0.0.0:50001
-        std::string b_address = argv[2]; // e.g., 192.168.0.3:5002
-        std::string csv_file = argv[3]; // e.g., a_movies.csv
+        std::string server_address = args[0]; // e.g., 0.0.0.0:50001
+        std::string b_address = args[1]; // e.g., 192.168.0.3:5002
+        std::string csv_file = args[2]; // e.g., a_movies.csv
         
         // Parse optional cache parameters
         int cache_ttl = 300; // Default: 5 minutes
         size_t cache_size = 100; // Default: 100 entries
+        size_t cache_bytes = 0; // Default: no byte budget
         
-        if (argc >= 5) {
-            cache_ttl = std::stoi(argv[4]);
+        if (args.size() >= 4) {
+            cache_ttl = std::stoi(args[3]);
         }
         
-        if (argc >= 6) {
-            cache_size = std::stoul(argv[5]);
+        if (args.size() >= 5) {
+            cache_size = std::stoul(args[4]);
+        }
+        
+        if (args.size() >= 6) {
+            cache_bytes = std::stoull(args[5]);
+        }
+
+        ParallelScan parallel = ParallelScan::fromOptions(options, "[A]");
+        size_t cache_shards = static_cast<size_t>(std::max(0LL, options.getInt("cache-shards", 0)));
+        int cache_soft_ttl = static_cast<int>(std::max(0LL, options.getInt("cache-soft-ttl", 0)));
+        if (cache_soft_ttl >= cache_ttl) {
+            std::cerr << "[A] ⚠️ --cache-soft-ttl must be below cache_ttl, background refresh disabled" << std::endl;
+            cache_soft_ttl = 0;
         }
+        int shm_ttl = static_cast<int>(std::max(0LL, options.getInt("shm-ttl", cache_ttl)));
+        
+        CacheSnapshotSettings snapshot = CacheSnapshotSettings::fromOptions(options);
         
-        // Register signal handler for cleanup
-        signal(SIGINT, [](int) {
+        // Register signal handler for cleanup. Once serving, the server is
+        // stopped instead, so the cache snapshot can be saved first
+        auto handler = [](int) {
+            if (g_serving) {
+                g_shutdown_requested = true;
+                return;
+            }
             std::cout << "\n[A] Cleaning up shared memory..." << std::endl;
             PosixSharedMemory::destroy("/movie_search_cache");
             std::cout << "[A] Exiting..." << std::endl;
             exit(0);
-        });
+        };
+        signal(SIGINT, handler);
+        signal(SIGTERM, handler);
+        
+        RunServer(server_address, b_address, csv_file, cache_ttl, cache_size, cache_bytes, parallel, cache_shards,
+                  cache_soft_ttl, shm_ttl, snapshot);
         
-        RunServer(server_address, b_address, csv_file, cache_ttl, cache_size);
+        std::cout << "[A] Cleaning up shared memory..." << std::endl;
+        PosixSharedMemory::destroy("/movie_search_cache");
+        std::cout << "[A] Exiting..." << std::endl;
     } catch (const std::exception& e) {
         std::cerr << "[A]  Fatal error: " << e.what() << std::endl;
         return 1;
@@ -8,12 +8,17 @@
 #include <sstream>
 #include <algorithm>
 #include <thread>
+#include <csignal>
 #include <atomic>
-#include <unordered_set>
 #include <grpcpp/grpcpp.h>
 #include "movie.grpc.pb.h"
 #include "movie_struct.h"
-#include "posix_shared_memory.h"
+#include "movie_store.h"
+#include "local_search.h"
+#include "result_payloads.h"
+#include "query_key.h"
+#include "tier_cache.h"
+#include "shm_channel.h"
 #include "response_serializer.h"
 
 using grpc::Server;
@@ -29,47 +34,6 @@ using movie::SearchRequest;
 using movie::SearchResponse;
 using movie::MovieInfo;
 
-// Shared memory structures
-struct SharedRequest {
-    static const int MAX_QUERY_SIZE = 256;
-    char query[MAX_QUERY_SIZE];
-    uint64_t request_id;
-    bool processed;
-};
-
-struct SharedResponse {
-    static const int MAX_RESPONSE_SIZE = 8192;
-    char serialized_response[MAX_RESPONSE_SIZE];
-    size_t response_size;
-    uint64_t request_id;
-    bool valid;
-};
-
-// Helper function to check if a movie matches a query
-bool movieMatchesQuery(const Movie& movie, const std::string& query) {
-    // Convert query and relevant fields to lowercase for case-insensitive comparison
-    std::string lowerQuery = query;
-    std::transform(lowerQuery.begin(), lowerQuery.end(), lowerQuery.begin(), ::tolower);
-
-    std::string lowerTitle = movie.title;
-    std::transform(lowerTitle.begin(), lowerTitle.end(), lowerTitle.begin(), ::tolower);
-
-    std::string lowerGenres = movie.genres;
-    std::transform(lowerGenres.begin(), lowerGenres.end(), lowerGenres.begin(), ::tolower);
-
-    std::string lowerOverview = movie.overview;
-    std::transform(lowerOverview.begin(), lowerOverview.end(), lowerOverview.begin(), ::tolower);
-
-    std::string lowerKeywords = movie.keywords;
-    std::transform(lowerKeywords.begin(), lowerKeywords.end(), lowerKeywords.begin(), ::tolower);
-
-    return
-        lowerTitle.find(lowerQuery) != std::string::npos ||
-        lowerGenres.find(lowerQuery) != std::string::npos ||
-        lowerOverview.find(lowerQuery) != std::string::npos ||
-        lowerKeywords.find(lowerQuery) != std::string::npos;
-}
-
 // ---------- B as gRPC Client to C ----------
 class CClient {
 public:
@@ -213,12 +177,15 @@ private:
 // ---------- B as gRPC Server ----------
 class MovieSearchServiceImpl final : public MovieSearch::Service {
 public:
-    MovieSearchServiceImpl(const std::string& c_address, const std::string& d_address, const std::string& csv_file)
+    MovieSearchServiceImpl(const std::string& c_address, const std::string& d_address, const std::string& csv_file,
+                           const ParallelScan& parallel = ParallelScan(), const TierCache& cache = TierCache())
         : c_client_(grpc::CreateChannel(c_address, grpc::InsecureChannelCredentials())),
-          d_client_(grpc::CreateChannel(d_address, grpc::InsecureChannelCredentials())) {
+          d_client_(grpc::CreateChannel(d_address, grpc::InsecureChannelCredentials())),
+          parallel_(parallel),
+          cache_(cache) {
         try {
-            movies_ = loadMoviesFromCSV(csv_file);
-            std::cout << "[B] Successfully loaded movies from " << csv_file << std::endl;
+            loadLocalMovies(csv_file, "[B]", movies_, index_);
+            results_.build(movies_);
         } catch (const std::exception& e) {
             std::cerr << "[B]  Error loading movies: " << e.what() << std::endl;
         }
@@ -237,26 +204,20 @@ Status Search(ServerContext* context, const SearchRequest* request,
         return Status::OK;
     }
 
-    // Search in B's local data
-    int localMatches = 0;
-    for (const auto& movie : movies_) {
-        if (movieMatchesQuery(movie, query)) {
-            MovieInfo* result = response->add_results();
-            result->set_title(movie.title);
-            result->set_director(movie.production_companies);
-            result->set_genre(movie.genres);
-            
-            // Parse year from release date
-            if (!movie.release_date.empty()) {
-                try {
-                    result->set_year(2000 + std::stoi(movie.release_date.substr(movie.release_date.length() - 2)));
-                } catch (...) {
-                    result->set_year(0); // Default if parsing fails
-                }
-            }
-            localMatches++;
-        }
+    // The query is canonicalized once (fields are lowercased at load time)
+    std::string lowerQuery = QueryKey::canonical(query);
+    
+    // Repeated queries are answered from the result cache, if enabled
+    if (cache_.get(lowerQuery, *response)) {
+        std::cout << "[B] 🎯 Cache hit for query: \"" << query << "\" (" << response->results_size()
+                  << " results)" << std::endl;
+        return Status::OK;
     }
+
+    // Search in B's local data
+    std::vector<uint32_t> matches = findMatchingMovies(movies_, index_, lowerQuery, parallel_);
+    results_.append(matches, response);
+    int localMatches = static_cast<int>(matches.size());
     std::cout << "[B] Found " << localMatches << " matches in local data" << std::endl;
 
     // Store all results in a map to track unique movies (by title)
@@ -269,9 +230,11 @@ Status Search(ServerContext* context, const SearchRequest* request,
     }
 
     // Forward request to C if connected
+    bool complete = c_client_.isConnected() && d_client_.isConnected();
     if (c_client_.isConnected()) {
         std::cout << "[B] Forwarding query to server C: \"" << query << "\"" << std::endl;
         SearchResponse c_response = c_client_.Search(query);
+        complete = complete && c_client_.isConnected();
 
         int cMatches = 0;
         for (const auto& movie : c_response.results()) {
@@ -292,6 +255,7 @@ Status Search(ServerContext* context, const SearchRequest* request,
     if (d_client_.isConnected()) {
         std::cout << "[B] Forwarding query to server D: \"" << query << "\"" << std::endl;
         SearchResponse d_response = d_client_.Search(query);
+        complete = complete && d_client_.isConnected();
 
         int dMatches = 0;
         for (const auto& movie : d_response.results()) {
@@ -314,6 +278,7 @@ Status Search(ServerContext* context, const SearchRequest* request,
         *response->add_results() = pair.second;
     }
 
+    cache_.put(lowerQuery, *response, complete);
     std::cout << "[B] Returning " << response->results_size() << " deduplicated results to server A" << std::endl;
     return Status::OK;
 }
@@ -321,14 +286,21 @@ Status Search(ServerContext* context, const SearchRequest* request,
 private:
     CClient c_client_;
     DClient d_client_;
-    std::vector<Movie> movies_;
+    MovieStore movies_;
+    TrigramIndex index_;
+    ResultPayloads results_;
+    ParallelScan parallel_;
+    TierCache cache_;
 };
 
-// Shared memory listener for Server B
+// Shared memory listener for Server B; several threads take requests from
+// the channel, so concurrent requests from A are answered concurrently
 class SharedMemoryListener {
 public:
-    SharedMemoryListener(MovieSearchServiceImpl* service)
-        : service_(service), running_(false) {}
+    static constexpr int DEFAULT_THREADS = 4;
+
+    SharedMemoryListener(MovieSearchServiceImpl* service, int threads = DEFAULT_THREADS)
+        : service_(service), threads_(std::max(1, threads)), running_(false) {}
 
     ~SharedMemoryListener() {
         Stop();
@@ -338,13 +310,18 @@ public:
         if (running_) return;
 
         try {
-            // Open shared memory segments
-            requests_shm_ = std::make_unique<PosixSharedMemory>("/movie_ab_requests", 1024 * 1024, true);
-            responses_shm_ = std::make_unique<PosixSharedMemory>("/movie_ab_responses", 5 * 1024 * 1024, true);
+            // Open the channel A submits requests to
+            channel_ = std::make_unique<SharedMemoryChannel>("/movie_ab_channel", true);
+            size_t recovered = channel_->recoverTaken();
+            if (recovered > 0) {
+                std::cout << "[B] Failed " << recovered << " requests left unanswered by a previous run" << std::endl;
+            }
 
             running_ = true;
-            listener_thread_ = std::thread(&SharedMemoryListener::ListenerLoop, this);
-            std::cout << "[B] Shared memory listener started" << std::endl;
+            for (int i = 0; i < threads_; i++) {
+                listener_threads_.emplace_back(&SharedMemoryListener::ListenerLoop, this);
+            }
+            std::cout << "[B] Shared memory listener started with " << threads_ << " threads" << std::endl;
         } catch (const std::exception& e) {
             std::cerr << "[B] Failed to initialize shared memory listener: " << e.what() << std::endl;
         }
@@ -352,149 +329,82 @@ public:
 
     void Stop() {
         running_ = false;
-        if (listener_thread_.joinable()) {
-            listener_thread_.join();
+        if (channel_) {
+            channel_->wakeServer();  // Don't wait out the listener's sleep
+        }
+        for (auto& thread : listener_threads_) {
+            thread.join();
         }
+        listener_threads_.clear();
     }
 
 private:
     void ListenerLoop() {
         std::cout << "[B] Shared memory listener thread started" << std::endl;
 
-        // Track which request IDs we've seen
-        std::unordered_set<uint64_t> processed_requests;
-
         while (running_) {
+            SharedMemoryChannel::Request request;
+            bool taken = false;
             try {
-                // Scan for new entries every 100ms
-                auto start_time = std::chrono::steady_clock::now();
-                bool found_new_request = false;
-
-                // Note: In a real implementation, you might want a more efficient
-                // way to discover new requests instead of polling
-                for (uint64_t id = 1; id < 10000; id++) {
-                    std::string key = std::to_string(id);
-
-                    // Skip if we've already processed this request
-                    if (processed_requests.find(id) != processed_requests.end()) {
-                        continue;
-                    }
-
-                    // Check if request exists
-                    std::vector<uint8_t> req_data;
-                    if (requests_shm_->read(key, req_data)) {
-                        if (req_data.size() >= sizeof(SharedRequest)) {
-                            SharedRequest request;
-                            memcpy(&request, req_data.data(), sizeof(SharedRequest));
-
-                            // Skip if already processed
-                            if (request.processed) {
-                                processed_requests.insert(id);
-                                continue;
-                            }
-
-                            found_new_request = true;
-
-                            // Mark as processed
-                            request.processed = true;
-                            memcpy(req_data.data(), &request, sizeof(SharedRequest));
-                            requests_shm_->write(key, req_data);
-
-                            // Process request
-                            std::string query = request.query;
-                            std::cout << "[B] Received shared memory request: \"" << query
-                                    << "\" (ID: " << id << ")" << std::endl;
-
-                            // Special handling for ping
-                            if (query == "__ping__") {
-                                SharedResponse response{};
-                                response.request_id = id;
-                                response.response_size = 0;
-                                response.valid = true;
-
-                                // Write empty response
-                                std::vector<uint8_t> resp_data(sizeof(SharedResponse));
-                                memcpy(resp_data.data(), &response, sizeof(SharedResponse));
-                                responses_shm_->write(key, resp_data);
-                                std::cout << "[B] Responded to ping request" << std::endl;
-
-                                processed_requests.insert(id);
-                                continue;
-                            }
-
-                            // Regular search request
-                            movie::SearchRequest grpc_req;
-                            grpc_req.set_title(query);
-                            movie::SearchResponse grpc_resp;
-                            grpc::ServerContext ctx;
-
-                            // Process using the standard service implementation
-                            service_->Search(&ctx, &grpc_req, &grpc_resp);
-
- // Prepare response
-                            SharedResponse response{};
-                            response.request_id = id;
-                            response.valid = true;
-
-                            // Serialize search response
-                            std::vector<uint8_t> serialized = ResponseSerializer::serialize(grpc_resp);
-                            if (serialized.size() <= SharedResponse::MAX_RESPONSE_SIZE) {
-                                response.response_size = serialized.size();
-                                memcpy(response.serialized_response, serialized.data(), serialized.size());
-                            } else {
-                                std::cerr << "[B] Response too large for shared memory buffer" << std::endl;
-                                response.valid = false;
-                                response.response_size = 0;
-                            }
-
-                            // Write response to shared memory
-                            std::vector<uint8_t> resp_data(sizeof(SharedResponse));
-                            memcpy(resp_data.data(), &response, sizeof(SharedResponse));
-                            responses_shm_->write(key, resp_data);
-
-                            std::cout << "[B] Wrote response with " << grpc_resp.results_size()
-                                     << " results to shared memory" << std::endl;
-
-                            // Remember we've processed this request
-                            processed_requests.insert(id);
-
-                            // Keep processed_requests from growing too large
-                            if (processed_requests.size() > 1000) {
-                                auto oldest = processed_requests.begin();
-                                processed_requests.erase(oldest);
-                            }
-                        }
-                    }
+                // Take the next request in submission order, sleeping until A submits one
+                taken = channel_->waitForRequest(request, std::chrono::milliseconds(100));
+                if (!taken) {
+                    continue;
                 }
 
-                // If no new requests, sleep for a bit
-                if (!found_new_request) {
-                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                std::cout << "[B] Received shared memory request: \"" << request.query
+                          << "\" (ID: " << request.request_id << ")" << std::endl;
+
+                // Special handling for ping
+                if (request.query == "__ping__") {
+                    channel_->complete(request.ticket, nullptr, 0);
+                    std::cout << "[B] Responded to ping request" << std::endl;
+                    continue;
+                }
+
+                // Regular search request
+                movie::SearchRequest grpc_req;
+                grpc_req.set_title(request.query);
+                movie::SearchResponse grpc_resp;
+                grpc::ServerContext ctx;
+
+                // Process using the standard service implementation
+                service_->Search(&ctx, &grpc_req, &grpc_resp);
+
+                // Serialize search response into the request's completion slot
+                std::vector<uint8_t> serialized = ResponseSerializer::serialize(grpc_resp);
+                if (channel_->complete(request.ticket, serialized.data(), serialized.size())) {
+                    std::cout << "[B] Wrote response with " << grpc_resp.results_size()
+                              << " results to shared memory" << std::endl;
                 }
             } catch (const std::exception& e) {
                 std::cerr << "[B] Error in shared memory listener: " << e.what() << std::endl;
+                if (taken) {
+                    channel_->complete(request.ticket, nullptr, 0, false);  // Don't leave A waiting
+                }
                 std::this_thread::sleep_for(std::chrono::seconds(1));
             }
         }
     }
 
     MovieSearchServiceImpl* service_;
-    std::unique_ptr<PosixSharedMemory> requests_shm_;
-    std::unique_ptr<PosixSharedMemory> responses_shm_;
-    std::thread listener_thread_;
+    int threads_;
+    std::unique_ptr<SharedMemoryChannel> channel_;
+    std::vector<std::thread> listener_threads_;
     std::atomic<bool> running_;
 };
 
 void RunServer(const std::string& server_address, const std::string& c_address,
-               const std::string& d_address, const std::string& csv_file) {
+               const std::string& d_address, const std::string& csv_file,
+               const ParallelScan& parallel, const TierCache& cache, int shm_listeners) {
     std::cout << "[B] Starting server on " << server_address << std::endl;
     std::cout << "[B] Will connect to server C at " << c_address << std::endl;
     std::cout << "[B] Will connect to server D at " << d_address << std::endl;
 
-    MovieSearchServiceImpl service(c_address, d_address, csv_file);
+    MovieSearchServiceImpl service(c_address, d_address, csv_file, parallel, cache);
 
     // Start shared memory listener
-    SharedMemoryListener shm_listener(&service);
+    SharedMemoryListener shm_listener(&service, shm_listeners);
     shm_listener.Start();
 
     ServerBuilder builder;
@@ -514,17 +424,26 @@ void RunServer(const std::string& server_address, const std::string& c_address,
 }
 
 int main(int argc, char** argv) {
-    if (argc != 5) {
-        std::cerr << "Usage: ./B_server <listen_address> <C_address> <D_address> <csv_file>" << std::endl;
+    ServerOptions options(argc, argv);
+    const std::vector<std::string>& args = options.positional();
+
+    if (args.size() != 4) {
+        std::cerr << "Usage: ./B_server <listen_address> <C_address> <D_address> <csv_or_snapshot_file> "
+                  << "[--search-threads=N] [--parallel-threshold=ROWS] "
+                  << "[--cache-size=N] [--cache-ttl=SECONDS] [--negative-ttl=SECONDS] "
+                  << "[--shm-listeners=N]" << std::endl;
         std::cerr << "Example: ./B_server 0.0.0.0:50002 localhost:50003 localhost:50004 movies.csv" << std::endl;
         return 1;
     }
 
     try {
-        std::string b_addr = argv[1]; // e.g., 0.0.0.0:5002
-        std::string c_addr = argv[2]; // e.g., 192.168.0.4:5003
-        std::string d_addr = argv[3]; // e.g., 192.168.0.4:5004
-        std::string csv_file = argv[4]; // e.g., b_movies.csv
+        std::string b_addr = args[0]; // e.g., 0.0.0.0:5002
+        std::string c_addr = args[1]; // e.g., 192.168.0.4:5003
+        std::string d_addr = args[2]; // e.g., 192.168.0.4:5004
+        std::string csv_file = args[3]; // e.g., b_movies.csv
+        ParallelScan parallel = ParallelScan::fromOptions(options, "[B]");
+        TierCache cache = TierCache::fromOptions(options, "[B]");
+        int shm_listeners = static_cast<int>(options.getInt("shm-listeners", SharedMemoryListener::DEFAULT_THREADS));
 
         // Register signal handler for cleanup
         signal(SIGINT, [](int) {
@@ -532,7 +451,7 @@ int main(int argc, char** argv) {
             exit(0);
         });
 
-        RunServer(b_addr, c_addr, d_addr, csv_file);
+        RunServer(b_addr, c_addr, d_addr, csv_file, parallel, cache, shm_listeners);
     } catch (const std::exception& e) {
         std::cerr << "[B]  Fatal error: " << e.what() << std::endl;
         return 1;
@@ -8,6 +8,12 @@
 #include <grpcpp/grpcpp.h>
 #include "movie.grpc.pb.h"
 #include "movie_struct.h" // Include our movie structure header
+#include "movie_store.h" // Include our columnar movie storage
+#include "local_search.h" // Include our trigram index and parallel local search
+#include "result_payloads.h" // Include our prebuilt search results
+#include "query_key.h" // Include our canonical query keys
+#include "tier_cache.h" // Include our optional result cache
+#include "raw_search_service.h" // Include our serialized-reply search service
 
 using grpc::Server;
 using grpc::ServerBuilder;
@@ -22,31 +28,6 @@ using movie::SearchRequest;
 using movie::SearchResponse;
 using movie::MovieInfo;
 
-// Helper function to check if a movie matches a query
-bool movieMatchesQuery(const Movie& movie, const std::string& query) {
-    // Convert query and relevant fields to lowercase for case-insensitive comparison
-    std::string lowerQuery = query;
-    std::transform(lowerQuery.begin(), lowerQuery.end(), lowerQuery.begin(), ::tolower);
-    
-    std::string lowerTitle = movie.title;
-    std::transform(lowerTitle.begin(), lowerTitle.end(), lowerTitle.begin(), ::tolower);
-    
-    std::string lowerGenres = movie.genres;
-    std::transform(lowerGenres.begin(), lowerGenres.end(), lowerGenres.begin(), ::tolower);
-    
-    std::string lowerOverview = movie.overview;
-    std::transform(lowerOverview.begin(), lowerOverview.end(), lowerOverview.begin(), ::tolower);
-    
-    std::string lowerKeywords = movie.keywords;
-    std::transform(lowerKeywords.begin(), lowerKeywords.end(), lowerKeywords.begin(), ::tolower);
-    
-    return 
-        lowerTitle.find(lowerQuery) != std::string::npos ||
-        lowerGenres.find(lowerQuery) != std::string::npos ||
-        lowerOverview.find(lowerQuery) != std::string::npos ||
-        lowerKeywords.find(lowerQuery) != std::string::npos;
-}
-
 // ---------- C as gRPC Client to E ----------
 class EClient {
 public:
@@ -118,80 +99,92 @@ private:
 };
 
 // ---------- C as gRPC Server ----------
-class MovieSearchServiceImpl final : public MovieSearch::Service {
+class MovieSearchServiceImpl final : public RawSearchService {
 public:
-    MovieSearchServiceImpl(const std::string& e_address, const std::string& csv_file)
-        : e_client_(grpc::CreateChannel(e_address, grpc::InsecureChannelCredentials())) {
+    MovieSearchServiceImpl(const std::string& e_address, const std::string& csv_file,
+                           const ParallelScan& parallel = ParallelScan(), const TierCache& cache = TierCache())
+        : e_client_(grpc::CreateChannel(e_address, grpc::InsecureChannelCredentials())),
+          parallel_(parallel),
+          cache_(cache) {
         try {
-            movies_ = loadMoviesFromCSV(csv_file);
-            std::cout << "[C] Successfully loaded movies from " << csv_file << std::endl;
+            loadLocalMovies(csv_file, "[C]", movies_, index_);
+            results_.build(movies_);
         } catch (const std::exception& e) {
             std::cerr << "[C]  Error loading movies: " << e.what() << std::endl;
         }
     }
 
     Status Search(ServerContext* context, const SearchRequest* request,
-                  SearchResponse* response) override {
+                  grpc::ByteBuffer* reply) override {
         std::string query = request->title();
         std::cout << "[C] Received query: \"" << query << "\"" << std::endl;
         
         // Special case for ping
         if (query == "__ping__") {
             std::cout << "[C] Received ping request, sending empty response" << std::endl;
+            *reply = serialize(SearchResponse());
             return Status::OK;
         }
 
-        // Search in C's local data
-        int localMatches = 0;
-        for (const auto& movie : movies_) {
-            if (movieMatchesQuery(movie, query)) {
-                MovieInfo* result = response->add_results();
-                result->set_title(movie.title);
-                result->set_director(movie.production_companies); // Using production companies as "director"
-                result->set_genre(movie.genres);
-                
-                // Parse year from release date (format: MM/DD/YY)
-                if (!movie.release_date.empty()) {
-                    try {
-                        result->set_year(2000 + std::stoi(movie.release_date.substr(movie.release_date.length() - 2)));
-                    } catch (...) {
-                        result->set_year(0); // Default if parsing fails
-                    }
-                }
-                localMatches++;
-            }
+        // The query is canonicalized once (fields are lowercased at load time)
+        std::string lowerQuery = QueryKey::canonical(query);
+        
+        // Repeated queries are answered from the result cache, if enabled
+        CachedResponsePtr cached = cache_.get(lowerQuery);
+        if (cached) {
+            *reply = cached->buffer();
+            std::cout << "[C] 🎯 Cache hit for query: \"" << query << "\" (" << cached->size()
+                      << " bytes)" << std::endl;
+            return Status::OK;
         }
+
+        // Search in C's local data
+        std::vector<uint32_t> matches = findMatchingMovies(movies_, index_, lowerQuery, parallel_);
+        int localMatches = static_cast<int>(matches.size());
         std::cout << "[C] Found " << localMatches << " matches in local data" << std::endl;
 
+        // The reply starts with the matches' prebuilt bytes; E's results follow
+        std::string bytes;
+        results_.appendTo(matches, &bytes);
+
         // Forward request to E if connected
+        bool complete = false;
+        int eMatches = 0;
         if (e_client_.isConnected()) {
             std::cout << "[C] Forwarding query to server E: \"" << query << "\"" << std::endl;
             SearchResponse e_response = e_client_.Search(query);
+            complete = e_client_.isConnected();
 
-            int eMatches = 0;
-            for (const auto& movie : e_response.results()) {
-                *response->add_results() = movie;
-                eMatches++;
-            }
+            e_response.AppendToString(&bytes);
+            eMatches = e_response.results_size();
             std::cout << "[C] Added " << eMatches << " results from server E" << std::endl;
         } else {
             std::cerr << "[C] ⚠️ Skipping forward to server E - connection is down" << std::endl;
         }
 
-        std::cout << "[C] Returning " << response->results_size() << " total results to server B" << std::endl;
+        // The same bytes are cached and sent
+        auto entry = std::make_shared<const CachedResponse>(std::move(bytes));
+        cache_.put(lowerQuery, entry, complete);
+        *reply = entry->buffer();
+        std::cout << "[C] Returning " << localMatches + eMatches << " total results to server B" << std::endl;
         return Status::OK;
     }
 
 private:
     EClient e_client_;
-    std::vector<Movie> movies_;
+    MovieStore movies_;
+    TrigramIndex index_;
+    ResultPayloads results_;
+    ParallelScan parallel_;
+    TierCache cache_;
 };
 
-void RunServer(const std::string& server_address, const std::string& e_address, const std::string& csv_file) {
+void RunServer(const std::string& server_address, const std::string& e_address, const std::string& csv_file,
+               const ParallelScan& parallel, const TierCache& cache) {
     std::cout << "[C] Starting server on " << server_address << std::endl;
     std::cout << "[C] Will connect to server E at " << e_address << std::endl;
     
-    MovieSearchServiceImpl service(e_address, csv_file);
+    MovieSearchServiceImpl service(e_address, csv_file, parallel, cache);
 
     ServerBuilder builder;
     builder.AddListeningPort(server_address, grpc::InsecureServerCredentials());
@@ -207,18 +200,25 @@ void RunServer(const std::string& server_address, const std::string& e_address,
 }
 
 int main(int argc, char** argv) {
-    if (argc != 4) {
-        std::cerr << "Usage: ./C_server <listen_address> <E_address> <csv_file>" << std::endl;
+    ServerOptions options(argc, argv);
+    const std::vector<std::string>& args = options.positional();
+
+    if (args.size() != 3) {
+        std::cerr << "Usage: ./C_server <listen_address> <E_address> <csv_or_snapshot_file> "
+                  << "[--search-threads=N] [--parallel-threshold=ROWS] "
+                  << "[--cache-size=N] [--cache-ttl=SECONDS] [--negative-ttl=SECONDS]" << std::endl;
         std::cerr << "Example: ./C_server 0.0.0.0:50003 localhost:50005 movies.csv" << std::endl;
         return 1;
     }
 
     try {
-        std::string c_addr = argv[1]; // e.g., 0.0.0.0:5003
-        std::string e_addr = argv[2]; // e.g., 192.168.0.5:5005
-        std::string csv_file = argv[3]; // e.g., c_movies.csv
+        std::string c_addr = args[0]; // e.g., 0.0.0.0:5003
+        std::string e_addr = args[1]; // e.g., 192.168.0.5:5005
+        std::string csv_file = args[2]; // e.g., c_movies.csv
+        ParallelScan parallel = ParallelScan::fromOptions(options, "[C]");
+        TierCache cache = TierCache::fromOptions(options, "[C]");
         
-        RunServer(c_addr, e_addr, csv_file);
+        RunServer(c_addr, e_addr, csv_file, parallel, cache);
     } catch (const std::exception& e) {
         std::cerr << "[C]  Fatal error: " << e.what() << std::endl;
         return 1;
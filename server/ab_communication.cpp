@@ -13,7 +13,7 @@
 std::unique_ptr<BServerCommunication> BServerCommunication::Create(const std::string& b_address) {
     if (IsLocalAddress(b_address)) {
         std::cout << "[A] Server B is on local machine, using shared memory communication" << std::endl;
-        return std::make_unique<SharedMemoryBCommunication>();
+        return std::make_unique<SharedMemoryBCommunication>(b_address);
     } else {
         std::cout << "[A] Server B is on remote machine, using gRPC communication" << std::endl;
         return std::make_unique<GrpcBCommunication>(b_address);
@@ -71,29 +71,42 @@ GrpcBCommunication::GrpcBCommunication(const std::string& b_address)
         connected_ = true;
     } else {
         std::cerr << "[A]  Failed to connect to server B: "
-                 << status.error_message() << std::endl;
+                 << status.error_message()
+                 << " (code: " << status.error_code() << ")" << std::endl;
+        if (status.error_code() == grpc::StatusCode::UNAVAILABLE) {
+            std::cerr << "[A] 🔍 This usually means server B is not running or the address is incorrect" << std::endl;
+        }
         connected_ = false;
     }
 }
 
-movie::SearchResponse GrpcBCommunication::Search(const std::string& query) {
+bool GrpcBCommunication::Search(const std::string& query, movie::SearchResponse& response) {
     movie::SearchRequest request;
     request.set_title(query);
-    movie::SearchResponse response;
     grpc::ClientContext context;
 
+    // Set a timeout for the request (5 seconds)
+    context.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(5));
+
     std::cout << "[A] Sending gRPC request to server B: \"" << query << "\"" << std::endl;
     grpc::Status status = stub_->Search(&context, request, &response);
 
     if (!status.ok()) {
-        std::cerr << "[A → B] gRPC call failed: " << status.error_message() << std::endl;
+        std::cerr << "[A → B] gRPC call failed: " << status.error_message()
+                  << " (code: " << status.error_code() << ")" << std::endl;
+
+        if (status.error_code() == grpc::StatusCode::DEADLINE_EXCEEDED) {
+            std::cerr << "[A] 🕒 Request timed out. Server B might be overloaded or unresponsive." << std::endl;
+        } else if (status.error_code() == grpc::StatusCode::UNAVAILABLE) {
+            std::cerr << "[A] 🔌 Server B is unavailable. Network issue or server not running." << std::endl;
+        }
         connected_ = false;
-    } else {
-        connected_ = true;
-        std::cout << "[A] Received " << response.results_size() << " results from server B" << std::endl;
+        return false;
     }
 
-    return response;
+    connected_ = true;
+    std::cout << "[A] Received " << response.results_size() << " results from server B" << std::endl;
+    return true;
 }
 
 bool GrpcBCommunication::IsConnected() const {
@@ -101,130 +114,102 @@ bool GrpcBCommunication::IsConnected() const {
 }
 
 // Shared Memory Implementation
-SharedMemoryBCommunication::SharedMemoryBCommunication() {
+SharedMemoryBCommunication::SharedMemoryBCommunication(const std::string& b_address)
+    : grpc_(b_address) {
+    // B's listener is only worth trying if B is up at all
+    if (!grpc_.IsConnected()) {
+        std::cerr << "[A]  Server B is not reachable, not trying shared memory" << std::endl;
+        return;
+    }
+
     try {
-        // Create shared memory segments
-        requests_shm_ = std::make_unique<PosixSharedMemory>("/movie_ab_requests", 64 * 1024);
-        responses_shm_ = std::make_unique<PosixSharedMemory>("/movie_ab_responses", 256 * 1024);
+        // Open the channel B's listener takes requests from
+        channel_ = std::make_unique<SharedMemoryChannel>("/movie_ab_channel", true);
 
         // Test connection
         std::cout << "[A] Testing shared memory connection to server B..." << std::endl;
 
         // Send ping request
-        uint64_t ping_id = next_request_id_++;
-        SharedRequest ping_req{};
-        strncpy(ping_req.query, "__ping__", SharedRequest::MAX_QUERY_SIZE);
-        ping_req.request_id = ping_id;
-        ping_req.processed = false;
-
-        // Serialize and store in shared memory
-        std::vector<uint8_t> req_data(sizeof(SharedRequest));
-        memcpy(req_data.data(), &ping_req, sizeof(SharedRequest));
-
-        // Write ping to shared memory
-        if (!requests_shm_->write(std::to_string(ping_id), req_data)) {
+        uint64_t ticket;
+        if (!channel_->submit("__ping__", next_request_id_++, ticket)) {
             std::cerr << "[A]  Failed to write ping request to shared memory" << std::endl;
             connected_ = false;
             return;
         }
 
-        // Wait for response
-        SharedResponse ping_resp{};
-        if (WaitForResponse(ping_id, ping_resp)) {
+        // Wait for response; B is up, so only a B without the listener takes long
+        std::vector<uint8_t> pong;
+        if (WaitForResponse(ticket, pong, PING_TIMEOUT_MS) == SharedMemoryChannel::POLL_READY) {
             std::cout << "[A] Successfully connected to server B via shared memory" << std::endl;
             connected_ = true;
         } else {
-            std::cerr << "[A]  No response from server B via shared memory" << std::endl;
+            std::cerr << "[A]  No response from server B via shared memory, using gRPC" << std::endl;
             connected_ = false;
         }
     } catch (const std::exception& e) {
-        std::cerr << "[A]  Failed to initialize shared memory: " << e.what() << std::endl;
+        std::cerr << "[A]  Failed to initialize shared memory: " << e.what() << ", using gRPC" << std::endl;
         connected_ = false;
     }
 }
 
-movie::SearchResponse SharedMemoryBCommunication::Search(const std::string& query) {
-    movie::SearchResponse response;
-
+bool SharedMemoryBCommunication::Search(const std::string& query, movie::SearchResponse& response) {
     if (!connected_) {
-        std::cerr << "[A] Cannot search - not connected to Server B via shared memory" << std::endl;
-        return response;
+        return grpc_.Search(query, response);
     }
 
     try {
-        // Create request
         uint64_t req_id = next_request_id_++;
-        SharedRequest request{};
-        strncpy(request.query, query.c_str(), SharedRequest::MAX_QUERY_SIZE - 1);
-        request.request_id = req_id;
-        request.processed = false;
-
-        // Serialize and store in shared memory
-        std::vector<uint8_t> req_data(sizeof(SharedRequest));
-        memcpy(req_data.data(), &request, sizeof(SharedRequest));
-
         std::cout << "[A] Sending shared memory request to server B: \"" << query
                   << "\" (ID: " << req_id << ")" << std::endl;
 
-        // Write request to shared memory
-        if (!requests_shm_->write(std::to_string(req_id), req_data)) {
-            std::cerr << "[A]  Failed to write request to shared memory" << std::endl;
-            connected_ = false;
-            return response;
+        // Queue the request
+        uint64_t ticket;
+        if (!channel_->submit(query, req_id, ticket)) {
+            std::cerr << "[A]  All shared memory slots busy, sending \"" << query << "\" via gRPC" << std::endl;
+            return grpc_.Search(query, response);
         }
 
         // Wait for response
-        SharedResponse resp{};
-        if (WaitForResponse(req_id, resp)) {
-            // Deserialize response
-            std::vector<uint8_t> resp_data(resp.serialized_response,
-                                          resp.serialized_response + resp.response_size);
-            ResponseSerializer::deserialize(resp_data, response);
-
-            std::cout << "[A] Received " << response.results_size()
-                      << " results from server B via shared memory" << std::endl;
-        } else {
-            std::cerr << "[A]  Timeout waiting for response from server B" << std::endl;
-            connected_ = false;
+        std::vector<uint8_t> resp_data;
+        switch (WaitForResponse(ticket, resp_data)) {
+            case SharedMemoryChannel::POLL_READY:
+                // Deserialize response; a payload that doesn't parse is no answer
+                if (!ResponseSerializer::deserialize(resp_data, response)) {
+                    std::cerr << "[A]  Unreadable response from server B for \"" << query
+                              << "\" via shared memory" << std::endl;
+                    response.Clear();
+                    return false;
+                }
+                std::cout << "[A] Received " << response.results_size()
+                          << " results from server B via shared memory" << std::endl;
+                return true;
+            case SharedMemoryChannel::POLL_FAILED:
+                // Only this request failed; the link is fine
+                std::cerr << "[A]  Server B could not answer \"" << query << "\" via shared memory" << std::endl;
+                return false;
+            case SharedMemoryChannel::POLL_PENDING:
+                std::cerr << "[A]  Timeout waiting for response from server B, using gRPC from now on" << std::endl;
+                connected_ = false;
+                return false;
         }
     } catch (const std::exception& e) {
         std::cerr << "[A]  Error in shared memory communication: " << e.what() << std::endl;
         connected_ = false;
     }
-
-    return response;
+    return false;
 }
 
 bool SharedMemoryBCommunication::IsConnected() const {
-    return connected_;
+    return connected_ || grpc_.IsConnected();
 }
 
-bool SharedMemoryBCommunication::WaitForResponse(uint64_t request_id, SharedResponse& response, int timeout_ms) {
-    std::string resp_key = std::to_string(request_id);
-    auto start_time = std::chrono::steady_clock::now();
-
-    while (std::chrono::duration_cast<std::chrono::milliseconds>(
-           std::chrono::steady_clock::now() - start_time).count() < timeout_ms) {
-
-        // Check for response
-        std::vector<uint8_t> resp_data;
-        if (responses_shm_->read(resp_key, resp_data)) {
-            // Found response
-            if (resp_data.size() >= sizeof(SharedResponse)) {
-                memcpy(&response, resp_data.data(), sizeof(SharedResponse));
-
-                // Validate it's the response we're waiting for
-                if (response.request_id == request_id && response.valid) {
-                    // Remove from shared memory to clean up
-                    responses_shm_->remove(resp_key);
-                    return true;
-                }
-            }
-        }
-
-        // Sleep briefly before checking again
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+SharedMemoryChannel::PollResult SharedMemoryBCommunication::WaitForResponse(uint64_t ticket,
+                                                                           std::vector<uint8_t>& response,
+                                                                           int timeout_ms) {
+    // Spins briefly, then sleeps until B completes the request
+    SharedMemoryChannel::PollResult result = channel_->wait(ticket, response, std::chrono::milliseconds(timeout_ms));
+    if (result == SharedMemoryChannel::POLL_PENDING) {
+        channel_->abandon(ticket);
     }
-
-    return false;
-}
\ No newline at end of file
+    return result;
+}
@@ -7,34 +7,20 @@
 #include <atomic>
 #include <grpcpp/grpcpp.h>
 #include "movie.grpc.pb.h"
-#include "posix_shared_memory.h"
-
-// Structure for request-response via shared memory
-struct SharedRequest {
-    static const int MAX_QUERY_SIZE = 256;
-    char query[MAX_QUERY_SIZE];
-    uint64_t request_id;
-    bool processed;
-};
-
-struct SharedResponse {
-    static const int MAX_RESPONSE_SIZE = 8192;
-    char serialized_response[MAX_RESPONSE_SIZE];
-    size_t response_size;
-    uint64_t request_id;
-    bool valid;
-};
+#include "shm_channel.h"
 
 // Communication interface to Server B (abstracts gRPC or shared memory)
 class BServerCommunication {
 public:
-    // Factory method that creates appropriate implementation
+    // Factory method that creates appropriate implementation: shared memory
+    // when B runs on this machine and answers on it, gRPC otherwise
     static std::unique_ptr<BServerCommunication> Create(const std::string& b_address);
 
     virtual ~BServerCommunication() = default;
 
-    // Send search request to Server B
-    virtual movie::SearchResponse Search(const std::string& query) = 0;
+    // Send search request to Server B; returns whether B answered, and only
+    // then does `response` hold all of B's results
+    virtual bool Search(const std::string& query, movie::SearchResponse& response) = 0;
 
     // Check if connection to Server B is working
     virtual bool IsConnected() const = 0;
@@ -44,29 +30,33 @@ public:
 class GrpcBCommunication : public BServerCommunication {
 public:
     GrpcBCommunication(const std::string& b_address);
-    movie::SearchResponse Search(const std::string& query) override;
+    bool Search(const std::string& query, movie::SearchResponse& response) override;
     bool IsConnected() const override;
 
 private:
     std::unique_ptr<movie::MovieSearch::Stub> stub_;
-    bool connected_ = false;
+    std::atomic<bool> connected_{false};
 };
 
-// Shared memory based implementation
+// Shared memory based implementation. Requests go over gRPC instead while
+// the channel is down or full.
 class SharedMemoryBCommunication : public BServerCommunication {
 public:
-    SharedMemoryBCommunication();
-    movie::SearchResponse Search(const std::string& query) override;
+    SharedMemoryBCommunication(const std::string& b_address);
+    bool Search(const std::string& query, movie::SearchResponse& response) override;
     bool IsConnected() const override;
 
 private:
-    std::unique_ptr<PosixSharedMemory> requests_shm_;
-    std::unique_ptr<PosixSharedMemory> responses_shm_;
+    GrpcBCommunication grpc_;
+    std::unique_ptr<SharedMemoryChannel> channel_;
     std::atomic<uint64_t> next_request_id_{1};
-    bool connected_ = false;
+    std::atomic<bool> connected_{false};  // Written by concurrent Search() calls
+    static constexpr int PING_TIMEOUT_MS = 1000;
 
-    // Wait for response with matching request ID
-    bool WaitForResponse(uint64_t request_id, SharedResponse& response, int timeout_ms = 5000);
+    // Wait for the response to a submitted request; gives the ticket up on
+    // timeout (POLL_PENDING). POLL_FAILED only fails this request.
+    SharedMemoryChannel::PollResult WaitForResponse(uint64_t ticket, std::vector<uint8_t>& response,
+                                                    int timeout_ms = 5000);
 };
 
 // Function to check if address is local
@@ -8,101 +8,237 @@
 #include <list>
 #include <memory>
 #include <atomic>
+#include <iostream>
+#include <iterator>
+#include <functional>
+#include <vector>
+#include <algorithm>
 #include "movie.grpc.pb.h"
+#include "cached_response.h"
+#include "frequency_sketch.h"
 
+/**
+ * Thread-safe query result cache with a TTL and LRU eviction.
+ *
+ * Entries live in a list ordered by recency, and the hash map stores each
+ * entry's list iterator, so lookup, promotion and eviction are all O(1).
+ * Expiry is lazy: an entry is checked when it is read, and expired entries
+ * at the cold end of the list are dropped when new entries are stored.
+ * No operation walks the whole cache, so hit latency doesn't grow with
+ * max_size. Expired entries that are never touched again still count
+ * towards size() until they are evicted.
+ *
+ * Values are immutable CachedResponse objects. A hit hands out a shared
+ * reference instead of copying the response.
+ *
+ * With a byte budget (max_bytes > 0), each entry is charged its serialized
+ * size plus its key, and admission follows W-TinyLFU. New entries go to a
+ * small LRU window (WINDOW_PERCENT of the budget). When the window
+ * overflows, its oldest entry may enter the main LRU area only if a
+ * FrequencySketch estimates it is accessed more often than each main-area
+ * victim it would displace; otherwise it is dropped. One-off queries and
+ * scans therefore churn through the window without evicting the hot set.
+ * The max_size entry limit still applies in both modes; when budgeted, the
+ * window also holds at most WINDOW_PERCENT of max_size entries (at least
+ * one), so an entry limit that binds before the byte budget goes through
+ * the same admission.
+ *
+ * An optional soft TTL marks entries stale before they expire. Stale
+ * entries are still returned (and reported as stale) so the caller can
+ * serve them at once and refresh them in the background; only the hard
+ * TTL removes them.
+ *
+ * Each entry counts its hits, so the hottest entries can be exported with
+ * their age (hottest()) and put back after a restart (restore()).
+ */
 class Cache {
 public:
+    static constexpr size_t WINDOW_PERCENT = 1;  // Share of the byte budget that admits everything
+    static constexpr size_t MIN_SKETCH_KEYS = 1024;  // Smaller sketches saturate after one short scan
+
+    /**
+     * An entry as exported by hottest() and accepted by restore()
+     */
+    struct Record {
+        std::string query;
+        CachedResponsePtr response;
+        uint64_t age_ms;  // Time since the response was stored
+        uint64_t hits;    // Hits since the query was cached
+    };
+
     /**
      * Constructor
      * @param ttl_seconds Time-to-live for cache entries in seconds
      * @param max_size Maximum number of entries in the cache
+     * @param max_bytes Byte budget for keys and serialized responses (0 = entry limit only)
+     * @param soft_ttl_seconds Age after which entries are reported stale (0 = never)
      */
-    explicit Cache(int ttl_seconds = 300, size_t max_size = 100)
+    explicit Cache(int ttl_seconds = 300, size_t max_size = 100, size_t max_bytes = 0, int soft_ttl_seconds = 0)
         : ttl_(std::chrono::seconds(ttl_seconds)), 
+          soft_ttl_(std::chrono::seconds(soft_ttl_seconds)), 
           max_size_(max_size), 
+          max_bytes_(max_bytes),
+          window_bytes_budget_(max_bytes * WINDOW_PERCENT / 100),
+          window_entries_budget_(std::max<size_t>(1, max_size * WINDOW_PERCENT / 100)),
           hit_count_(0), 
-          miss_count_(0) {}
+          miss_count_(0),
+          derived_hit_count_(0),
+          stale_hit_count_(0),
+          rejected_count_(0) {
+        if (max_bytes_ > 0) {
+            sketch_ = std::make_unique<FrequencySketch>(std::max(max_size_, MIN_SKETCH_KEYS));
+        }
+    }
 
     /**
-     * Try to get result from cache
+     * Try to get result from cache without copying it
      * @param query The search query
-     * @param response The response to populate (if cache hit)
-     * @return Whether the item was found in cache (cache hit)
+     * @param stale Set to whether the entry is past the soft TTL (optional)
+     * @return The shared cached response, or null on a cache miss
      */
-    bool get(const std::string& query, movie::SearchResponse& response) {
+    CachedResponsePtr get(const std::string& query, bool* stale = nullptr) {
         std::lock_guard<std::mutex> lock(mutex_);
-        
-        // Clean expired entries first
-        clean_expired();
+        if (sketch_) {
+            sketch_->increment(keyHash(query));
+        }
         
         auto it = cache_.find(query);
         if (it == cache_.end()) {
             // Cache miss
             miss_count_++;
-            return false;
+            return nullptr;
         }
         
         // Check if entry is expired
-        if (std::chrono::system_clock::now() - it->second.timestamp > ttl_) {
+        auto entry = it->second;
+        auto now = std::chrono::steady_clock::now();
+        if (expired(*entry, now)) {
             // Remove expired entry
-            cache_.erase(it);
-            lru_list_.remove(query);
+            removeEntry(entry);
             miss_count_++;
-            return false;
+            return nullptr;
         }
         
         // Update LRU position (move to front)
-        lru_list_.remove(query);
-        lru_list_.push_front(query);
+        EntryList& list = listOf(*entry);
+        list.splice(list.begin(), list, entry);
         
         // Return cached results
-        response = *(it->second.response);
+        entry->hits++;
         hit_count_++;
-        return true;
+        bool is_stale = soft_ttl_.count() > 0 && now - entry->timestamp > soft_ttl_;
+        if (is_stale) {
+            stale_hit_count_++;
+        }
+        if (stale) {
+            *stale = is_stale;
+        }
+        return entry->response;
+    }
+
+    /**
+     * Try to get result from cache as a message (parses a copy; replies
+     * should use get(query) and send the cached buffer)
+     * @param query The search query
+     * @param response The response to populate (if cache hit)
+     * @return Whether the item was found in cache (cache hit)
+     */
+    bool get(const std::string& query, movie::SearchResponse& response) {
+        CachedResponsePtr cached = get(query);
+        return cached && cached->parseTo(response);
+    }
+
+    /**
+     * Look at an entry without counting a hit or miss or refreshing it
+     * (used to find results another query can be derived from)
+     * @param query The search query
+     * @return The shared cached response, or null if absent or expired
+     */
+    CachedResponsePtr peek(const std::string& query) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = cache_.find(query);
+        if (it == cache_.end() || expired(*it->second, std::chrono::steady_clock::now())) {
+            return nullptr;
+        }
+        return it->second->response;
+    }
+
+    /**
+     * Count a miss that was answered from another query's cached result
+     */
+    void recordDerivedHit() {
+        derived_hit_count_++;
     }
 
     /**
      * Store result in cache
      * @param query The search query
-     * @param response The response to cache
+     * @param response The response to cache (serialized once here)
      */
     void put(const std::string& query, const movie::SearchResponse& response) {
+        put(query, std::make_shared<const CachedResponse>(response));
+    }
+
+    /**
+     * Store a serialized result in cache
+     * @param query The search query
+     * @param payload The shared response to cache
+     */
+    void put(const std::string& query, CachedResponsePtr payload) {
         std::lock_guard<std::mutex> lock(mutex_);
-        
-        // Clean expired entries first
-        clean_expired();
-        
-        // If entry already exists, update it
-        auto it = cache_.find(query);
-        if (it != cache_.end()) {
-            // Update existing entry
-            it->second.timestamp = std::chrono::system_clock::now();
-            it->second.response = std::make_shared<movie::SearchResponse>(response);
-            
-            // Move to front of LRU list
-            lru_list_.remove(query);
-            lru_list_.push_front(query);
-            return;
+        store(query, std::move(payload), std::chrono::steady_clock::duration::zero(), 0);
+    }
+    
+    /**
+     * Get the most frequently hit live entries, e.g. to snapshot them.
+     * Entries with as many hits are ordered most recently used first.
+     * @param limit Maximum number of entries
+     * @return Up to `limit` entries, hottest first
+     */
+    std::vector<Record> hottest(size_t limit) const {
+        auto now = std::chrono::steady_clock::now();
+        std::vector<Record> records;
+        std::lock_guard<std::mutex> lock(mutex_);
+        records.reserve(cache_.size());
+        for (const EntryList* list : {&lru_list_, &window_list_}) {
+            for (const CacheEntry& entry : *list) {
+                if (!expired(entry, now)) {
+                    auto age = std::chrono::duration_cast<std::chrono::milliseconds>(now - entry.timestamp);
+                    records.push_back(Record{entry.query, entry.response, static_cast<uint64_t>(age.count()), entry.hits});
+                }
+            }
         }
-        
-        // If we're at capacity, remove least recently used
-        if (cache_.size() >= max_size_ && !lru_list_.empty()) {
-            // Remove least recently used entry
-            const std::string& oldest = lru_list_.back();
-            std::cout << "Evicting oldest entry: " << oldest << std::endl;
-            cache_.erase(oldest);
-            lru_list_.pop_back();
+        std::stable_sort(records.begin(), records.end(),
+                         [](const Record& a, const Record& b) { return a.hits > b.hits; });
+        records.resize(std::min(limit, records.size()));
+        return records;
+    }
+    
+    /**
+     * Put back an entry exported by hottest(), keeping its age and hits.
+     * The hits also seed the admission sketch. Entries that have expired
+     * since, or whose query is cached already, are skipped.
+     * @param record The exported entry
+     * @return Whether the entry was stored
+     */
+    bool restore(const Record& record) {
+        auto age = std::chrono::milliseconds(record.age_ms);
+        if (age > ttl_) {
+            return false;
         }
-        
-        // Add new entry
-        CacheEntry entry;
-        entry.timestamp = std::chrono::system_clock::now();
-        entry.response = std::make_shared<movie::SearchResponse>(response);
-        
-        cache_[query] = std::move(entry);
-        
-        // Add to front of LRU list
-        lru_list_.push_front(query);
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (cache_.count(record.query) > 0) {
+            return false;
+        }
+        if (sketch_) {
+            // The sketch's doorkeeper absorbs the first increment
+            uint64_t hash = keyHash(record.query);
+            for (uint64_t i = 0; i <= std::min<uint64_t>(record.hits, FrequencySketch::MAX_COUNT); i++) {
+                sketch_->increment(hash);
+            }
+        }
+        store(record.query, record.response, age, record.hits);
+        return cache_.count(record.query) > 0;
     }
     
     /**
@@ -112,6 +248,9 @@ public:
         std::lock_guard<std::mutex> lock(mutex_);
         cache_.clear();
         lru_list_.clear();
+        window_list_.clear();
+        bytes_ = 0;
+        window_bytes_ = 0;
     }
     
     /**
@@ -123,6 +262,21 @@ public:
         return cache_.size();
     }
     
+    /**
+     * Get the bytes charged for all entries (keys plus serialized responses)
+     */
+    size_t bytes() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return bytes_;
+    }
+    
+    /**
+     * Get the byte budget (0 = entry limit only)
+     */
+    size_t max_bytes() const {
+        return max_bytes_;
+    }
+    
     /**
      * Get cache hit ratio
      * @return Hit ratio (0.0 to 1.0)
@@ -154,50 +308,225 @@ public:
     uint64_t miss_count() const {
         return miss_count_;
     }
+    
+    /**
+     * Get the number of misses answered from another query's result
+     * @return Number of derived hits
+     */
+    uint64_t derived_hit_count() const {
+        return derived_hit_count_;
+    }
+    
+    /**
+     * Get the number of hits on entries past the soft TTL
+     * @return Number of stale hits
+     */
+    uint64_t stale_hit_count() const {
+        return stale_hit_count_;
+    }
+    
+    /**
+     * Get the number of responses not kept because admission preferred the
+     * entries already cached, or because they exceeded the byte budget
+     * @return Number of rejected entries
+     */
+    uint64_t rejected_count() const {
+        return rejected_count_;
+    }
 
 private:
     /**
      * Structure to hold a cache entry
      */
     struct CacheEntry {
-        std::chrono::system_clock::time_point timestamp;
-        std::shared_ptr<movie::SearchResponse> response;
+        std::string query;
+        std::chrono::steady_clock::time_point timestamp;
+        CachedResponsePtr response;
+        size_t bytes;     // Charged against the byte budget
+        bool in_window;   // In window_list_ rather than lru_list_
+        uint64_t hits;    // Hits since the query was cached
     };
     
+    using EntryList = std::list<CacheEntry>;
+    
+    /**
+     * Check if an entry has outlived the TTL
+     */
+    bool expired(const CacheEntry& entry, std::chrono::steady_clock::time_point now) const {
+        return now - entry.timestamp > ttl_;
+    }
+    
+    static uint64_t keyHash(const std::string& query) {
+        return std::hash<std::string>()(query);
+    }
+    
+    EntryList& listOf(const CacheEntry& entry) {
+        return entry.in_window ? window_list_ : lru_list_;
+    }
+    
+    // Change the bytes charged for an entry
+    void resize(CacheEntry& entry, size_t bytes) {
+        bytes_ = bytes_ - entry.bytes + bytes;
+        if (entry.in_window) {
+            window_bytes_ = window_bytes_ - entry.bytes + bytes;
+        }
+        entry.bytes = bytes;
+    }
+    
+    void removeEntry(EntryList::iterator entry) {
+        resize(*entry, 0);
+        cache_.erase(entry->query);
+        listOf(*entry).erase(entry);
+    }
+    
     /**
-     * Remove all expired entries from the cache
+     * Store an entry that is already `age` old (caller holds mutex_). An
+     * existing entry keeps its hit count.
      */
-    void clean_expired() {
-        auto now = std::chrono::system_clock::now();
-        auto it = cache_.begin();
-        while (it != cache_.end()) {
-            if (now - it->second.timestamp > ttl_) {
-                lru_list_.remove(it->first);
-                it = cache_.erase(it);
+    void store(const std::string& query, CachedResponsePtr payload, std::chrono::steady_clock::duration age,
+               uint64_t hits) {
+        auto now = std::chrono::steady_clock::now();
+        size_t bytes = query.size() + payload->size();
+        
+        auto it = cache_.find(query);
+        
+        // An entry larger than the whole budget is never cached
+        if (max_bytes_ > 0 && bytes > max_bytes_) {
+            if (it != cache_.end()) {
+                removeEntry(it->second);
+            }
+            rejected_count_++;
+            return;
+        }
+        
+        // If entry already exists, update it
+        if (it != cache_.end()) {
+            // Update existing entry
+            auto entry = it->second;
+            resize(*entry, bytes);
+            entry->timestamp = now - age;
+            entry->response = std::move(payload);
+            
+            // Move to front of LRU list
+            EntryList& list = listOf(*entry);
+            list.splice(list.begin(), list, entry);
+            enforceBudget();
+            return;
+        }
+        
+        // Drop expired entries from the cold end of the LRU lists
+        while (!lru_list_.empty() && expired(lru_list_.back(), now)) {
+            removeEntry(std::prev(lru_list_.end()));
+        }
+        while (!window_list_.empty() && expired(window_list_.back(), now)) {
+            removeEntry(std::prev(window_list_.end()));
+        }
+        
+        // If we're at capacity, remove least recently used (budgeted: enforceBudget() admits or rejects)
+        if (max_bytes_ == 0 && cache_.size() >= max_size_ && !cache_.empty()) {
+            // Remove least recently used entry
+            std::cout << "Evicting oldest entry: " << lru_list_.back().query << std::endl;
+            removeEntry(std::prev(lru_list_.end()));
+        }
+        
+        // Add new entry at the front of the LRU list (the window when budgeted)
+        EntryList& list = max_bytes_ > 0 ? window_list_ : lru_list_;
+        list.push_front(CacheEntry{query, now - age, std::move(payload), 0, max_bytes_ > 0, hits});
+        cache_.emplace(query, list.begin());
+        resize(list.front(), bytes);
+        enforceBudget();
+    }
+    
+    /**
+     * Bring the window and main area back within the byte budget and the
+     * entry limit. Window overflow is offered to the main area oldest
+     * first, and each candidate must be estimated more frequent than every
+     * main-area victim it evicts.
+     */
+    void enforceBudget() {
+        if (max_bytes_ == 0) {
+            return;
+        }
+        size_t main_budget = max_bytes_ - window_bytes_budget_;
+        size_t main_entries = max_size_ > window_entries_budget_ ? max_size_ - window_entries_budget_ : 0;
+        
+        // An updated main-area entry may have grown
+        while (bytes_ - window_bytes_ > main_budget && !lru_list_.empty()) {
+            removeEntry(std::prev(lru_list_.end()));
+        }
+        
+        while ((window_bytes_ > window_bytes_budget_ || window_list_.size() > window_entries_budget_)
+               && !window_list_.empty()) {
+            auto candidate = std::prev(window_list_.end());
+            uint64_t frequency = sketch_->estimate(keyHash(candidate->query));
+            
+            // Decide against every victim the candidate would displace before
+            // evicting any of them, so a rejected candidate costs nothing
+            bool admit = candidate->bytes <= main_budget && main_entries > 0;
+            size_t freed = 0;
+            size_t victims = 0;
+            auto victim = lru_list_.end();
+            while (admit && (bytes_ - window_bytes_ - freed + candidate->bytes > main_budget
+                             || lru_list_.size() - victims >= main_entries)
+                   && victim != lru_list_.begin()) {
+                --victim;
+                if (frequency > sketch_->estimate(keyHash(victim->query))) {
+                    freed += victim->bytes;
+                    victims++;
+                } else {
+                    admit = false;
+                }
+            }
+            
+            if (admit) {
+                for (; victims > 0; victims--) {
+                    removeEntry(std::prev(lru_list_.end()));
+                }
+                window_bytes_ -= candidate->bytes;
+                candidate->in_window = false;
+                lru_list_.splice(lru_list_.begin(), window_list_, candidate);
             } else {
-                ++it;
+                removeEntry(candidate);
+                rejected_count_++;
             }
         }
     }
     
-    // Cache storage
-    std::unordered_map<std::string, CacheEntry> cache_;
+    // Entries, most recently used first (the main area when budgeted)
+    EntryList lru_list_;
+    
+    // Newest entries awaiting admission, most recently used first (budgeted only)
+    EntryList window_list_;
     
-    // LRU tracking
-    std::list<std::string> lru_list_;
+    // Query -> position of its entry in the LRU list
+    std::unordered_map<std::string, EntryList::iterator> cache_;
     
-    // TTL for cache entries
+    // TTL for cache entries, and the age at which they turn stale (0 = never)
     std::chrono::seconds ttl_;
+    std::chrono::seconds soft_ttl_;
     
     // Maximum number of entries in cache
     size_t max_size_;
     
+    // Byte budget, and the part of it reserved for the window
+    size_t max_bytes_;
+    size_t window_bytes_budget_;
+    size_t window_entries_budget_;
+    size_t bytes_ = 0;
+    size_t window_bytes_ = 0;
+    
+    // Access frequencies for admission (budgeted only)
+    std::unique_ptr<FrequencySketch> sketch_;
+    
     // Thread safety
     mutable std::mutex mutex_;
     
     // Statistics
     std::atomic<uint64_t> hit_count_;
     std::atomic<uint64_t> miss_count_;
+    std::atomic<uint64_t> derived_hit_count_;
+    std::atomic<uint64_t> stale_hit_count_;
+    std::atomic<uint64_t> rejected_count_;
 };
 
 #endif // CACHE_H
\ No newline at end of file
@@ -0,0 +1,183 @@
+#ifndef CACHE_SNAPSHOT_H
+#define CACHE_SNAPSHOT_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include <chrono>
+#include <cstring>
+#include <cstdint>
+#include <cstdio>       // For std::rename
+#include <stdexcept>
+#include "mapped_file.h"
+#include "movie_snapshot.h"  // For SnapshotChecksum
+#include "cache.h"
+
+/**
+ * Snapshot of A's hottest cache entries, so a restarted A starts warm.
+ *
+ * Layout (all integers in host byte order):
+ *   CacheSnapshotHeader
+ *   per entry: CacheSnapshotRecord, key bytes, serialized SearchResponse
+ *
+ * Entries are written hottest first. Ages are relative to written_at_ms,
+ * so the time A was down counts towards them and entries that expired
+ * meanwhile are dropped on load. The checksum covers everything after
+ * the header. The file only holds responses A would have cached anyway,
+ * it is never needed for correctness.
+ */
+static const char CACHE_SNAPSHOT_MAGIC[8] = {'C', 'A', 'C', 'H', 'S', 'N', 'A', 'P'};
+static constexpr uint32_t CACHE_SNAPSHOT_VERSION = 1;
+
+struct CacheSnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;     // SNAPSHOT_BYTE_ORDER
+    uint64_t entries;
+    uint64_t payload_bytes;  // Bytes after the header
+    uint64_t checksum;       // SnapshotChecksum of the payload
+    uint64_t written_at_ms;  // Wall clock (ms since the epoch) when written
+    uint64_t reserved[2];
+};
+
+struct CacheSnapshotRecord {
+    uint64_t age_ms;         // Age of the entry when written
+    uint64_t hits;
+    uint32_t key_bytes;
+    uint32_t response_bytes;
+};
+
+static_assert(sizeof(CacheSnapshotHeader) == 64, "Cache snapshot header layout changed");
+static_assert(sizeof(CacheSnapshotRecord) == 24, "Cache snapshot record layout changed");
+
+static inline uint64_t cacheSnapshotClock() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+/**
+ * Write cache entries to a snapshot file; the file is written next to
+ * `path` and renamed into place so a crash never leaves a partial snapshot
+ * @param path Output file
+ * @param records Entries to save, hottest first (see ShardedCache::hottest())
+ */
+static inline void writeCacheSnapshot(const std::string& path, const std::vector<Cache::Record>& records) {
+    CacheSnapshotHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, CACHE_SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = CACHE_SNAPSHOT_VERSION;
+    header.byte_order = SNAPSHOT_BYTE_ORDER;
+    header.entries = records.size();
+    header.written_at_ms = cacheSnapshotClock();
+
+    std::string tmp_path = path + ".tmp";
+    std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("Failed to create " + tmp_path);
+    }
+
+    // Header goes first with a zero checksum and is rewritten at the end
+    SnapshotChecksum checksum;
+    auto writeChecked = [&](const void* data, size_t bytes) {
+        checksum.update(data, bytes);
+        out.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+        header.payload_bytes += bytes;
+    };
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (const auto& entry : records) {
+        std::string_view response = entry.response->bytes();
+        CacheSnapshotRecord record;
+        record.age_ms = entry.age_ms;
+        record.hits = entry.hits;
+        record.key_bytes = static_cast<uint32_t>(entry.query.size());
+        record.response_bytes = static_cast<uint32_t>(response.size());
+        writeChecked(&record, sizeof(record));
+        writeChecked(entry.query.data(), entry.query.size());
+        writeChecked(response.data(), response.size());
+    }
+
+    header.checksum = checksum.value();
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.close();
+    if (!out) {
+        std::remove(tmp_path.c_str());
+        throw std::runtime_error("Failed to write " + tmp_path);
+    }
+
+    if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        std::remove(tmp_path.c_str());
+        throw std::runtime_error("Failed to rename " + tmp_path + " to " + path);
+    }
+}
+
+/**
+ * Read the entries of a cache snapshot. Their ages include the time since
+ * the snapshot was written.
+ * @param path Snapshot file
+ * @return The saved entries, hottest first
+ * @throws std::runtime_error If the file is not a valid cache snapshot
+ */
+static inline std::vector<Cache::Record> loadCacheSnapshot(const std::string& path) {
+    MappedFile file(path);
+    CacheSnapshotHeader header;
+    if (file.size() < sizeof(header)) {
+        throw std::runtime_error("Cache snapshot is truncated");
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+
+    if (std::memcmp(header.magic, CACHE_SNAPSHOT_MAGIC, sizeof(header.magic)) != 0) {
+        throw std::runtime_error("Not a cache snapshot");
+    }
+    if (header.version != CACHE_SNAPSHOT_VERSION) {
+        throw std::runtime_error("Unsupported cache snapshot version " + std::to_string(header.version) +
+                                 " (expected " + std::to_string(CACHE_SNAPSHOT_VERSION) + ")");
+    }
+    if (header.byte_order != SNAPSHOT_BYTE_ORDER) {
+        throw std::runtime_error("Cache snapshot was written on a machine with a different byte order");
+    }
+
+    const unsigned char* p = file.data() + sizeof(header);
+    uint64_t remaining = file.size() - sizeof(header);
+    if (header.payload_bytes != remaining || header.entries > remaining / sizeof(CacheSnapshotRecord)) {
+        throw std::runtime_error("Cache snapshot is truncated");
+    }
+    SnapshotChecksum checksum;
+    checksum.update(p, remaining);
+    if (checksum.value() != header.checksum) {
+        throw std::runtime_error("Cache snapshot checksum mismatch");
+    }
+
+    uint64_t now = cacheSnapshotClock();
+    uint64_t downtime = now > header.written_at_ms ? now - header.written_at_ms : 0;
+
+    std::vector<Cache::Record> records;
+    records.reserve(header.entries);
+    for (uint64_t i = 0; i < header.entries; i++) {
+        CacheSnapshotRecord record;
+        if (remaining < sizeof(record)) {
+            throw std::runtime_error("Cache snapshot is truncated");
+        }
+        std::memcpy(&record, p, sizeof(record));
+        p += sizeof(record);
+        remaining -= sizeof(record);
+        uint64_t bytes = static_cast<uint64_t>(record.key_bytes) + record.response_bytes;
+        if (remaining < bytes) {
+            throw std::runtime_error("Cache snapshot is truncated");
+        }
+
+        std::string key(reinterpret_cast<const char*>(p), record.key_bytes);
+        auto response = std::make_shared<const CachedResponse>(p + record.key_bytes, record.response_bytes);
+        p += bytes;
+        remaining -= bytes;
+        records.push_back(Cache::Record{std::move(key), std::move(response), record.age_ms + downtime, record.hits});
+    }
+    if (remaining != 0) {
+        throw std::runtime_error("Cache snapshot has unexpected trailing bytes");
+    }
+    return records;
+}
+
+#endif // CACHE_SNAPSHOT_H
@@ -0,0 +1,86 @@
+#ifndef CACHED_RESPONSE_H
+#define CACHED_RESPONSE_H
+
+#include <string>
+#include <string_view>
+#include <memory>
+#include <utility>
+#include <grpcpp/support/byte_buffer.h>
+#include <grpcpp/support/slice.h>
+#include "movie.grpc.pb.h"
+
+/**
+ * An immutable, serialized SearchResponse shared by every cache reader.
+ *
+ * The response is serialized once when it is cached. A hit replies with a
+ * copy of the ByteBuffer, which only takes a reference on the same slice,
+ * so no MovieInfo is rebuilt or copied no matter how many results it has.
+ */
+class CachedResponse {
+public:
+    /**
+     * Serialize a response for caching
+     * @param response The response to cache
+     */
+    explicit CachedResponse(const movie::SearchResponse& response)
+        : CachedResponse(response.SerializeAsString()) {}
+
+    /**
+     * Wrap an already serialized response (e.g. read from shared memory)
+     * @param bytes Serialized SearchResponse
+     */
+    explicit CachedResponse(const std::string& bytes)
+        : slice_(bytes), buffer_(&slice_, 1) {}
+
+    /**
+     * Take over an already serialized response without copying it
+     * @param bytes Serialized SearchResponse
+     */
+    explicit CachedResponse(std::string&& bytes)
+        : slice_(adopt(std::move(bytes))), buffer_(&slice_, 1) {}
+
+    CachedResponse(const uint8_t* data, size_t size)
+        : slice_(data, size), buffer_(&slice_, 1) {}
+
+    /**
+     * Get the serialized response, ready to be sent as a reply
+     */
+    const grpc::ByteBuffer& buffer() const {
+        return buffer_;
+    }
+
+    /**
+     * Get the serialized bytes
+     */
+    std::string_view bytes() const {
+        return std::string_view(reinterpret_cast<const char*>(slice_.begin()), slice_.size());
+    }
+
+    size_t size() const {
+        return slice_.size();
+    }
+
+    /**
+     * Materialize the response (a full copy; replies should use buffer())
+     * @param response The response to populate
+     * @return Whether the bytes could be parsed
+     */
+    bool parseTo(movie::SearchResponse& response) const {
+        return response.ParseFromArray(slice_.begin(), static_cast<int>(slice_.size()));
+    }
+
+private:
+    // A slice that owns the string and frees it with the last reference
+    static grpc::Slice adopt(std::string&& bytes) {
+        std::string* owned = new std::string(std::move(bytes));
+        return grpc::Slice(&(*owned)[0], owned->size(),
+                           [](void* user_data) { delete static_cast<std::string*>(user_data); }, owned);
+    }
+
+    grpc::Slice slice_;
+    grpc::ByteBuffer buffer_;
+};
+
+using CachedResponsePtr = std::shared_ptr<const CachedResponse>;
+
+#endif // CACHED_RESPONSE_H
@@ -0,0 +1,163 @@
+#ifndef CSV_LOADER_H
+#define CSV_LOADER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <iostream>
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include "movie_struct.h"
+#include "mapped_file.h"
+
+/**
+ * Parallel TMDB CSV ingest.
+ *
+ * The file is memory-mapped and cut into one chunk per thread. Chunk
+ * boundaries are moved forward to the next record start, which is the
+ * byte after a newline outside quotes. Each thread counts the quotes of
+ * its nominal range first. A prefix sum over those counts gives the quote
+ * state at every range start, so each thread can find its boundary
+ * without scanning from the top of the file. The chunks are then parsed
+ * concurrently into per-chunk buffers and stitched back in file order.
+ * Warnings for skipped rows are also printed in file order.
+ */
+class CSVLoader {
+public:
+    static constexpr size_t MIN_CHUNK_BYTES = 64 * 1024;  // Smaller files are parsed on one thread
+
+    /**
+     * Load movies from a TMDB CSV file
+     * @param filename The CSV file
+     * @param threads Parser threads (0 = hardware threads)
+     * @return Movies in file order (malformed rows skipped with a warning)
+     */
+    static std::vector<Movie> load(const std::string& filename, size_t threads = 0) {
+        auto start = std::chrono::high_resolution_clock::now();
+
+        std::unique_ptr<MappedFile> file;
+        try {
+            file = std::make_unique<MappedFile>(filename);
+        } catch (const std::runtime_error&) {
+            std::cerr << "Failed to open file: " << filename << std::endl;
+            return {};
+        }
+
+        const char* data = reinterpret_cast<const char*>(file->data());
+        size_t size = file->size();
+
+        // Skip the header record
+        size_t body = recordEnd(data, 0, size, false);
+
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        size_t chunks = std::max<size_t>(1, std::min(threads, (size - body) / MIN_CHUNK_BYTES));
+
+        std::vector<size_t> nominal(chunks + 1);
+        for (size_t i = 0; i <= chunks; i++) {
+            nominal[i] = body + (size - body) * i / chunks;
+        }
+
+        // Pass 1: quote parity of every nominal range
+        std::vector<uint8_t> parity(chunks, 0);
+        runParallel(chunks, [&](size_t i) {
+            size_t quotes = std::count(data + nominal[i], data + nominal[i + 1], '"');
+            parity[i] = static_cast<uint8_t>(quotes & 1);
+        });
+
+        // Pass 2: move each boundary to the next record start
+        std::vector<size_t> bounds(chunks + 1);
+        bounds[0] = body;
+        bounds[chunks] = size;
+        std::vector<bool> inQuotes(chunks, false);
+        for (size_t i = 1; i < chunks; i++) {
+            inQuotes[i] = inQuotes[i - 1] != (parity[i - 1] != 0);
+        }
+        runParallel(chunks, [&](size_t i) {
+            if (i > 0) {
+                bounds[i] = recordEnd(data, nominal[i], size, inQuotes[i]);
+            }
+        });
+        for (size_t i = 1; i < chunks; i++) {
+            bounds[i] = std::max(bounds[i], bounds[i - 1]);
+        }
+
+        // Pass 3: parse the chunks into per-chunk buffers
+        std::vector<std::vector<Movie>> parts(chunks);
+        std::vector<std::vector<std::string>> warnings(chunks);
+        runParallel(chunks, [&](size_t i) {
+            parseChunk(data, bounds[i], bounds[i + 1], parts[i], warnings[i]);
+        });
+
+        size_t total = 0;
+        for (const auto& part : parts) total += part.size();
+        std::vector<Movie> movies;
+        movies.reserve(total);
+        for (size_t i = 0; i < chunks; i++) {
+            for (const auto& warning : warnings[i]) {
+                std::cerr << warning << std::endl;
+            }
+            std::move(parts[i].begin(), parts[i].end(), std::back_inserter(movies));
+        }
+
+        double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+        std::cout << "Loaded " << movies.size() << " movies from " << filename << " in "
+                  << static_cast<long long>(seconds * 1000.0) << " ms ("
+                  << static_cast<long long>(movies.size() / std::max(seconds, 1e-9)) << " rows/sec, "
+                  << chunks << (chunks == 1 ? " thread)" : " threads)") << std::endl;
+        return movies;
+    }
+
+private:
+    /**
+     * Find the start of the next record: the byte after the first newline
+     * outside quotes at or after `pos`
+     * @param inQuotes Quote state at `pos`
+     * @return Offset of the next record, or `size` if there is none
+     */
+    static size_t recordEnd(const char* data, size_t pos, size_t size, bool inQuotes) {
+        for (; pos < size; pos++) {
+            if (data[pos] == '"') {
+                inQuotes = !inQuotes;
+            } else if (data[pos] == '\n' && !inQuotes) {
+                return pos + 1;
+            }
+        }
+        return size;
+    }
+
+    // Parse the records of [begin, end), which starts on a record boundary
+    static void parseChunk(const char* data, size_t begin, size_t end,
+                           std::vector<Movie>& movies, std::vector<std::string>& warnings) {
+        std::string_view chunk(data + begin, end - begin);
+        CSVTokenizer tokenizer;
+        size_t pos = 0;
+        while (pos < chunk.size()) {
+            pos = tokenizer.parseRecord(chunk, pos);
+            std::string warning = addMovieRecord(tokenizer.fields(), movies);
+            if (!warning.empty()) {
+                warnings.push_back(std::move(warning));
+            }
+        }
+    }
+
+    // Run fn(0) ... fn(tasks - 1), one thread per task
+    template <typename Fn>
+    static void runParallel(size_t tasks, Fn fn) {
+        std::vector<std::thread> workers;
+        for (size_t i = 1; i < tasks; i++) {
+            workers.emplace_back(fn, i);
+        }
+        fn(0);
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+};
+
+#endif // CSV_LOADER_H
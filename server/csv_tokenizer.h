@@ -0,0 +1,116 @@
+#ifndef CSV_TOKENIZER_H
+#define CSV_TOKENIZER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <cctype>
+
+// Trim whitespace from both ends of a view (no copy)
+static inline std::string_view trimView(std::string_view str) {
+    size_t begin = 0;
+    size_t end = str.size();
+    while (begin < end && std::isspace(static_cast<unsigned char>(str[begin]))) begin++;
+    while (end > begin && std::isspace(static_cast<unsigned char>(str[end - 1]))) end--;
+    return str.substr(begin, end - begin);
+}
+
+/**
+ * Zero-copy RFC 4180 CSV record tokenizer.
+ *
+ * A record ends at the first newline outside quotes, so quoted fields may
+ * contain commas and newlines. Inside quotes, "" stands for one quote.
+ * Fields are returned as views into the input buffer. A field is copied
+ * into tokenizer-owned storage only when it has to be unescaped. Values
+ * are trimmed of surrounding whitespace (including the \r of CRLF files),
+ * like the servers' original line parser.
+ */
+class CSVTokenizer {
+public:
+    /**
+     * Split the record that starts at `pos` into fields
+     * @param data The buffer holding the CSV text
+     * @param pos Offset of the record's first byte
+     * @return Offset just past the record and its newline
+     */
+    size_t parseRecord(std::string_view data, size_t pos) {
+        fields_.clear();
+        used_ = 0;
+
+        size_t fieldStart = pos;
+        bool inQuotes = false;
+        bool quoted = false;  // Field contains a quote character
+        for (; pos < data.size(); pos++) {
+            char c = data[pos];
+            if (c == '"') {
+                inQuotes = !inQuotes;
+                quoted = true;
+            } else if (!inQuotes && c == ',') {
+                addField(data.substr(fieldStart, pos - fieldStart), quoted);
+                fieldStart = pos + 1;
+                quoted = false;
+            } else if (!inQuotes && c == '\n') {
+                addField(data.substr(fieldStart, pos - fieldStart), quoted);
+                return pos + 1;
+            }
+        }
+        addField(data.substr(fieldStart), quoted);
+        return data.size();
+    }
+
+    /**
+     * Fields of the last parsed record, valid until the next parseRecord()
+     * call and while the input buffer is alive
+     */
+    const std::vector<std::string_view>& fields() const {
+        return fields_;
+    }
+
+private:
+    void addField(std::string_view raw, bool quoted) {
+        std::string_view value = trimView(raw);
+        if (!quoted) {
+            fields_.push_back(value);
+            return;
+        }
+
+        // Common case: the whole field is one quoted section without escapes
+        if (value.size() >= 2 && value.front() == '"' && value.back() == '"' &&
+            value.substr(1, value.size() - 2).find('"') == std::string_view::npos) {
+            fields_.push_back(trimView(value.substr(1, value.size() - 2)));
+            return;
+        }
+
+        // Drop the quote characters; "" inside quotes becomes one quote
+        std::string& out = scratch();
+        bool inQuotes = false;
+        for (size_t i = 0; i < raw.size(); i++) {
+            if (raw[i] != '"') {
+                out += raw[i];
+            } else if (inQuotes && i + 1 < raw.size() && raw[i + 1] == '"') {
+                out += '"';
+                i++;
+            } else {
+                inQuotes = !inQuotes;
+            }
+        }
+        fields_.push_back(trimView(out));
+    }
+
+    // Reusable buffer for an unescaped field; deque keeps earlier ones in place
+    std::string& scratch() {
+        if (used_ == scratch_.size()) {
+            scratch_.emplace_back();
+        }
+        std::string& buffer = scratch_[used_++];
+        buffer.clear();
+        return buffer;
+    }
+
+    std::vector<std::string_view> fields_;
+    std::deque<std::string> scratch_;
+    size_t used_ = 0;
+};
+
+#endif // CSV_TOKENIZER_H
@@ -0,0 +1,129 @@
+#ifndef FREQUENCY_SKETCH_H
+#define FREQUENCY_SKETCH_H
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+/**
+ * Approximate access frequency of cache keys (TinyLFU).
+ *
+ * A doorkeeper bloom filter absorbs the first access of every key, so keys
+ * seen only once never reach the counters. Repeat accesses go to a
+ * Count-Min sketch of 4-bit counters, DEPTH rows, 16 counters per 64-bit
+ * word. After `sample` recorded accesses every counter is halved and the
+ * doorkeeper is cleared, so old popularity fades out.
+ */
+class FrequencySketch {
+public:
+    static constexpr int DEPTH = 4;
+    static constexpr uint64_t MAX_COUNT = 15;
+
+    /**
+     * Constructor
+     * @param expected_keys Number of keys the cache is expected to hold
+     */
+    explicit FrequencySketch(size_t expected_keys = 1024) {
+        size_t counters = 16;
+        while (counters < std::max<size_t>(expected_keys, 16) && counters < (size_t(1) << 24)) {
+            counters <<= 1;
+        }
+        mask_ = counters - 1;
+        table_.assign(DEPTH * counters / 16, 0);
+        doorkeeper_.assign(std::max<size_t>(1, counters / 64), 0);
+        sample_ = 10 * counters;
+    }
+
+    /**
+     * Record one access of a key
+     * @param hash Hash of the key
+     */
+    void increment(uint64_t hash) {
+        if (doorkeeperAdd(hash)) {
+            bool added = false;
+            for (int row = 0; row < DEPTH; row++) {
+                size_t index = counterIndex(hash, row);
+                uint64_t& word = table_[index / 16];
+                int shift = static_cast<int>(index % 16) * 4;
+                if (((word >> shift) & MAX_COUNT) < MAX_COUNT) {
+                    word += uint64_t(1) << shift;
+                    added = true;
+                }
+            }
+            if (!added) {
+                return;
+            }
+        }
+        if (++additions_ >= sample_) {
+            reset();
+        }
+    }
+
+    /**
+     * Estimate how often a key was accessed (0 to MAX_COUNT + 1)
+     * @param hash Hash of the key
+     */
+    uint64_t estimate(uint64_t hash) const {
+        uint64_t count = MAX_COUNT;
+        for (int row = 0; row < DEPTH; row++) {
+            size_t index = counterIndex(hash, row);
+            count = std::min(count, (table_[index / 16] >> ((index % 16) * 4)) & MAX_COUNT);
+        }
+        return count + (doorkeeperContains(hash) ? 1 : 0);
+    }
+
+    /**
+     * Halve every counter and clear the doorkeeper (aging)
+     */
+    void reset() {
+        for (auto& word : table_) {
+            word = (word >> 1) & 0x7777777777777777ULL;
+        }
+        std::fill(doorkeeper_.begin(), doorkeeper_.end(), 0);
+        additions_ /= 2;
+    }
+
+private:
+    static uint64_t mix(uint64_t h, uint64_t seed) {
+        h ^= seed;
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    size_t counterIndex(uint64_t hash, int row) const {
+        static const uint64_t SEEDS[DEPTH] = {
+            0x97cb3127d8c1e4f5ULL, 0xc2b2ae3d27d4eb4fULL, 0x165667b19e3779f9ULL, 0x9e3779b97f4a7c15ULL
+        };
+        return row * (mask_ + 1) + static_cast<size_t>(mix(hash, SEEDS[row]) & mask_);
+    }
+
+    // Two-probe bloom filter; returns whether the key was already present
+    bool doorkeeperAdd(uint64_t hash) {
+        bool present = doorkeeperContains(hash);
+        size_t bits = doorkeeper_.size() * 64;
+        size_t first = static_cast<size_t>(hash % bits);
+        size_t second = static_cast<size_t>(mix(hash, 0x2545f4914f6cdd1dULL) % bits);
+        doorkeeper_[first / 64] |= uint64_t(1) << (first % 64);
+        doorkeeper_[second / 64] |= uint64_t(1) << (second % 64);
+        return present;
+    }
+
+    bool doorkeeperContains(uint64_t hash) const {
+        size_t bits = doorkeeper_.size() * 64;
+        size_t first = static_cast<size_t>(hash % bits);
+        size_t second = static_cast<size_t>(mix(hash, 0x2545f4914f6cdd1dULL) % bits);
+        return ((doorkeeper_[first / 64] >> (first % 64)) & 1) && ((doorkeeper_[second / 64] >> (second % 64)) & 1);
+    }
+
+    std::vector<uint64_t> table_;       // DEPTH rows of 4-bit counters
+    std::vector<uint64_t> doorkeeper_;  // Bloom filter bits
+    size_t mask_ = 0;                   // Counters per row - 1
+    size_t sample_ = 0;                 // Accesses between resets
+    size_t additions_ = 0;
+};
+
+#endif // FREQUENCY_SKETCH_H
@@ -0,0 +1,140 @@
+#ifndef LOCAL_SEARCH_H
+#define LOCAL_SEARCH_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <algorithm>
+#include <iostream>
+#include "movie_store.h"
+#include "trigram_index.h"
+#include "movie_snapshot.h"
+#include "csv_loader.h"
+#include "thread_pool.h"
+#include "server_options.h"
+
+/**
+ * Settings for splitting a local search across a node's worker pool.
+ * Scans smaller than `threshold` rows run on the calling gRPC handler
+ * thread; larger ones are cut into chunks that the pool scans in parallel.
+ */
+struct ParallelScan {
+    static constexpr size_t DEFAULT_THRESHOLD = 20000;  // Rows
+    static constexpr size_t MIN_CHUNK_ROWS = 1024;
+
+    std::shared_ptr<WorkStealingPool> pool;  // Null: always scan on the calling thread
+    size_t threshold = DEFAULT_THRESHOLD;
+
+    /**
+     * Create the settings from --search-threads and --parallel-threshold
+     * @param options Parsed command line
+     * @param tag Log prefix of the server, e.g. "[E]"
+     */
+    static ParallelScan fromOptions(const ServerOptions& options, const std::string& tag) {
+        ParallelScan parallel;
+        long long threads = options.getInt("search-threads", std::thread::hardware_concurrency());
+        parallel.threshold = static_cast<size_t>(std::max(1LL, options.getInt("parallel-threshold", DEFAULT_THRESHOLD)));
+
+        if (threads > 1) {
+            parallel.pool = std::make_shared<WorkStealingPool>(static_cast<size_t>(threads));
+            std::cout << tag << " Parallel scan: " << threads << " threads, threshold "
+                      << parallel.threshold << " rows" << std::endl;
+        } else {
+            std::cout << tag << " Parallel scan disabled (single search thread)" << std::endl;
+        }
+        return parallel;
+    }
+
+    /**
+     * Apply fn(begin, end, out) to [0, count), in parallel chunks when the
+     * range is large enough, and concatenate the outputs in chunk order so
+     * the result is identical to a sequential pass
+     */
+    template <typename ChunkFn>
+    std::vector<uint32_t> collect(size_t count, ChunkFn fn) const {
+        std::vector<uint32_t> out;
+        if (!pool || count < threshold) {
+            fn(0, count, out);
+            return out;
+        }
+
+        size_t chunks = pool->threadCount() * 4;
+        size_t chunkRows = std::max(MIN_CHUNK_ROWS, (count + chunks - 1) / chunks);
+        chunks = (count + chunkRows - 1) / chunkRows;
+
+        std::vector<std::vector<uint32_t>> parts(chunks);
+        pool->parallelFor(chunks, [&](size_t chunk) {
+            size_t begin = chunk * chunkRows;
+            fn(begin, std::min(count, begin + chunkRows), parts[chunk]);
+        });
+
+        size_t total = 0;
+        for (const auto& part : parts) total += part.size();
+        out.reserve(total);
+        for (const auto& part : parts) {
+            out.insert(out.end(), part.begin(), part.end());
+        }
+        return out;
+    }
+};
+
+/**
+ * Find the movies matching a query, using the index when possible
+ * @param movies The node's movies
+ * @param index Trigram index built over the same movies
+ * @param lowerQuery The lowercased query
+ * @param parallel Worker pool settings for large scans
+ * @return Indices of matching movies in ascending order
+ */
+static inline std::vector<uint32_t> findMatchingMovies(const MovieStore& movies,
+                                                       const TrigramIndex& index,
+                                                       std::string_view lowerQuery,
+                                                       const ParallelScan& parallel = ParallelScan()) {
+    std::vector<uint32_t> candidates;
+    if (!index.candidates(lowerQuery, candidates)) {
+        MovieStore::PreparedQuery query = movies.prepare(lowerQuery);
+        return parallel.collect(movies.size(), [&](size_t begin, size_t end, std::vector<uint32_t>& out) {
+            movies.scan(query, begin, end, out);
+        });
+    }
+
+    // Verify candidates, trigrams only prove the pieces are present
+    MovieStore::PreparedQuery query = movies.prepare(lowerQuery, candidates.size());
+    return parallel.collect(candidates.size(), [&](size_t begin, size_t end, std::vector<uint32_t>& out) {
+        for (size_t i = begin; i < end; i++) {
+            if (movies.matches(candidates[i], query)) {
+                out.push_back(candidates[i]);
+            }
+        }
+    });
+}
+
+/**
+ * Load a node's movies and trigram index from a CSV file or a snapshot
+ * written by build_snapshot (detected from the file contents)
+ * @param path CSV or snapshot file
+ * @param tag Log prefix of the server, e.g. "[E]"
+ * @param movies Receives the movie store
+ * @param index Receives the trigram index
+ */
+static inline void loadLocalMovies(const std::string& path, const std::string& tag,
+                                   MovieStore& movies, TrigramIndex& index) {
+    if (isMovieSnapshot(path)) {
+        loadMovieSnapshot(path, movies, index);
+        std::cout << tag << " Mapped movie snapshot " << path << " (" << movies.size() << " movies)" << std::endl;
+    } else {
+        movies = MovieStore(CSVLoader::load(path));
+        std::cout << tag << " Successfully loaded movies from " << path << std::endl;
+        index.build(movies);
+    }
+
+    TrigramIndex::Stats stats = index.stats();
+    std::cout << tag << " Movie store: " << (movies.searchBytes() / 1024) << " KB searched columns, "
+              << (movies.otherBytes() / 1024) << " KB result/cold columns" << std::endl;
+    std::cout << tag << " Trigram index: " << stats.trigrams << " trigrams, "
+              << stats.postings << " postings, " << (stats.bytes / 1024) << " KB" << std::endl;
+}
+
+#endif // LOCAL_SEARCH_H
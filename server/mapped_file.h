@@ -0,0 +1,61 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>   // For mmap, munmap
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <string>
+#include <cstring>
+#include <cerrno>
+#include <stdexcept>
+
+/**
+ * Read-only memory mapping of a whole file, unmapped on destruction
+ */
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd == -1) {
+            throw std::runtime_error("Failed to open " + path + ": " + std::string(strerror(errno)));
+        }
+
+        struct stat st;
+        if (fstat(fd, &st) == -1) {
+            close(fd);
+            throw std::runtime_error("Failed to stat " + path + ": " + std::string(strerror(errno)));
+        }
+
+        size_ = static_cast<size_t>(st.st_size);
+        if (size_ > 0) {
+            void* addr = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr == MAP_FAILED) {
+                close(fd);
+                throw std::runtime_error("Failed to map " + path + ": " + std::string(strerror(errno)));
+            }
+            data_ = static_cast<const unsigned char*>(addr);
+        }
+        close(fd);  // The mapping stays valid after closing the descriptor
+    }
+
+    ~MappedFile() {
+        if (data_ != nullptr) {
+            munmap(const_cast<unsigned char*>(data_), size_);
+        }
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const unsigned char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    const unsigned char* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+#endif // MAPPED_FILE_H
@@ -0,0 +1,365 @@
+#ifndef MOVIE_SNAPSHOT_H
+#define MOVIE_SNAPSHOT_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include <cstring>
+#include <cstdint>
+#include <cstdio>       // For std::rename
+#include <stdexcept>
+#include "mapped_file.h"
+#include "movie_store.h"
+#include "trigram_index.h"
+
+/**
+ * Binary snapshot of a node's movies and trigram index.
+ *
+ * Layout (all integers in host byte order, sections 8-byte aligned):
+ *   SnapshotHeader
+ *   SnapshotSection[sections]   one entry per column array
+ *   section data...
+ *
+ * Every ColumnArray of MovieStore and TrigramIndex becomes one section, in
+ * the order of their visitColumns(). Sections hold offsets, never pointers,
+ * so a loader maps the file and points the arrays straight into it without
+ * parsing anything. The checksum covers everything after the header.
+ */
+static const char SNAPSHOT_MAGIC[8] = {'M', 'O', 'V', 'S', 'N', 'A', 'P', '\0'};
+static constexpr uint32_t SNAPSHOT_VERSION = 2;          // Bump when the column layout changes
+static constexpr uint32_t SNAPSHOT_BYTE_ORDER = 0x01020304;
+static constexpr size_t SNAPSHOT_ALIGNMENT = 8;
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t rows;           // Number of movies
+    uint64_t sections;       // Entries in the section table
+    uint64_t payload_bytes;  // Bytes after the header
+    uint64_t checksum;       // SnapshotChecksum of the payload
+    uint64_t reserved[2];
+};
+
+struct SnapshotSection {
+    uint64_t offset;         // From the start of the file
+    uint64_t bytes;
+    uint32_t element_size;   // sizeof the array element, checked on load
+    uint32_t reserved;
+};
+
+static_assert(sizeof(SnapshotHeader) == 64, "Snapshot header layout changed");
+static_assert(sizeof(SnapshotSection) == 24, "Snapshot section layout changed");
+
+/**
+ * 64-bit checksum consumed a word at a time, fast enough to verify a
+ * snapshot on every start. Detects corruption, not tampering.
+ */
+class SnapshotChecksum {
+public:
+    void update(const void* data, size_t size) {
+        const unsigned char* p = static_cast<const unsigned char*>(data);
+        length_ += size;
+        while (size > 0 && pending_ > 0) {
+            buffer_[pending_++] = *p++;
+            size--;
+            if (pending_ == sizeof(buffer_)) {
+                mix(load(buffer_));
+                pending_ = 0;
+            }
+        }
+        while (size >= sizeof(uint64_t)) {
+            mix(load(p));
+            p += sizeof(uint64_t);
+            size -= sizeof(uint64_t);
+        }
+        while (size > 0) {
+            buffer_[pending_++] = *p++;
+            size--;
+        }
+    }
+
+    uint64_t value() const {
+        SnapshotChecksum tail = *this;
+        if (tail.pending_ > 0) {
+            std::memset(tail.buffer_ + tail.pending_, 0, sizeof(tail.buffer_) - tail.pending_);
+            tail.mix(load(tail.buffer_));
+        }
+        // Final avalanche (MurmurHash3 fmix64)
+        uint64_t h = tail.hash_ ^ length_;
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+private:
+    static uint64_t load(const unsigned char* p) {
+        uint64_t word;
+        std::memcpy(&word, p, sizeof(word));
+        return word;
+    }
+
+    void mix(uint64_t word) {
+        hash_ = (hash_ ^ word) * 0x9E3779B97F4A7C15ULL;
+        hash_ ^= hash_ >> 32;
+    }
+
+    uint64_t hash_ = 0xcbf29ce484222325ULL;
+    uint64_t length_ = 0;
+    unsigned char buffer_[8];
+    size_t pending_ = 0;
+};
+
+/**
+ * Column visitor that collects arrays and writes them as a snapshot
+ */
+class SnapshotWriter {
+public:
+    template <typename T>
+    void operator()(const ColumnArray<T>& column) {
+        sections_.push_back({column.data(), column.size() * sizeof(T), sizeof(T)});
+    }
+
+    void operator()(const uint64_t& value) {
+        sections_.push_back({&value, sizeof(value), sizeof(value)});
+    }
+
+    /**
+     * Write the collected arrays; the file is written next to `path` and
+     * renamed into place so readers never see a partial snapshot
+     * @param path Output file
+     * @param rows Number of movies
+     */
+    void write(const std::string& path, uint64_t rows) const {
+        static const char padding[SNAPSHOT_ALIGNMENT] = {};
+
+        std::vector<SnapshotSection> table(sections_.size());
+        uint64_t offset = sizeof(SnapshotHeader) + table.size() * sizeof(SnapshotSection);
+        for (size_t i = 0; i < sections_.size(); i++) {
+            offset = align(offset);
+            table[i].offset = offset;
+            table[i].bytes = sections_[i].bytes;
+            table[i].element_size = static_cast<uint32_t>(sections_[i].element_size);
+            table[i].reserved = 0;
+            offset += sections_[i].bytes;
+        }
+
+        SnapshotHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+        header.version = SNAPSHOT_VERSION;
+        header.byte_order = SNAPSHOT_BYTE_ORDER;
+        header.rows = rows;
+        header.sections = table.size();
+        header.payload_bytes = offset - sizeof(SnapshotHeader);
+
+        std::string tmp_path = path + ".tmp";
+        std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            throw std::runtime_error("Failed to create " + tmp_path);
+        }
+
+        // Header goes first with a zero checksum and is rewritten at the end
+        SnapshotChecksum checksum;
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        writeChecked(out, checksum, table.data(), table.size() * sizeof(SnapshotSection));
+
+        uint64_t position = sizeof(SnapshotHeader) + table.size() * sizeof(SnapshotSection);
+        for (size_t i = 0; i < sections_.size(); i++) {
+            writeChecked(out, checksum, padding, table[i].offset - position);
+            writeChecked(out, checksum, sections_[i].data, sections_[i].bytes);
+            position = table[i].offset + sections_[i].bytes;
+        }
+
+        header.checksum = checksum.value();
+        out.seekp(0);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.close();
+        if (!out) {
+            std::remove(tmp_path.c_str());
+            throw std::runtime_error("Failed to write " + tmp_path);
+        }
+
+        if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+            std::remove(tmp_path.c_str());
+            throw std::runtime_error("Failed to rename " + tmp_path + " to " + path);
+        }
+    }
+
+private:
+    struct Pending {
+        const void* data;
+        size_t bytes;
+        size_t element_size;
+    };
+
+    static uint64_t align(uint64_t offset) {
+        return (offset + SNAPSHOT_ALIGNMENT - 1) & ~static_cast<uint64_t>(SNAPSHOT_ALIGNMENT - 1);
+    }
+
+    static void writeChecked(std::ofstream& out, SnapshotChecksum& checksum, const void* data, size_t bytes) {
+        if (bytes == 0) {
+            return;
+        }
+        checksum.update(data, bytes);
+        out.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+    }
+
+    std::vector<Pending> sections_;
+};
+
+/**
+ * Column visitor that validates a mapped snapshot and points each visited
+ * array at its section
+ */
+class SnapshotReader {
+public:
+    /**
+     * Constructor - checks the header, section table and (optionally) checksum
+     * @param file The mapped snapshot
+     * @param verifyChecksum Whether to checksum the whole payload
+     */
+    SnapshotReader(std::shared_ptr<const MappedFile> file, bool verifyChecksum)
+        : file_(std::move(file)) {
+        if (file_->size() < sizeof(SnapshotHeader)) {
+            throw std::runtime_error("Movie snapshot is truncated");
+        }
+        std::memcpy(&header_, file_->data(), sizeof(header_));
+
+        if (std::memcmp(header_.magic, SNAPSHOT_MAGIC, sizeof(header_.magic)) != 0) {
+            throw std::runtime_error("Not a movie snapshot");
+        }
+        if (header_.version != SNAPSHOT_VERSION) {
+            throw std::runtime_error("Unsupported movie snapshot version " + std::to_string(header_.version) +
+                                     " (expected " + std::to_string(SNAPSHOT_VERSION) + ")");
+        }
+        if (header_.byte_order != SNAPSHOT_BYTE_ORDER) {
+            throw std::runtime_error("Movie snapshot was written on a machine with a different byte order");
+        }
+
+        uint64_t payload = file_->size() - sizeof(SnapshotHeader);
+        if (header_.payload_bytes != payload || header_.sections > payload / sizeof(SnapshotSection)) {
+            throw std::runtime_error("Movie snapshot is truncated");
+        }
+
+        if (verifyChecksum) {
+            SnapshotChecksum checksum;
+            checksum.update(file_->data() + sizeof(SnapshotHeader), payload);
+            if (checksum.value() != header_.checksum) {
+                throw std::runtime_error("Movie snapshot checksum mismatch");
+            }
+        }
+
+        table_.resize(header_.sections);
+        std::memcpy(table_.data(), file_->data() + sizeof(SnapshotHeader), table_.size() * sizeof(SnapshotSection));
+        uint64_t data_start = sizeof(SnapshotHeader) + table_.size() * sizeof(SnapshotSection);
+        for (const auto& section : table_) {
+            if (section.offset < data_start || section.offset % SNAPSHOT_ALIGNMENT != 0 ||
+                section.offset > file_->size() || section.bytes > file_->size() - section.offset) {
+                throw std::runtime_error("Movie snapshot section out of bounds");
+            }
+        }
+    }
+
+    uint64_t rows() const {
+        return header_.rows;
+    }
+
+    template <typename T>
+    void operator()(ColumnArray<T>& column) {
+        const SnapshotSection& section = next(sizeof(T));
+        column.map(reinterpret_cast<const T*>(file_->data() + section.offset),
+                   section.bytes / sizeof(T), file_);
+    }
+
+    void operator()(uint64_t& value) {
+        const SnapshotSection& section = next(sizeof(value));
+        if (section.bytes != sizeof(value)) {
+            throw std::runtime_error("Movie snapshot section has the wrong size");
+        }
+        std::memcpy(&value, file_->data() + section.offset, sizeof(value));
+    }
+
+    /**
+     * Check that every section was consumed
+     */
+    void finish() const {
+        if (next_ != table_.size()) {
+            throw std::runtime_error("Movie snapshot has unexpected extra sections");
+        }
+    }
+
+private:
+    const SnapshotSection& next(size_t element_size) {
+        if (next_ >= table_.size()) {
+            throw std::runtime_error("Movie snapshot has too few sections");
+        }
+        const SnapshotSection& section = table_[next_++];
+        if (section.element_size != element_size || section.bytes % element_size != 0) {
+            throw std::runtime_error("Movie snapshot section has the wrong element type");
+        }
+        return section;
+    }
+
+    std::shared_ptr<const MappedFile> file_;
+    SnapshotHeader header_;
+    std::vector<SnapshotSection> table_;
+    size_t next_ = 0;
+};
+
+/**
+ * Check whether a data file is a movie snapshot (rather than a CSV)
+ * @param path Path of the data file
+ * @return Whether the file starts with the snapshot magic
+ */
+static inline bool isMovieSnapshot(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    char magic[sizeof(SNAPSHOT_MAGIC)];
+    return in.read(magic, sizeof(magic)) && std::memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) == 0;
+}
+
+/**
+ * Write a node's movies and trigram index to a snapshot file
+ * @param path Output file
+ * @param movies The movie store
+ * @param index Trigram index built over the same movies
+ */
+static inline void writeMovieSnapshot(const std::string& path, const MovieStore& movies, const TrigramIndex& index) {
+    SnapshotWriter writer;
+    movies.visitColumns(writer);
+    index.visitColumns(writer);
+    writer.write(path, movies.size());
+}
+
+/**
+ * Map a snapshot and serve the movies and index directly from the mapping
+ * @param path Snapshot file
+ * @param movies Receives the mapped movie store
+ * @param index Receives the mapped trigram index
+ * @param verifyChecksum Whether to checksum the whole file first
+ * @throws std::runtime_error If the file is not a valid snapshot
+ */
+static inline void loadMovieSnapshot(const std::string& path, MovieStore& movies, TrigramIndex& index,
+                                     bool verifyChecksum = true) {
+    SnapshotReader reader(std::make_shared<const MappedFile>(path), verifyChecksum);
+
+    MovieStore mappedMovies;
+    TrigramIndex mappedIndex;
+    mappedMovies.visitColumns(reader);
+    mappedIndex.visitColumns(reader);
+    reader.finish();
+
+    if (mappedMovies.size() != reader.rows() || !mappedMovies.valid() ||
+        !mappedIndex.valid(mappedMovies.size())) {
+        throw std::runtime_error("Movie snapshot " + path + " is inconsistent");
+    }
+
+    movies = std::move(mappedMovies);
+    index = std::move(mappedIndex);
+}
+
+#endif // MOVIE_SNAPSHOT_H
@@ -0,0 +1,649 @@
+#ifndef MOVIE_STORE_H
+#define MOVIE_STORE_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include "movie_struct.h"
+#include "substring_search.h"
+
+/**
+ * Flat array of fixed-size values that either owns its elements or views
+ * an immutable region of a memory-mapped snapshot (see movie_snapshot.h).
+ * Appending is only valid while the array owns its elements.
+ */
+template <typename T>
+class ColumnArray {
+public:
+    void push_back(const T& value) {
+        owned_.push_back(value);
+    }
+
+    template <typename Iterator>
+    void append(Iterator first, Iterator last) {
+        owned_.insert(owned_.end(), first, last);
+    }
+
+    void reserve(size_t count) {
+        owned_.reserve(count);
+    }
+
+    void clear() {
+        owned_.clear();
+        mapped_ = nullptr;
+        mapped_size_ = 0;
+        mapping_.reset();
+    }
+
+    void shrink() {
+        owned_.shrink_to_fit();
+    }
+
+    /**
+     * View `count` elements of a mapped region instead of owning them
+     * @param data First element inside the mapping
+     * @param count Number of elements
+     * @param mapping Keeps the mapping alive as long as this array views it
+     */
+    void map(const T* data, size_t count, std::shared_ptr<const void> mapping) {
+        owned_.clear();
+        owned_.shrink_to_fit();
+        mapped_ = data;
+        mapped_size_ = count;
+        mapping_ = std::move(mapping);
+    }
+
+    bool mapped() const { return mapping_ != nullptr; }
+    const T* data() const { return mapping_ ? mapped_ : owned_.data(); }
+    size_t size() const { return mapping_ ? mapped_size_ : owned_.size(); }
+    bool empty() const { return size() == 0; }
+    const T* begin() const { return data(); }
+    const T* end() const { return data() + size(); }
+    const T& back() const { return data()[size() - 1]; }
+    const T& operator[](size_t i) const { return data()[i]; }
+
+    /**
+     * Get the bytes held on the heap, or viewed in the mapping
+     */
+    size_t bytes() const {
+        return (mapping_ ? mapped_size_ : owned_.capacity()) * sizeof(T);
+    }
+
+private:
+    std::vector<T> owned_;
+    const T* mapped_ = nullptr;
+    size_t mapped_size_ = 0;
+    std::shared_ptr<const void> mapping_;
+};
+
+/**
+ * A group of string columns stored back to back in one contiguous arena.
+ * Values are appended in row order and addressed through per-column
+ * offset/length arrays.
+ */
+class StringArena {
+public:
+    StringArena() = default;
+
+    explicit StringArena(size_t columns)
+        : offsets_(columns), lengths_(columns) {}
+
+    /**
+     * Append the value of one column for the next row
+     * @param column Column index
+     * @param value The string to store
+     */
+    void append(size_t column, std::string_view value) {
+        offsets_[column].push_back(static_cast<uint32_t>(data_.size()));
+        lengths_[column].push_back(static_cast<uint32_t>(value.size()));
+        data_.append(value.begin(), value.end());
+    }
+
+    std::string_view get(size_t column, size_t row) const {
+        return std::string_view(data_.data() + offsets_[column][row], lengths_[column][row]);
+    }
+
+    /**
+     * Get the number of rows appended so far
+     */
+    size_t rows() const {
+        return offsets_.empty() ? 0 : offsets_[0].size();
+    }
+
+    /**
+     * Release spare capacity once all rows have been appended
+     */
+    void shrink() {
+        data_.shrink();
+        for (auto& offsets : offsets_) offsets.shrink();
+        for (auto& lengths : lengths_) lengths.shrink();
+    }
+
+    /**
+     * Check that every column has `rows` entries inside the arena
+     * @return Whether the arena is consistent
+     */
+    bool valid(size_t rows) const {
+        for (size_t column = 0; column < offsets_.size(); column++) {
+            if (offsets_[column].size() != rows || lengths_[column].size() != rows) {
+                return false;
+            }
+            for (size_t row = 0; row < rows; row++) {
+                if (static_cast<uint64_t>(offsets_[column][row]) + lengths_[column][row] > data_.size()) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Get the bytes held by the arena and its offset/length arrays
+     */
+    size_t bytes() const {
+        size_t total = data_.bytes();
+        for (const auto& offsets : offsets_) total += offsets.bytes();
+        for (const auto& lengths : lengths_) total += lengths.bytes();
+        return total;
+    }
+
+    /**
+     * Call visit(array) on every array of the arena in a fixed order
+     */
+    template <typename Visitor>
+    void visitColumns(Visitor& visit) {
+        visit(data_);
+        for (auto& offsets : offsets_) visit(offsets);
+        for (auto& lengths : lengths_) visit(lengths);
+    }
+
+    template <typename Visitor>
+    void visitColumns(Visitor& visit) const {
+        visit(data_);
+        for (const auto& offsets : offsets_) visit(offsets);
+        for (const auto& lengths : lengths_) visit(lengths);
+    }
+
+private:
+    ColumnArray<char> data_;
+    std::vector<ColumnArray<uint32_t>> offsets_;
+    std::vector<ColumnArray<uint32_t>> lengths_;
+};
+
+/**
+ * A string column with few distinct values (genres, languages, ...),
+ * stored as one integer code per row plus a dictionary holding each
+ * distinct value once. Every entry also keeps its lowercased form, so a
+ * query is matched once per distinct value and rows only look up their
+ * code.
+ */
+class DictionaryColumn {
+public:
+    DictionaryColumn() : entries_(ENTRY_FIELD_COUNT) {}
+
+    /**
+     * Append the value of the next row, adding it to the dictionary if new
+     * @param value The string to store
+     */
+    void append(std::string_view value) {
+        auto it = lookup_.find(std::string(value));
+        uint32_t code;
+        if (it != lookup_.end()) {
+            code = it->second;
+        } else {
+            code = static_cast<uint32_t>(entries_.rows());
+            entries_.append(ENTRY_VALUE, value);
+            entries_.append(ENTRY_LOWER, toLowerCopy(std::string(value)));
+            lookup_.emplace(std::string(value), code);
+        }
+        codes_.push_back(code);
+    }
+
+    void reserve(size_t rows) {
+        codes_.reserve(rows);
+    }
+
+    /**
+     * Release spare capacity and the build-time lookup table once all rows
+     * have been appended
+     */
+    void shrink() {
+        entries_.shrink();
+        codes_.shrink();
+        lookup_ = std::unordered_map<std::string, uint32_t>();
+    }
+
+    std::string_view get(size_t row) const {
+        return entries_.get(ENTRY_VALUE, codes_[row]);
+    }
+
+    std::string_view lower(size_t row) const {
+        return entries_.get(ENTRY_LOWER, codes_[row]);
+    }
+
+    uint32_t code(size_t row) const {
+        return codes_[row];
+    }
+
+    /**
+     * Get the number of distinct values
+     */
+    size_t entries() const {
+        return entries_.rows();
+    }
+
+    /**
+     * Match a lowercased query against every distinct value once
+     * @return One flag per dictionary entry, indexed by code
+     */
+    std::vector<uint8_t> matchEntries(std::string_view lowerQuery) const {
+        std::vector<uint8_t> matched(entries(), 0);
+        for (size_t code = 0; code < matched.size(); code++) {
+            matched[code] = CaseInsensitiveSearch::contains(entries_.get(ENTRY_LOWER, code), lowerQuery) ? 1 : 0;
+        }
+        return matched;
+    }
+
+    /**
+     * Check that there is one code per row and every code names an entry
+     * @return Whether the column is consistent
+     */
+    bool valid(size_t rows) const {
+        size_t count = entries();
+        if (codes_.size() != rows || !entries_.valid(count)) {
+            return false;
+        }
+        for (uint32_t code : codes_) {
+            if (code >= count) return false;
+        }
+        return true;
+    }
+
+    /**
+     * Get the bytes held by the codes and the dictionary
+     */
+    size_t bytes() const {
+        return entries_.bytes() + codes_.bytes();
+    }
+
+    /**
+     * Call visit(array) on every array of the column in a fixed order
+     */
+    template <typename Visitor>
+    void visitColumns(Visitor& visit) {
+        entries_.visitColumns(visit);
+        visit(codes_);
+    }
+
+    template <typename Visitor>
+    void visitColumns(Visitor& visit) const {
+        entries_.visitColumns(visit);
+        visit(codes_);
+    }
+
+private:
+    enum EntryField { ENTRY_VALUE, ENTRY_LOWER, ENTRY_FIELD_COUNT };
+
+    StringArena entries_;                                // Distinct values, indexed by code
+    ColumnArray<uint32_t> codes_;                        // One code per row
+    std::unordered_map<std::string, uint32_t> lookup_;   // Value -> code, only while building
+};
+
+/**
+ * Column-oriented (struct-of-arrays) movie storage used by the servers.
+ *
+ * Each searched text field is kept lowercased in its own arena so a scan
+ * walks one field of all movies sequentially. The fields needed to build
+ * search results live in a second arena and everything else (paths,
+ * homepage, tagline, ...) in a cold arena that the search path never
+ * touches. Low-cardinality fields (genres, status, languages, countries)
+ * are dictionary-encoded, so genre matching is a per-row code lookup.
+ * All columns can also be mapped from a binary snapshot (movie_snapshot.h).
+ */
+class MovieStore {
+public:
+    // Lowercased columns used for matching
+    enum SearchField { TITLE, GENRES, OVERVIEW, KEYWORDS, SEARCH_FIELD_COUNT };
+
+    /**
+     * Display fields needed to build a MovieInfo result
+     */
+    struct ResultFields {
+        std::string_view title;
+        std::string_view genres;
+        std::string_view production_companies;
+        std::string_view release_date;
+    };
+
+    /**
+     * A lowercased query with its dictionary matches precomputed, so
+     * checking a row costs one lookup per dictionary-encoded field
+     */
+    struct PreparedQuery {
+        std::string_view lower;
+        std::vector<uint8_t> genres;  // Matched genre entries; empty = compare each row's text
+    };
+
+    MovieStore() : MovieStore(std::vector<Movie>()) {}
+
+    /**
+     * Build the store from loaded movies
+     * @param movies Movies with prepared search fields
+     */
+    explicit MovieStore(const std::vector<Movie>& movies)
+        : result_(RESULT_FIELD_COUNT), cold_(COLD_FIELD_COUNT) {
+        for (SearchField field : TEXT_FIELDS) {
+            search_[field] = StringArena(1);
+        }
+
+        size_t n = movies.size();
+        genres_.reserve(n);
+        statuses_.reserve(n);
+        original_languages_.reserve(n);
+        production_countries_.reserve(n);
+        spoken_languages_.reserve(n);
+        ids_.reserve(n);
+        vote_averages_.reserve(n);
+        vote_counts_.reserve(n);
+        revenues_.reserve(n);
+        runtimes_.reserve(n);
+        adult_.reserve(n);
+        budgets_.reserve(n);
+        popularities_.reserve(n);
+
+        for (const auto& movie : movies) {
+            search_[TITLE].append(0, movie.title_lower);
+            search_[OVERVIEW].append(0, movie.overview_lower);
+            search_[KEYWORDS].append(0, movie.keywords_lower);
+
+            result_.append(RESULT_TITLE, movie.title);
+            result_.append(RESULT_COMPANIES, movie.production_companies);
+            result_.append(RESULT_RELEASE_DATE, movie.release_date);
+
+            cold_.append(COLD_BACKDROP_PATH, movie.backdrop_path);
+            cold_.append(COLD_HOMEPAGE, movie.homepage);
+            cold_.append(COLD_IMDB_ID, movie.imdb_id);
+            cold_.append(COLD_ORIGINAL_TITLE, movie.original_title);
+            cold_.append(COLD_OVERVIEW, movie.overview);
+            cold_.append(COLD_POSTER_PATH, movie.poster_path);
+            cold_.append(COLD_TAGLINE, movie.tagline);
+            cold_.append(COLD_KEYWORDS, movie.keywords);
+
+            genres_.append(movie.genres);
+            statuses_.append(movie.status);
+            original_languages_.append(movie.original_language);
+            production_countries_.append(movie.production_countries);
+            spoken_languages_.append(movie.spoken_languages);
+
+            ids_.push_back(movie.id);
+            vote_averages_.push_back(movie.vote_average);
+            vote_counts_.push_back(movie.vote_count);
+            revenues_.push_back(movie.revenue);
+            runtimes_.push_back(movie.runtime);
+            adult_.push_back(movie.adult ? 1 : 0);
+            budgets_.push_back(movie.budget);
+            popularities_.push_back(movie.popularity);
+        }
+
+        for (auto& column : search_) {
+            column.shrink();
+        }
+        result_.shrink();
+        cold_.shrink();
+        genres_.shrink();
+        statuses_.shrink();
+        original_languages_.shrink();
+        production_countries_.shrink();
+        spoken_languages_.shrink();
+    }
+
+    size_t size() const {
+        return ids_.size();
+    }
+
+    bool empty() const {
+        return ids_.empty();
+    }
+
+    /**
+     * Get a lowercased searched field of a movie
+     */
+    std::string_view searchField(SearchField field, size_t row) const {
+        return field == GENRES ? genres_.lower(row) : search_[field].get(0, row);
+    }
+
+    /**
+     * Get the display fields used to build a search result
+     */
+    ResultFields resultFields(size_t row) const {
+        ResultFields fields;
+        fields.title = result_.get(RESULT_TITLE, row);
+        fields.genres = genres_.get(row);
+        fields.production_companies = result_.get(RESULT_COMPANIES, row);
+        fields.release_date = result_.get(RESULT_RELEASE_DATE, row);
+        return fields;
+    }
+
+    /**
+     * Prepare a lowercased query for matches() and scan(). The dictionary is
+     * only matched up front when at least as many rows will be checked as it
+     * has entries; for fewer rows each row's value is compared directly.
+     * @param lowerQuery The lowercased query; must outlive the result
+     * @param rows Number of rows that will be checked
+     */
+    PreparedQuery prepare(std::string_view lowerQuery, size_t rows) const {
+        PreparedQuery query;
+        query.lower = lowerQuery;
+        if (rows >= genres_.entries()) {
+            query.genres = genres_.matchEntries(lowerQuery);
+        }
+        return query;
+    }
+
+    PreparedQuery prepare(std::string_view lowerQuery) const {
+        return prepare(lowerQuery, size());
+    }
+
+    /**
+     * Check if a movie matches a lowercased query (see movieMatchesQuery)
+     */
+    bool matches(size_t row, std::string_view lowerQuery) const {
+        return matches(row, prepare(lowerQuery, 1));
+    }
+
+    bool matches(size_t row, const PreparedQuery& query) const {
+        if (query.genres.empty() ? CaseInsensitiveSearch::contains(genres_.lower(row), query.lower)
+                                 : query.genres[genres_.code(row)] != 0) {
+            return true;
+        }
+        for (SearchField field : TEXT_FIELDS) {
+            if (CaseInsensitiveSearch::contains(search_[field].get(0, row), query.lower)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * Scan all movies for a lowercased query (see scan(begin, end))
+     * @return Indices of matching movies in ascending order
+     */
+    std::vector<uint32_t> scan(std::string_view lowerQuery) const {
+        std::vector<uint32_t> rows;
+        scan(prepare(lowerQuery), 0, size(), rows);
+        return rows;
+    }
+
+    void scan(std::string_view lowerQuery, size_t begin, size_t end, std::vector<uint32_t>& rows) const {
+        scan(prepare(lowerQuery, end - begin), begin, end, rows);
+    }
+
+    /**
+     * Scan a range of movies for a prepared query one column at a time, so
+     * each pass reads a single arena sequentially. Genres are checked first
+     * since they only need a code lookup.
+     * @param rows Receives the indices of matching movies in ascending order
+     */
+    void scan(const PreparedQuery& query, size_t begin, size_t end, std::vector<uint32_t>& rows) const {
+        std::vector<uint8_t> matched(end - begin, 0);
+        for (size_t row = begin; row < end; row++) {
+            matched[row - begin] = query.genres.empty()
+                ? CaseInsensitiveSearch::contains(genres_.lower(row), query.lower)
+                : query.genres[genres_.code(row)];
+        }
+        for (SearchField field : TEXT_FIELDS) {
+            const StringArena& column = search_[field];
+            for (size_t row = begin; row < end; row++) {
+                if (!matched[row - begin] && CaseInsensitiveSearch::contains(column.get(0, row), query.lower)) {
+                    matched[row - begin] = 1;
+                }
+            }
+        }
+
+        for (size_t row = begin; row < end; row++) {
+            if (matched[row - begin]) {
+                rows.push_back(static_cast<uint32_t>(row));
+            }
+        }
+    }
+
+    /**
+     * Materialize a full Movie (including cold fields) for a row
+     */
+    Movie movie(size_t row) const {
+        Movie movie;
+        ResultFields fields = resultFields(row);
+        movie.id = ids_[row];
+        movie.title = std::string(fields.title);
+        movie.vote_average = vote_averages_[row];
+        movie.vote_count = vote_counts_[row];
+        movie.status = std::string(statuses_.get(row));
+        movie.release_date = std::string(fields.release_date);
+        movie.revenue = revenues_[row];
+        movie.runtime = runtimes_[row];
+        movie.adult = adult_[row] != 0;
+        movie.backdrop_path = std::string(cold_.get(COLD_BACKDROP_PATH, row));
+        movie.budget = budgets_[row];
+        movie.homepage = std::string(cold_.get(COLD_HOMEPAGE, row));
+        movie.imdb_id = std::string(cold_.get(COLD_IMDB_ID, row));
+        movie.original_language = std::string(original_languages_.get(row));
+        movie.original_title = std::string(cold_.get(COLD_ORIGINAL_TITLE, row));
+        movie.overview = std::string(cold_.get(COLD_OVERVIEW, row));
+        movie.popularity = popularities_[row];
+        movie.poster_path = std::string(cold_.get(COLD_POSTER_PATH, row));
+        movie.tagline = std::string(cold_.get(COLD_TAGLINE, row));
+        movie.genres = std::string(fields.genres);
+        movie.production_companies = std::string(fields.production_companies);
+        movie.production_countries = std::string(production_countries_.get(row));
+        movie.spoken_languages = std::string(spoken_languages_.get(row));
+        movie.keywords = std::string(cold_.get(COLD_KEYWORDS, row));
+        prepareSearchFields(movie);
+        return movie;
+    }
+
+    /**
+     * Get the bytes held by the searched columns
+     */
+    size_t searchBytes() const {
+        size_t total = genres_.bytes();
+        for (const auto& column : search_) total += column.bytes();
+        return total;
+    }
+
+    /**
+     * Get the bytes held by the result and cold columns
+     */
+    size_t otherBytes() const {
+        size_t numeric = ids_.bytes() + vote_averages_.bytes() + vote_counts_.bytes() + revenues_.bytes() +
+                         runtimes_.bytes() + adult_.bytes() + budgets_.bytes() + popularities_.bytes();
+        size_t dictionaries = statuses_.bytes() + original_languages_.bytes() +
+                              production_countries_.bytes() + spoken_languages_.bytes();
+        return result_.bytes() + cold_.bytes() + dictionaries + numeric;
+    }
+
+    /**
+     * Check that all columns have one entry per movie and every string lies
+     * inside its arena (used after mapping a snapshot)
+     */
+    bool valid() const {
+        size_t rows = size();
+        for (SearchField field : TEXT_FIELDS) {
+            if (!search_[field].valid(rows)) return false;
+        }
+        return result_.valid(rows) && cold_.valid(rows) &&
+               genres_.valid(rows) && statuses_.valid(rows) && original_languages_.valid(rows) &&
+               production_countries_.valid(rows) && spoken_languages_.valid(rows) &&
+               vote_averages_.size() == rows && vote_counts_.size() == rows && revenues_.size() == rows &&
+               runtimes_.size() == rows && adult_.size() == rows && budgets_.size() == rows &&
+               popularities_.size() == rows;
+    }
+
+    /**
+     * Call visit(array) on every column array in a fixed order; this order
+     * is the snapshot layout, so changing it needs a new snapshot version
+     */
+    template <typename Visitor>
+    void visitColumns(Visitor& visit) {
+        visitColumnsOf(*this, visit);
+    }
+
+    template <typename Visitor>
+    void visitColumns(Visitor& visit) const {
+        visitColumnsOf(*this, visit);
+    }
+
+private:
+    enum ResultField { RESULT_TITLE, RESULT_COMPANIES, RESULT_RELEASE_DATE, RESULT_FIELD_COUNT };
+
+    enum ColdField {
+        COLD_BACKDROP_PATH, COLD_HOMEPAGE, COLD_IMDB_ID, COLD_ORIGINAL_TITLE, COLD_OVERVIEW,
+        COLD_POSTER_PATH, COLD_TAGLINE, COLD_KEYWORDS, COLD_FIELD_COUNT
+    };
+
+    // Searched fields kept as lowercased text; GENRES is dictionary-encoded
+    static constexpr SearchField TEXT_FIELDS[] = { TITLE, OVERVIEW, KEYWORDS };
+
+    template <typename Self, typename Visitor>
+    static void visitColumnsOf(Self& self, Visitor& visit) {
+        for (auto& column : self.search_) column.visitColumns(visit);
+        self.result_.visitColumns(visit);
+        self.cold_.visitColumns(visit);
+        self.genres_.visitColumns(visit);
+        self.statuses_.visitColumns(visit);
+        self.original_languages_.visitColumns(visit);
+        self.production_countries_.visitColumns(visit);
+        self.spoken_languages_.visitColumns(visit);
+        visit(self.ids_);
+        visit(self.vote_averages_);
+        visit(self.vote_counts_);
+        visit(self.revenues_);
+        visit(self.runtimes_);
+        visit(self.adult_);
+        visit(self.budgets_);
+        visit(self.popularities_);
+    }
+
+    StringArena search_[SEARCH_FIELD_COUNT];  // One arena per searched text field (GENRES slot unused)
+    StringArena result_;                      // Fields copied into results
+    StringArena cold_;                        // Fields never read on the search path
+
+    DictionaryColumn genres_;
+    DictionaryColumn statuses_;
+    DictionaryColumn original_languages_;
+    DictionaryColumn production_countries_;
+    DictionaryColumn spoken_languages_;
+
+    ColumnArray<int> ids_;
+    ColumnArray<double> vote_averages_;
+    ColumnArray<int> vote_counts_;
+    ColumnArray<int64_t> revenues_;
+    ColumnArray<int> runtimes_;
+    ColumnArray<uint8_t> adult_;
+    ColumnArray<int64_t> budgets_;
+    ColumnArray<double> popularities_;
+};
+
+#endif // MOVIE_STORE_H
@@ -7,6 +7,12 @@
 #include <fstream>
 #include <sstream>
 #include <algorithm>
+#include <cctype>
+#include <string_view>
+#include <iterator>
+#include <cstdint>
+#include "substring_search.h"
+#include "csv_tokenizer.h"
 
 // Structure to hold movie data based on TMDB format
 struct Movie {
@@ -34,94 +40,119 @@ struct Movie {
     std::string production_countries;
     std::string spoken_languages;
     std::string keywords;
+
+    // Lowercased copies of the searched fields, built once at load time so
+    // the match path never has to allocate or transform per query
+    std::string title_lower;
+    std::string genres_lower;
+    std::string overview_lower;
+    std::string keywords_lower;
 };
 
-// Trim whitespace from start and end of string
-static inline std::string trim(const std::string& str) {
-    std::string s = str;
-    s.erase(s.begin(), std::find_if(s.begin(), s.end(), [](unsigned char ch) {
-        return !std::isspace(ch);
-    }));
-    s.erase(std::find_if(s.rbegin(), s.rend(), [](unsigned char ch) {
-        return !std::isspace(ch);
-    }).base(), s.end());
-    return s;
+// Return a lowercased copy of a string (used for queries and search fields)
+static inline std::string toLowerCopy(const std::string& str) {
+    std::string lower = str;
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char ch) {
+        return static_cast<char>(std::tolower(ch));
+    });
+    return lower;
 }
 
-// Parse a CSV line while respecting quotes
-static std::vector<std::string> parseCSVLine(const std::string& line) {
-    std::vector<std::string> result;
-    bool inQuotes = false;
-    std::string field;
-    
-    for (char c : line) {
-        if (c == '\"') {
-            inQuotes = !inQuotes;
-        } else if (c == ',' && !inQuotes) {
-            result.push_back(trim(field));
-            field.clear();
-        } else {
-            field += c;
-        }
+// Fill in the lowercased search fields of a movie from its display fields
+static inline void prepareSearchFields(Movie& movie) {
+    movie.title_lower = toLowerCopy(movie.title);
+    movie.genres_lower = toLowerCopy(movie.genres);
+    movie.overview_lower = toLowerCopy(movie.overview);
+    movie.keywords_lower = toLowerCopy(movie.keywords);
+}
+
+// Check if a movie matches a query. The query must already be lowercased
+// (see toLowerCopy) so that matching runs against the prepared fields
+// without any per-movie allocation, using the vectorized substring kernel.
+static inline bool movieMatchesQuery(const Movie& movie, const std::string& lowerQuery) {
+    return
+        CaseInsensitiveSearch::contains(movie.title_lower, lowerQuery) ||
+        CaseInsensitiveSearch::contains(movie.genres_lower, lowerQuery) ||
+        CaseInsensitiveSearch::contains(movie.overview_lower, lowerQuery) ||
+        CaseInsensitiveSearch::contains(movie.keywords_lower, lowerQuery);
+}
+
+// Convert numeric CSV fields (short, so the std::string stays in SSO storage)
+static inline int toInt(std::string_view field) { return std::stoi(std::string(field)); }
+static inline int64_t toInt64(std::string_view field) { return std::stoll(std::string(field)); }
+static inline double toDouble(std::string_view field) { return std::stod(std::string(field)); }
+
+// Build a movie from the 24 fields of a TMDB CSV record (see
+// loadMoviesFromCSV). Throws std::invalid_argument/std::out_of_range on a
+// malformed number.
+static inline Movie movieFromFields(const std::vector<std::string_view>& fields) {
+    Movie movie;
+    movie.id = fields[0].empty() ? 0 : toInt(fields[0]);
+    movie.title = std::string(fields[1]);
+    movie.vote_average = fields[2].empty() ? 0.0 : toDouble(fields[2]);
+    movie.vote_count = fields[3].empty() ? 0 : toInt(fields[3]);
+    movie.status = std::string(fields[4]);
+    movie.release_date = std::string(fields[5]);
+    movie.revenue = fields[6].empty() ? 0 : toInt64(fields[6]);
+    movie.runtime = fields[7].empty() ? 0 : toInt(fields[7]);
+    movie.adult = (fields[8] == "TRUE" || fields[8] == "true");
+    movie.backdrop_path = std::string(fields[9]);
+    movie.budget = fields[10].empty() ? 0 : toInt64(fields[10]);
+    movie.homepage = std::string(fields[11]);
+    movie.imdb_id = std::string(fields[12]);
+    movie.original_language = std::string(fields[13]);
+    movie.original_title = std::string(fields[14]);
+    movie.overview = std::string(fields[15]);
+    movie.popularity = fields[16].empty() ? 0.0 : toDouble(fields[16]);
+    movie.poster_path = std::string(fields[17]);
+    movie.tagline = std::string(fields[18]);
+    movie.genres = std::string(fields[19]);
+    movie.production_companies = std::string(fields[20]);
+    movie.production_countries = std::string(fields[21]);
+    movie.spoken_languages = std::string(fields[22]);
+    movie.keywords = std::string(fields[23]);
+    prepareSearchFields(movie);
+    return movie;
+}
+
+// Convert one tokenized CSV record and append it to `movies`
+// @return Empty on success, otherwise the warning for the skipped row
+static inline std::string addMovieRecord(const std::vector<std::string_view>& fields, std::vector<Movie>& movies) {
+    // Check if we have all fields
+    if (fields.size() < 24) {
+        return "Warning: Skipping incomplete row in CSV";
     }
-    result.push_back(trim(field)); // Add the last field
-    
-    return result;
+
+    try {
+        movies.push_back(movieFromFields(fields));
+    } catch (const std::exception& e) {
+        return std::string("Error parsing movie data: ") + e.what();
+    }
+    return std::string();
 }
 
-// Function to load movies from TMDB CSV format
-static std::vector<Movie> loadMoviesFromCSV(const std::string& filename) {
+// Function to load movies from TMDB CSV format (sequentially, see
+// csv_loader.h for the parallel loader the servers use)
+static inline std::vector<Movie> loadMoviesFromCSV(const std::string& filename) {
     std::vector<Movie> movies;
-    std::ifstream file(filename);
+    std::ifstream file(filename, std::ios::binary);
     
     if (!file.is_open()) {
         std::cerr << "Failed to open file: " << filename << std::endl;
         return movies;
     }
     
-    std::string line;
-    // Skip header line
-    std::getline(file, line);
+    std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    CSVTokenizer tokenizer;
+
+    // Skip header record
+    size_t pos = tokenizer.parseRecord(data, 0);
     
-    while (std::getline(file, line)) {
-        std::vector<std::string> fields = parseCSVLine(line);
-        
-        // Check if we have all fields
-        if (fields.size() < 24) {
-            std::cerr << "Warning: Skipping incomplete row in CSV" << std::endl;
-            continue;
-        }
-        
-        try {
-            Movie movie;
-            movie.id = fields[0].empty() ? 0 : std::stoi(fields[0]);
-            movie.title = fields[1];
-            movie.vote_average = fields[2].empty() ? 0.0 : std::stod(fields[2]);
-            movie.vote_count = fields[3].empty() ? 0 : std::stoi(fields[3]);
-            movie.status = fields[4];
-            movie.release_date = fields[5];
-            movie.revenue = fields[6].empty() ? 0 : std::stoll(fields[6]);
-            movie.runtime = fields[7].empty() ? 0 : std::stoi(fields[7]);
-            movie.adult = (fields[8] == "TRUE" || fields[8] == "true");
-            movie.backdrop_path = fields[9];
-            movie.budget = fields[10].empty() ? 0 : std::stoll(fields[10]);
-            movie.homepage = fields[11];
-            movie.imdb_id = fields[12];
-            movie.original_language = fields[13];
-            movie.original_title = fields[14];
-            movie.overview = fields[15];
-            movie.popularity = fields[16].empty() ? 0.0 : std::stod(fields[16]);
-            movie.poster_path = fields[17];
-            movie.tagline = fields[18];
-            movie.genres = fields[19];
-            movie.production_companies = fields[20];
-            movie.production_countries = fields[21];
-            movie.spoken_languages = fields[22];
-            movie.keywords = fields[23];
-            
-            movies.push_back(movie);
-        } catch (const std::exception& e) {
-            std::cerr << "Error parsing movie data: " << e.what() << std::endl;
+    while (pos < data.size()) {
+        pos = tokenizer.parseRecord(data, pos);
+        std::string warning = addMovieRecord(tokenizer.fields(), movies);
+        if (!warning.empty()) {
+            std::cerr << warning << std::endl;
         }
     }
     
@@ -26,11 +26,60 @@
 #include <semaphore.h>  // For POSIX semaphores
 #include <cstdint>      // For uint8_t
 #include <ctime>        // For time_t
+#include <atomic>       // For the seqlocks shared between processes
+#include <thread>       // For std::this_thread::yield and the compactor
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <algorithm>    // For std::min, std::max
 
 /**
  * A POSIX-based shared memory implementation for inter-process communication.
  * Uses shm_open and mmap to create and map shared memory.
  * Uses POSIX named semaphores for synchronization.
+ *
+ * Layout (LAYOUT_VERSION 5):
+ *   Header
+ *   Slot[slotCount]         open-addressing hash table, linear probing
+ *   uint32_t[slotCount]     last access time of each slot's entry (seconds)
+ *   blocks...               EntryHeader, key, value; rounded up to a size class
+ *
+ * Each slot holds the 64-bit hash of its key and the entry's offset, so a
+ * lookup compares hashes first and only reads the entry of a matching
+ * slot. Removed keys leave tombstones, which keep probe chains intact
+ * until the table is rebuilt when they fill it up. The table size is
+ * fixed when the segment is created (one slot per BYTES_PER_SLOT bytes);
+ * a segment written with another layout version is rebuilt empty by its
+ * creator.
+ *
+ * Entries live in blocks of SIZE_CLASSES size classes, four per power of
+ * two from 64 bytes, so a block wastes at most a fifth of its size. Freed
+ * blocks go on a per-class free list and are reused by the next entry of
+ * that class; an entry that still fits its block is updated in place.
+ * Blocks are only carved from the unused end of the segment when their
+ * class has no free block, so a write never scans or copies the segment.
+ * Space stranded on the free lists of other classes is returned by
+ * compaction, which slides live blocks down in bounded steps (see
+ * compactStep()), usually from a background thread (startCompactor()).
+ *
+ * By default a full segment refuses writes. With setEvictionPolicy() it
+ * evicts instead: each eviction takes the least recently read of
+ * EVICTION_SAMPLES entries from a pseudo-random slot on (an approximate
+ * LRU), preferring entries whose blocks fit the new entry.
+ * Entries older than the optional TTL are evicted first and are misses
+ * for readers. The policy and its counters live in the segment, so every
+ * process applies and sees the same ones.
+ *
+ * Writers hold the semaphore; readers take no lock. Each entry has a
+ * version counter (a seqlock) that writers make odd while they change the
+ * entry, and the header has one for changes that move entries or rebuild
+ * the table (compaction steps, clear). A reader copies the value, then
+ * checks that neither counter moved, and retries otherwise. After
+ * OPTIMISTIC_READ_ATTEMPTS torn reads it falls back to the lock. Access
+ * times are kept beside the table rather than in the blocks, so a reader
+ * holding a stale offset can never write into a block that was moved or
+ * reused; they are only stored when the second has changed, so
+ * concurrent hits on one entry don't keep writing to one cache line.
  */
 class PosixSharedMemory {
 public:
@@ -46,6 +95,12 @@ public:
         if (name.empty() || name[0] != '/') {
             throw std::invalid_argument("Shared memory name must start with '/'");
         }
+        if (size > MAX_SEGMENT_SIZE) {
+            throw std::invalid_argument("Shared memory segments are limited to 4 GB");
+        }
+        if (create && size <= sizeof(Header) + MIN_SLOTS * (sizeof(Slot) + sizeof(uint32_t))) {
+            throw std::invalid_argument("Shared memory segment is too small");
+        }
         
         // Create semaphore name from shared memory name
         std::string semName = name + "_sem";
@@ -103,15 +158,22 @@ public:
         }
         
         // Initialize header if we're the creator
+        Header* header = getHeader();
         if (create) {
-            // Check if memory is already initialized
-            Header* header = getHeader();
-            if (header->magic != MAGIC_NUMBER) {
-                // Initialize header
-                header->magic = MAGIC_NUMBER;
-                header->entryCount = 0;
-                header->usedBytes = 0;
+            // Check if memory is already initialized with this layout
+            if (!validLayout()) {
+                if (header->magic == MAGIC_NUMBER) {
+                    std::cout << "Rebuilding shared memory " << name_ << " (layout version " << header->version
+                              << ", expected " << LAYOUT_VERSION << ")" << std::endl;
+                }
+                getHeader()->layoutSequence.store(0, std::memory_order_relaxed);
+                initialize();
             }
+        } else if (!validLayout()) {
+            munmap(data_, size_);
+            close(fd_);
+            sem_close(sem_);
+            throw std::runtime_error("Shared memory " + name_ + " has an incompatible layout");
         }
     }
     
@@ -119,6 +181,8 @@ public:
      * Destructor - unmaps shared memory and closes semaphore
      */
     ~PosixSharedMemory() {
+        stopCompactor();
+        
         if (data_ != MAP_FAILED && data_ != nullptr) {
             munmap(data_, size_);
         }
@@ -150,77 +214,88 @@ public:
             // Get the header
             Header* header = getHeader();
             
-            // Find existing entry or space for a new one
-            int entryIndex = findEntry(key);
+            // Find existing entry
+            uint64_t hash = hashKey(key);
+            long entryIndex = findEntry(key, hash);
             
             // Calculate required space for the entry
             size_t entrySize = sizeof(EntryHeader) + key.size() + value.size();
             
             // If we found an existing entry
             if (entryIndex != -1) {
-                EntryHeader* entry = getEntryHeader(header->entries[entryIndex]);
+                uint32_t oldOffset = getSlots()[entryIndex].offset.load(std::memory_order_relaxed);
+                EntryHeader* entry = getEntryHeader(oldOffset);
                 
-                // If new data is same size or smaller, we can update in place
-                if (entrySize <= sizeof(EntryHeader) + entry->keySize + entry->valueSize) {
-                    // Update entry
-                    entry->timestamp = time(nullptr);
-                    entry->valueSize = value.size();
+                // If the new data has the block's size class, we can update in
+                // place; a smaller value moves too, or keys would keep the
+                // block of their largest value
+                if (sizeClassFor(entrySize) == entry->sizeClass) {
+                    // Update entry; concurrent readers see the odd version and retry
+                    beginEntryWrite(entry);
+                    entry->valueSize.store(static_cast<uint32_t>(value.size()), std::memory_order_relaxed);
+                    entry->writtenAt.store(clockSeconds(), std::memory_order_relaxed);
                     
                     // Copy the value
                     uint8_t* valuePtr = getValuePointer(entry, key.size());
                     memcpy(valuePtr, value.data(), value.size());
+                    endEntryWrite(entry);
+                    touch(entryIndex);
                     
                     unlock();
                     return true;
-                } else {
-                    // New data is larger, remove old entry
+                }
+                
+                // Otherwise move it to a block of the right size; the slot keeps
+                // pointing at the old one until the new one is complete
+                uint32_t offset = allocateEvicting(entrySize, entryIndex);
+                if (offset == NO_BLOCK) {
+                    // Don't leave the old value behind as if it were current
                     removeEntry(entryIndex);
-                    entryIndex = -1; // Mark as new entry needed
+                    unlock();
+                    return false;
                 }
+                fillBlock(offset, key, value);
+                getSlots()[entryIndex].offset.store(offset, std::memory_order_release);
+                touch(entryIndex);
+                freeBlock(oldOffset);
+                
+                unlock();
+                return true;
             }
             
-            // If we need to create a new entry
-            if (entryIndex == -1) {
-                // Check if we have enough space
-                if (header->usedBytes + entrySize > size_ - sizeof(Header)) {
-                    // Try to compact memory first
-                    compactMemory();
-                    
-                    // Check again after compaction
-                    if (header->usedBytes + entrySize > size_ - sizeof(Header)) {
-                        // Not enough space even after compaction
-                        unlock();
-                        return false;
+            // Check if the table has a free slot; tombstones are dropped first,
+            // after evicting a batch of entries if they alone won't make room
+            if (!hasFreeSlot()) {
+                if (header->evictionEnabled) {
+                    size_t batch = std::max<size_t>(1, maxEntries() / EVICTION_BATCH_DIVISOR);
+                    for (size_t evicted = header->tombstoneCount; evicted < batch && header->entryCount > 0; evicted++) {
+                        evictEntry(pickVictim(SIZE_CLASSES, -1));
                     }
                 }
-                
-                // Create new entry
-                size_t offset = header->usedBytes;
-                EntryHeader* entry = getEntryHeader(offset);
-                
-                // Initialize entry
-                entry->keySize = key.size();
-                entry->valueSize = value.size();
-                entry->timestamp = time(nullptr);
-                
-                // Copy the key and value
-                uint8_t* keyPtr = reinterpret_cast<uint8_t*>(entry + 1);
-                memcpy(keyPtr, key.data(), key.size());
-                
-                uint8_t* valuePtr = keyPtr + key.size();
-                memcpy(valuePtr, value.data(), value.size());
-                
-                // Add entry to header
-                header->entries[header->entryCount] = offset;
-                header->entryCount++;
-                header->usedBytes += entrySize;
-                
+                beginLayoutChange();
+                rebuildTable();
+                endLayoutChange();
+                if (!hasFreeSlot()) {
+                    unlock();
+                    return false;
+                }
+            }
+            
+            // Take a block of the entry's size class
+            uint32_t offset = allocateEvicting(entrySize, -1);
+            if (offset == NO_BLOCK) {
+                // Not enough space until compaction returns some
                 unlock();
-                return true;
+                return false;
             }
+            fillBlock(offset, key, value);
+            
+            // Add entry to the table
+            touch(insertSlot(hash, offset));
+            header->entryCount++;
             
             unlock();
-            return false;
+            return true;
         } catch (const std::exception& e) {
             std::cerr << "Error writing to shared memory: " << e.what() << std::endl;
             unlock();
@@ -229,7 +304,8 @@ public:
     }
     
     /**
-     * Read data from shared memory
+     * Read data from shared memory without taking the lock (see the class
+     * comment); falls back to the lock if writers keep changing the entry
      * @param key The key to read
      * @param value The retrieved data (if successful)
      * @return Whether the read was successful
@@ -238,33 +314,45 @@ public:
         if (key.empty()) {
             return false;
         }
+        uint64_t hash = hashKey(key);
+        
+        // Optimistic attempts, retried after a torn read
+        for (int attempt = 0; attempt < OPTIMISTIC_READ_ATTEMPTS; attempt++) {
+            ReadResult result = tryRead(key, hash, value);
+            if (result != READ_TORN) {
+                return result == READ_FOUND;
+            }
+            std::this_thread::yield();
+        }
         
         // Lock the shared memory
         lock();
         
         try {
-            // Get the header
-            Header* header = getHeader();
-            
             // Find entry
-            int entryIndex = findEntry(key);
+            long entryIndex = findEntry(key, hash);
             if (entryIndex == -1) {
                 unlock();
                 return false;
             }
             
             // Get entry
-            EntryHeader* entry = getEntryHeader(header->entries[entryIndex]);
+            EntryHeader* entry = getEntryHeader(getSlots()[entryIndex].offset);
+            if (expired(entry->writtenAt.load(std::memory_order_relaxed), clockSeconds())) {
+                unlock();
+                return false;
+            }
             
             // Get value
+            size_t valueSize = entry->valueSize.load(std::memory_order_relaxed);
             uint8_t* valuePtr = getValuePointer(entry, entry->keySize);
             
             // Copy value
-            value.resize(entry->valueSize);
-            memcpy(value.data(), valuePtr, entry->valueSize);
+            value.resize(valueSize);
+            memcpy(value.data(), valuePtr, valueSize);
             
             // Update timestamp
-            entry->timestamp = time(nullptr);
+            touch(entryIndex);
             
             unlock();
             return true;
@@ -290,7 +378,7 @@ public:
         
         try {
             // Find entry
-            int entryIndex = findEntry(key);
+            long entryIndex = findEntry(key, hashKey(key));
             if (entryIndex == -1) {
                 unlock();
                 return false;
@@ -308,6 +396,85 @@ public:
         }
     }
     
+    /**
+     * Make full segments evict entries instead of refusing writes, and
+     * optionally expire entries; applies to every process using the segment
+     * @param evict Whether writes evict entries when the segment is full
+     * @param ttlSeconds Lifetime of entries from their last write (0 = unlimited)
+     */
+    void setEvictionPolicy(bool evict, uint32_t ttlSeconds = 0) {
+        lock();
+        Header* header = getHeader();
+        header->evictionEnabled = evict ? 1 : 0;
+        header->ttlSeconds.store(ttlSeconds, std::memory_order_relaxed);
+        unlock();
+    }
+    
+    /**
+     * Run one bounded step of compaction: walk the blocks from where the
+     * last step stopped, drop free blocks and slide live ones down over
+     * them. A pass only starts once COMPACT_FREE_PERCENT of the allocated
+     * bytes sit on free lists, or after an allocation failed while blocks
+     * were free. Readers retry while a step moves blocks.
+     * @param maxBytes Roughly how many bytes the step may walk and move
+     * @return Whether the pass has more work
+     */
+    bool compactStep(size_t maxBytes = COMPACT_STEP_BYTES) {
+        return runCompactionStep(maxBytes, COMPACT_FREE_PERCENT);
+    }
+    
+    /**
+     * Compact the whole segment now, whatever the amount of free space
+     */
+    void compact() {
+        while (runCompactionStep(SIZE_MAX, 0)) {
+        }
+    }
+    
+    /**
+     * Compact from a background thread of this process; it checks every
+     * `interval` whether a pass is due and runs it in COMPACT_STEP_BYTES
+     * steps, releasing the lock between them so writers wait for one step
+     * at most. One process per segment is enough.
+     * @param interval Time between checks
+     */
+    void startCompactor(std::chrono::milliseconds interval = DEFAULT_COMPACT_INTERVAL) {
+        std::lock_guard<std::mutex> guard(compactorMutex_);
+        if (compactor_.joinable()) {
+            return;
+        }
+        stopCompactor_ = false;
+        compactor_ = std::thread([this, interval]() {
+            std::unique_lock<std::mutex> lock(compactorMutex_);
+            while (!stopCompactor_) {
+                lock.unlock();
+                try {
+                    while (!stopCompactor_ && compactStep()) {
+                        std::this_thread::yield();
+                    }
+                } catch (const std::exception& e) {
+                    std::cerr << "Error compacting shared memory " << name_ << ": " << e.what() << std::endl;
+                }
+                lock.lock();
+                compactorWake_.wait_for(lock, interval, [this]() { return stopCompactor_.load(); });
+            }
+        });
+    }
+    
+    /**
+     * Stop the background compactor, if running
+     */
+    void stopCompactor() {
+        {
+            std::lock_guard<std::mutex> guard(compactorMutex_);
+            stopCompactor_ = true;
+        }
+        compactorWake_.notify_all();
+        if (compactor_.joinable()) {
+            compactor_.join();
+        }
+    }
+    
     /**
      * Get the number of entries in shared memory
      * @return The number of entries
@@ -321,11 +488,44 @@ public:
     
     /**
      * Get used bytes in shared memory
-     * @return The number of used bytes
+     * @return The number of bytes in blocks holding entries
      */
     size_t usedBytes() {
         lock();
-        size_t bytes = getHeader()->usedBytes;
+        size_t bytes = getHeader()->usedBytes - getHeader()->freeBytes;
+        unlock();
+        return bytes;
+    }
+    
+    /**
+     * Get the number of entries evicted to make room for others
+     * @return The number of evicted entries, expired ones excluded
+     */
+    uint64_t evictionCount() {
+        lock();
+        uint64_t count = getHeader()->evictionCount;
+        unlock();
+        return count;
+    }
+    
+    /**
+     * Get the number of expired entries dropped by writes
+     * @return The number of entries evicted after their TTL
+     */
+    uint64_t expiredCount() {
+        lock();
+        uint64_t count = getHeader()->expiredCount;
+        unlock();
+        return count;
+    }
+    
+    /**
+     * Get the bytes waiting on free lists
+     * @return The number of bytes in free blocks
+     */
+    size_t freeBytes() {
+        lock();
+        size_t bytes = getHeader()->freeBytes;
         unlock();
         return bytes;
     }
@@ -335,9 +535,9 @@ public:
      */
     void clear() {
         lock();
-        Header* header = getHeader();
-        header->entryCount = 0;
-        header->usedBytes = 0;
+        beginLayoutChange();
+        initialize();
+        endLayoutChange();
         unlock();
     }
     
@@ -353,24 +553,86 @@ public:
         std::string semName = name + "_sem";
         sem_unlink(semName.c_str());
     }
+    
+    static const size_t COMPACT_STEP_BYTES = 64 * 1024; // Bytes walked per compaction step
+    static const size_t COMPACT_FREE_PERCENT = 25;      // Free share of the allocated bytes that starts a pass
+    static constexpr std::chrono::milliseconds DEFAULT_COMPACT_INTERVAL{100};
 
 private:
     static const uint32_t MAGIC_NUMBER = 0x53484D30; // "SHM0"
-    static const size_t MAX_ENTRIES = 1000;
+    static const uint32_t LAYOUT_VERSION = 5;        // Bump when the layout below changes
+    static const size_t BYTES_PER_SLOT = 256;        // Segment bytes per hash table slot
+    static const size_t MIN_SLOTS = 64;
+    static const size_t MAX_LOAD_PERCENT = 75;       // Entries plus tombstones
+    static const size_t MAX_SEGMENT_SIZE = UINT32_MAX; // Offsets are 32-bit
+    static const int OPTIMISTIC_READ_ATTEMPTS = 8;   // Torn reads before a reader takes the lock
+    static const uint32_t SIZE_CLASSES = 104;        // 64 bytes to 3.5 GB
+    static const uint32_t NO_BLOCK = UINT32_MAX;     // End of a free list, failed allocation
+    static constexpr size_t EVICTION_SAMPLES = 8;        // Candidates compared per eviction
+    static constexpr size_t EVICTION_SCAN_SLOTS = 256;   // Slots an eviction looks at for candidates
+    static constexpr size_t EVICTION_ATTEMPTS = 64;      // Evictions a write tries before giving up
+    static constexpr size_t EVICTION_BATCH_DIVISOR = 32; // A full table evicts this share of its entries at once
+    
+    static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+                  "Atomics shared between processes must be lock-free");
     
     // Header at start of shared memory
     struct Header {
         uint32_t magic;            // Magic number to identify initialized memory
+        uint32_t version;          // Layout version
+        size_t slotCount;          // Hash table slots (a power of two)
         size_t entryCount;         // Number of entries
-        size_t usedBytes;          // Used bytes (excluding header)
-        size_t entries[MAX_ENTRIES]; // Offsets to entries
+        size_t tombstoneCount;     // Slots of removed entries
+        size_t usedBytes;          // End of the last block; the rest of the segment is unused
+        size_t freeBytes;          // Bytes of the blocks on free lists
+        size_t compactScan;        // Next block the running compaction pass looks at
+        size_t compactTo;          // Where that pass moves the next live block
+        uint32_t compacting;       // Whether a compaction pass is running
+        uint32_t compactRequested; // An allocation failed while blocks were free
+        uint32_t evictionEnabled;  // Whether full segments evict (setEvictionPolicy())
+        std::atomic<uint32_t> ttlSeconds; // Lifetime of entries, 0 = unlimited; read by readers
+        size_t evictionRound;      // Evictions so far, hashed into where the next one samples
+        uint64_t evictionCount;    // Entries evicted to make room
+        uint64_t expiredCount;     // Expired entries evicted
+        uint32_t freeLists[SIZE_CLASSES]; // First free block of each size class
+        
+        // Seqlock of changes that move entries or rebuild the table; on its
+        // own cache line so the counters above don't invalidate it for readers
+        alignas(64) std::atomic<uint64_t> layoutSequence;
     };
     
-    // Entry header
+    enum SlotState : uint32_t {
+        SLOT_EMPTY = 0,
+        SLOT_USED = 1,
+        SLOT_REMOVED = 2
+    };
+    
+    // Hash table slot; state is stored last, so a reader that sees SLOT_USED sees the rest
+    struct Slot {
+        std::atomic<uint64_t> hash;    // Hash of the key, compared before the key itself
+        std::atomic<uint32_t> state;   // SlotState
+        std::atomic<uint32_t> offset;  // Offset of the entry's block
+    };
+    
+    // Header of every block; a free block has keySize 0 (keys are never empty)
     struct EntryHeader {
-        size_t keySize;     // Size of key
-        size_t valueSize;   // Size of value
-        time_t timestamp;   // Last access time
+        std::atomic<uint32_t> version;    // Seqlock, odd while a writer changes the entry
+        std::atomic<uint32_t> keySize;    // Size of key
+        std::atomic<uint32_t> valueSize;  // Size of value
+        uint32_t sizeClass;               // Size class of the block
+        uint32_t nextFree;                // Free list links, only used while the block is free
+        uint32_t prevFree;
+        std::atomic<uint32_t> writtenAt;  // Time of the last write (seconds), for the TTL
+        uint32_t reserved;
+    };
+    
+    static_assert(sizeof(Slot) == 16, "Shared memory slot layout changed");
+    static_assert(sizeof(EntryHeader) == 32, "Shared memory entry layout changed");
+    
+    enum ReadResult {
+        READ_FOUND,
+        READ_MISSING,
+        READ_TORN       // A writer changed what was read
     };
     
     // Lock shared memory
@@ -387,15 +649,162 @@ private:
         }
     }
     
+    // Make an entry's version odd before changing it
+    static void beginEntryWrite(EntryHeader* entry) {
+        entry->version.store(entry->version.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+    
+    // Make it even again, publishing the change
+    static void endEntryWrite(EntryHeader* entry) {
+        entry->version.store(entry->version.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+    
+    // Same for changes that move entries or rebuild the table
+    void beginLayoutChange() {
+        std::atomic<uint64_t>& sequence = getHeader()->layoutSequence;
+        sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+    
+    void endLayoutChange() {
+        std::atomic<uint64_t>& sequence = getHeader()->layoutSequence;
+        sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+    
+    // Current time in seconds, as kept in access and write times
+    static uint32_t clockSeconds() {
+        return static_cast<uint32_t>(time(nullptr));
+    }
+    
+    // Whether an entry written at `writtenAt` is past the segment's TTL
+    bool expired(uint32_t writtenAt, uint32_t now) {
+        uint32_t ttl = getHeader()->ttlSeconds.load(std::memory_order_relaxed);
+        return ttl != 0 && now - writtenAt >= ttl;
+    }
+    
+    // Record an access of a slot's entry; only written when the second changes
+    void touch(size_t slotIndex) {
+        std::atomic<uint32_t>& accessTime = getAccessTimes()[slotIndex];
+        uint32_t now = clockSeconds();
+        if (accessTime.load(std::memory_order_relaxed) != now) {
+            accessTime.store(now, std::memory_order_relaxed);
+        }
+    }
+    
+    /**
+     * One lock-free lookup. Every offset and size is bounds-checked before
+     * use, since a concurrent writer may leave them half-updated; the
+     * version checks at the end decide whether the copy is valid.
+     */
+    ReadResult tryRead(const std::string& key, uint64_t hash, std::vector<uint8_t>& value) {
+        Header* header = getHeader();
+        uint64_t layout = header->layoutSequence.load(std::memory_order_acquire);
+        if (layout & 1) {
+            return READ_TORN;
+        }
+        
+        Slot* slots = getSlots();
+        size_t mask = header->slotCount - 1;
+        uint64_t capacity = dataCapacity();
+        for (size_t i = hash & mask, probes = 0; probes <= mask; i = (i + 1) & mask, probes++) {
+            uint32_t state = slots[i].state.load(std::memory_order_acquire);
+            if (state == SLOT_EMPTY) {
+                break;
+            }
+            if (state != SLOT_USED || slots[i].hash.load(std::memory_order_relaxed) != hash) {
+                continue;
+            }
+            
+            uint64_t offset = slots[i].offset.load(std::memory_order_acquire);
+            if (offset + sizeof(EntryHeader) > capacity) {
+                return READ_TORN;
+            }
+            EntryHeader* entry = getEntryHeader(offset);
+            uint32_t version = entry->version.load(std::memory_order_acquire);
+            if (version & 1) {
+                return READ_TORN;
+            }
+            uint64_t keySize = entry->keySize.load(std::memory_order_relaxed);
+            uint64_t valueSize = entry->valueSize.load(std::memory_order_relaxed);
+            if (offset + sizeof(EntryHeader) + keySize + valueSize > capacity) {
+                return READ_TORN;
+            }
+            
+            bool match = keySize == key.size() && memcmp(getKeyPointer(entry), key.data(), key.size()) == 0;
+            uint32_t writtenAt = entry->writtenAt.load(std::memory_order_relaxed);
+            if (match) {
+                value.resize(valueSize);
+                memcpy(value.data(), getValuePointer(entry, keySize), valueSize);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (entry->version.load(std::memory_order_relaxed) != version ||
+                header->layoutSequence.load(std::memory_order_relaxed) != layout) {
+                return READ_TORN;
+            }
+            if (match) {
+                if (expired(writtenAt, clockSeconds())) {
+                    return READ_MISSING;
+                }
+                touch(i);
+                return READ_FOUND;
+            }
+        }
+        
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return header->layoutSequence.load(std::memory_order_relaxed) == layout ? READ_MISSING : READ_TORN;
+    }
+    
+    // Spread the bits of a 64-bit value
+    static uint64_t mix64(uint64_t h) {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        return h;
+    }
+    
+    // 64-bit FNV-1a with a final mix; the same in every process
+    static uint64_t hashKey(const uint8_t* key, size_t size) {
+        uint64_t h = 0xcbf29ce484222325ULL;
+        for (size_t i = 0; i < size; i++) {
+            h = (h ^ key[i]) * 0x100000001b3ULL;
+        }
+        return mix64(h);
+    }
+    
+    static uint64_t hashKey(const std::string& key) {
+        return hashKey(reinterpret_cast<const uint8_t*>(key.data()), key.size());
+    }
+    
     // Get header pointer
     Header* getHeader() {
         return reinterpret_cast<Header*>(data_);
     }
     
+    // Get the hash table
+    Slot* getSlots() {
+        return reinterpret_cast<Slot*>(reinterpret_cast<uint8_t*>(data_) + sizeof(Header));
+    }
+    
+    // Get the access times, one per slot
+    std::atomic<uint32_t>* getAccessTimes() {
+        return reinterpret_cast<std::atomic<uint32_t>*>(getSlots() + getHeader()->slotCount);
+    }
+    
+    // Offset of the blocks from the start of the segment
+    size_t dataStart() {
+        return sizeof(Header) + getHeader()->slotCount * (sizeof(Slot) + sizeof(uint32_t));
+    }
+    
+    // Bytes available for blocks
+    size_t dataCapacity() {
+        return size_ - dataStart();
+    }
+    
     // Get entry header at offset
     EntryHeader* getEntryHeader(size_t offset) {
         return reinterpret_cast<EntryHeader*>(
-            reinterpret_cast<uint8_t*>(data_) + sizeof(Header) + offset);
+            reinterpret_cast<uint8_t*>(data_) + dataStart() + offset);
     }
     
     // Get pointer to key for an entry
@@ -408,95 +817,455 @@ private:
         return getKeyPointer(entry) + keySize;
     }
     
-    // Find entry by key, returns index or -1 if not found
-    int findEntry(const std::string& key) {
+    // Block size of a class: 64, 80, 96, 112, 128, 160, ... (four steps per power of two)
+    static size_t classSize(uint32_t sizeClass) {
+        return static_cast<size_t>(4 + sizeClass % 4) << (sizeClass / 4 + 4);
+    }
+    
+    // Smallest class holding `bytes`, or SIZE_CLASSES if none does
+    static uint32_t sizeClassFor(size_t bytes) {
+        uint32_t sizeClass = 0;
+        while (sizeClass + 4 < SIZE_CLASSES && classSize(sizeClass + 4) < bytes) {
+            sizeClass += 4;
+        }
+        while (sizeClass < SIZE_CLASSES && classSize(sizeClass) < bytes) {
+            sizeClass++;
+        }
+        return sizeClass;
+    }
+    
+    size_t blockSize(EntryHeader* entry) {
+        return classSize(entry->sizeClass);
+    }
+    
+    // Number of slots for a segment of the given size
+    static size_t slotCountFor(size_t size) {
+        size_t slots = MIN_SLOTS;
+        while (slots * 2 <= size / BYTES_PER_SLOT) {
+            slots *= 2;
+        }
+        return slots;
+    }
+    
+    // Check that the segment holds this layout and fits the mapping
+    bool validLayout() {
+        if (size_ < sizeof(Header)) {
+            return false;
+        }
+        Header* header = getHeader();
+        return header->magic == MAGIC_NUMBER && header->version == LAYOUT_VERSION &&
+               header->slotCount >= MIN_SLOTS && (header->slotCount & (header->slotCount - 1)) == 0 &&
+               dataStart() <= size_ && header->usedBytes <= dataCapacity() &&
+               header->freeBytes <= header->usedBytes;
+    }
+    
+    // Write an empty header and table
+    void initialize() {
+        size_t slots = slotCountFor(size_);
+        Header* header = getHeader();
+        header->magic = MAGIC_NUMBER;
+        header->version = LAYOUT_VERSION;
+        header->slotCount = slots;
+        header->entryCount = 0;
+        header->tombstoneCount = 0;
+        header->usedBytes = 0;
+        header->freeBytes = 0;
+        header->compactScan = 0;
+        header->compactTo = 0;
+        header->compacting = 0;
+        header->compactRequested = 0;
+        header->evictionRound = 0;
+        header->evictionCount = 0;
+        header->expiredCount = 0;
+        for (uint32_t& head : header->freeLists) {
+            head = NO_BLOCK;
+        }
+        // SLOT_EMPTY, and no access times
+        memset(static_cast<void*>(getSlots()), 0, slots * (sizeof(Slot) + sizeof(uint32_t)));
+    }
+    
+    // Entries plus tombstones the table holds
+    size_t maxEntries() {
+        return getHeader()->slotCount * MAX_LOAD_PERCENT / 100;
+    }
+    
+    // Whether a new entry may take a slot without overloading the table
+    bool hasFreeSlot() {
         Header* header = getHeader();
+        return header->entryCount + header->tombstoneCount + 1 <= maxEntries();
+    }
+    
+    // Find entry by key, returns its slot index or -1 if not found
+    long findEntry(const std::string& key, uint64_t hash) {
+        Header* header = getHeader();
+        Slot* slots = getSlots();
+        size_t mask = header->slotCount - 1;
         
-        for (size_t i = 0; i < header->entryCount; i++) {
-            EntryHeader* entry = getEntryHeader(header->entries[i]);
+        for (size_t i = hash & mask, probes = 0; probes < header->slotCount; i = (i + 1) & mask, probes++) {
+            const Slot& slot = slots[i];
+            if (slot.state == SLOT_EMPTY) {
+                break;
+            }
             
-            // Check key size first
-            if (entry->keySize != key.size()) {
+            // Check the hash first, then the key size and content
+            if (slot.state != SLOT_USED || slot.hash != hash) {
                 continue;
             }
-            
-            // Check key content
-            uint8_t* keyPtr = getKeyPointer(entry);
-            if (memcmp(keyPtr, key.data(), key.size()) == 0) {
-                return static_cast<int>(i);
+            EntryHeader* entry = getEntryHeader(slot.offset);
+            if (entry->keySize == key.size() && memcmp(getKeyPointer(entry), key.data(), key.size()) == 0) {
+                return static_cast<long>(i);
             }
         }
         
         return -1; // Not found
     }
     
-    // Remove entry at index
-    void removeEntry(int entryIndex) {
+    // Put an entry in the first empty slot of its probe chain (the key must be new)
+    size_t insertSlot(uint64_t hash, size_t offset) {
         Header* header = getHeader();
+        Slot* slots = getSlots();
+        size_t mask = header->slotCount - 1;
         
-        // Shift entries down
-        for (size_t i = entryIndex; i < header->entryCount - 1; i++) {
-            header->entries[i] = header->entries[i + 1];
+        size_t i = hash & mask;
+        while (slots[i].state == SLOT_USED) {
+            i = (i + 1) & mask;
         }
-        
+        if (slots[i].state == SLOT_REMOVED) {
+            header->tombstoneCount--;
+        }
+        slots[i].hash.store(hash, std::memory_order_relaxed);
+        slots[i].offset.store(static_cast<uint32_t>(offset), std::memory_order_relaxed);
+        slots[i].state.store(SLOT_USED, std::memory_order_release);
+        return i;
+    }
+    
+    // Remove entry at slot index and free its block
+    void removeEntry(long entryIndex) {
+        Header* header = getHeader();
+        Slot& slot = getSlots()[entryIndex];
+        slot.state.store(SLOT_REMOVED, std::memory_order_release);
         header->entryCount--;
+        header->tombstoneCount++;
+        freeBlock(slot.offset.load(std::memory_order_relaxed));
     }
     
-    // Compact memory to reclaim space from deleted entries
-    void compactMemory() {
+    // Re-insert every entry into an empty table, dropping tombstones
+    void rebuildTable() {
         Header* header = getHeader();
+        Slot* slots = getSlots();
+        std::atomic<uint32_t>* accessTimes = getAccessTimes();
         
-        // If no entries, just reset
-        if (header->entryCount == 0) {
-            header->usedBytes = 0;
-            return;
+        struct Live {
+            uint64_t hash;
+            uint32_t offset;
+            uint32_t accessTime;
+        };
+        std::vector<Live> live;
+        live.reserve(header->entryCount);
+        for (size_t i = 0; i < header->slotCount; i++) {
+            if (slots[i].state == SLOT_USED) {
+                live.push_back(Live{slots[i].hash, slots[i].offset, accessTimes[i]});
+            }
+        }
+        
+        memset(static_cast<void*>(slots), 0, header->slotCount * (sizeof(Slot) + sizeof(uint32_t)));
+        header->tombstoneCount = 0;
+        for (const Live& entry : live) {
+            accessTimes[insertSlot(entry.hash, entry.offset)].store(entry.accessTime, std::memory_order_relaxed);
+        }
+    }
+    
+    // Write a new entry into an allocated block
+    void fillBlock(uint32_t offset, const std::string& key, const std::vector<uint8_t>& value) {
+        EntryHeader* entry = getEntryHeader(offset);
+        beginEntryWrite(entry);
+        entry->keySize.store(static_cast<uint32_t>(key.size()), std::memory_order_relaxed);
+        entry->valueSize.store(static_cast<uint32_t>(value.size()), std::memory_order_relaxed);
+        entry->writtenAt.store(clockSeconds(), std::memory_order_relaxed);
+        
+        // Copy the key and value
+        uint8_t* keyPtr = getKeyPointer(entry);
+        memcpy(keyPtr, key.data(), key.size());
+        memcpy(keyPtr + key.size(), value.data(), value.size());
+        endEntryWrite(entry);
+    }
+    
+    /**
+     * Take a block for `bytes` from its class's free list, or else from the
+     * unused end of the segment
+     * @return The block's offset, or NO_BLOCK if neither has room
+     */
+    uint32_t allocateBlock(size_t bytes) {
+        Header* header = getHeader();
+        uint32_t sizeClass = sizeClassFor(bytes);
+        if (sizeClass >= SIZE_CLASSES) {
+            return NO_BLOCK;
         }
         
-        // Create temporary buffer for valid entries
-        std::vector<uint8_t> tempBuffer(size_ - sizeof(Header));
-        std::vector<size_t> newOffsets(header->entryCount);
+        uint32_t offset = header->freeLists[sizeClass];
+        if (offset != NO_BLOCK) {
+            unlinkFreeBlock(offset);
+            return offset;
+        }
         
-        size_t newUsedBytes = 0;
-        size_t newEntryCount = 0;
+        size_t size = classSize(sizeClass);
+        if (header->usedBytes + size > dataCapacity()) {
+            if (header->freeBytes > 0) {
+                header->compactRequested = 1;
+            }
+            return NO_BLOCK;
+        }
+        offset = static_cast<uint32_t>(header->usedBytes);
+        header->usedBytes += size;
         
-        // Copy valid entries to temporary buffer
-        for (size_t i = 0; i < header->entryCount; i++) {
-            EntryHeader* entry = getEntryHeader(header->entries[i]);
-            size_t entrySize = sizeof(EntryHeader) + entry->keySize + entry->valueSize;
-            
-            // Copy entry to temporary buffer
-            memcpy(tempBuffer.data() + newUsedBytes, entry, entrySize);
-            
-            // Store new offset
-            newOffsets[newEntryCount] = newUsedBytes;
-            newEntryCount++;
+        // Leftover bytes may hold anything; readers that got here through a
+        // stale offset see the layout change that put them there. Versions
+        // only move forward and must start even.
+        EntryHeader* entry = getEntryHeader(offset);
+        uint32_t version = entry->version.load(std::memory_order_relaxed);
+        entry->version.store((version + 1) & ~1u, std::memory_order_relaxed);
+        entry->keySize.store(0, std::memory_order_relaxed);
+        entry->sizeClass = sizeClass;
+        return offset;
+    }
+    
+    // allocateBlock(), evicting entries while the segment is full (if enabled)
+    uint32_t allocateEvicting(size_t bytes, long keep) {
+        Header* header = getHeader();
+        uint32_t offset = allocateBlock(bytes);
+        uint32_t sizeClass = sizeClassFor(bytes);
+        if (sizeClass >= SIZE_CLASSES || classSize(sizeClass) > dataCapacity()) {
+            return offset;
+        }
+        for (size_t attempt = 0; offset == NO_BLOCK && header->evictionEnabled && attempt < EVICTION_ATTEMPTS; attempt++) {
+            long victim = pickVictim(sizeClass, keep);
+            if (victim == -1) {
+                break;
+            }
+            evictEntry(victim);
+            offset = allocateBlock(bytes);
+        }
+        return offset;
+    }
+    
+    /**
+     * Choose an entry to evict, sampling from a pseudo-random slot: the first
+     * expired entry, or else the least recently read of up to
+     * EVICTION_SAMPLES entries. Entries of `sizeClass` win, since only
+     * their blocks can be reused right away (SIZE_CLASSES = any).
+     * @param keep Slot that must not be chosen, or -1
+     * @return The victim's slot index, or -1 if there is none
+     */
+    long pickVictim(uint32_t sizeClass, long keep) {
+        Header* header = getHeader();
+        Slot* slots = getSlots();
+        std::atomic<uint32_t>* accessTimes = getAccessTimes();
+        size_t mask = header->slotCount - 1;
+        uint32_t now = clockSeconds();
+        
+        long best = -1;            // Oldest access of any class
+        long bestFit = -1;         // Oldest access of the wanted class
+        size_t sampled = 0;
+        size_t fitting = 0;
+        size_t i = mix64(++header->evictionRound) & mask;
+        size_t scanLimit = std::min(header->slotCount, EVICTION_SCAN_SLOTS);
+        for (size_t scanned = 0; scanned < header->slotCount; scanned++, i = (i + 1) & mask) {
+            if (fitting >= EVICTION_SAMPLES || (scanned >= scanLimit && best != -1)) {
+                break;
+            }
+            if (slots[i].state != SLOT_USED || static_cast<long>(i) == keep) {
+                continue;
+            }
+            EntryHeader* entry = getEntryHeader(slots[i].offset);
+            if (expired(entry->writtenAt.load(std::memory_order_relaxed), now)) {
+                best = bestFit = static_cast<long>(i);
+                break;
+            }
             
-            // Update used bytes
-            newUsedBytes += entrySize;
+            uint32_t accessTime = accessTimes[i].load(std::memory_order_relaxed);
+            if (sampled < EVICTION_SAMPLES &&
+                (best == -1 || accessTime < accessTimes[best].load(std::memory_order_relaxed))) {
+                best = static_cast<long>(i);
+            }
+            sampled++;
+            if (sizeClass < SIZE_CLASSES && entry->sizeClass == sizeClass) {
+                if (bestFit == -1 || accessTime < accessTimes[bestFit].load(std::memory_order_relaxed)) {
+                    bestFit = static_cast<long>(i);
+                }
+                fitting++;
+            }
+            if (sizeClass >= SIZE_CLASSES && sampled >= EVICTION_SAMPLES) {
+                break;
+            }
+        }
+        return bestFit != -1 ? bestFit : best;
+    }
+    
+    // Remove an entry chosen by pickVictim() and count it
+    void evictEntry(long slotIndex) {
+        if (slotIndex == -1) {
+            return;
+        }
+        Header* header = getHeader();
+        EntryHeader* entry = getEntryHeader(getSlots()[slotIndex].offset);
+        if (expired(entry->writtenAt.load(std::memory_order_relaxed), clockSeconds())) {
+            header->expiredCount++;
+        } else {
+            header->evictionCount++;
         }
+        removeEntry(slotIndex);
+    }
+    
+    // Return a block to its free list, or to the unused end if it is the last one
+    void freeBlock(uint32_t offset) {
+        Header* header = getHeader();
+        EntryHeader* entry = getEntryHeader(offset);
         
-        // Copy temporary buffer back to shared memory
-        memcpy(
-            reinterpret_cast<uint8_t*>(data_) + sizeof(Header),
-            tempBuffer.data(), 
-            newUsedBytes
-        );
+        // Readers still holding the offset see the version move and retry
+        beginEntryWrite(entry);
+        entry->keySize.store(0, std::memory_order_relaxed);
+        entry->valueSize.store(0, std::memory_order_relaxed);
+        endEntryWrite(entry);
         
-        // Update header
-        header->usedBytes = newUsedBytes;
-        header->entryCount = newEntryCount;
+        size_t size = blockSize(entry);
+        if (!header->compacting && offset + size == header->usedBytes) {
+            header->usedBytes = offset;
+            return;
+        }
         
-        // Update entry offsets
-        for (size_t i = 0; i < newEntryCount; i++) {
-            header->entries[i] = newOffsets[i];
+        uint32_t& head = header->freeLists[entry->sizeClass];
+        entry->prevFree = NO_BLOCK;
+        entry->nextFree = head;
+        if (head != NO_BLOCK) {
+            getEntryHeader(head)->prevFree = offset;
         }
+        head = offset;
+        header->freeBytes += size;
     }
-
+    
+    // Take a free block off its list
+    void unlinkFreeBlock(uint32_t offset) {
+        Header* header = getHeader();
+        EntryHeader* entry = getEntryHeader(offset);
+        if (entry->prevFree != NO_BLOCK) {
+            getEntryHeader(entry->prevFree)->nextFree = entry->nextFree;
+        } else {
+            header->freeLists[entry->sizeClass] = entry->nextFree;
+        }
+        if (entry->nextFree != NO_BLOCK) {
+            getEntryHeader(entry->nextFree)->prevFree = entry->prevFree;
+        }
+        header->freeBytes -= blockSize(entry);
+    }
+    
+    // Find the slot pointing at a live block, or -1
+    long findSlotOf(uint32_t offset) {
+        EntryHeader* entry = getEntryHeader(offset);
+        uint64_t hash = hashKey(getKeyPointer(entry), entry->keySize);
+        Header* header = getHeader();
+        Slot* slots = getSlots();
+        size_t mask = header->slotCount - 1;
+        
+        for (size_t i = hash & mask, probes = 0; probes < header->slotCount; i = (i + 1) & mask, probes++) {
+            if (slots[i].state == SLOT_EMPTY) {
+                break;
+            }
+            if (slots[i].state == SLOT_USED && slots[i].offset == offset) {
+                return static_cast<long>(i);
+            }
+        }
+        return -1;
+    }
+    
+    // compactStep() with an explicit threshold; see there
+    bool runCompactionStep(size_t maxBytes, size_t minFreePercent) {
+        lock();
+        
+        try {
+            Header* header = getHeader();
+            if (!header->compacting) {
+                bool due = header->freeBytes * 100 >= header->usedBytes * minFreePercent ||
+                           header->compactRequested;
+                if (header->freeBytes == 0 || !due) {
+                    header->compactRequested = 0;
+                    unlock();
+                    return false;
+                }
+                header->compacting = 1;
+                header->compactRequested = 0;
+                header->compactScan = 0;
+                header->compactTo = 0;
+            }
+            
+            bool moved = false;
+            size_t budget = maxBytes;
+            while (budget > 0 && header->compactScan < header->usedBytes) {
+                uint32_t offset = static_cast<uint32_t>(header->compactScan);
+                EntryHeader* entry = getEntryHeader(offset);
+                if (entry->sizeClass >= SIZE_CLASSES || offset + blockSize(entry) > header->usedBytes) {
+                    // Only a bug or a crashed writer gets here; the segment is a cache, so start over
+                    std::cerr << "Shared memory " << name_ << " has a corrupt block at " << offset
+                              << ", clearing it" << std::endl;
+                    if (!moved) {
+                        beginLayoutChange();
+                    }
+                    initialize();
+                    endLayoutChange();
+                    unlock();
+                    return false;
+                }
+                
+                size_t size = blockSize(entry);
+                long slotIndex = entry->keySize != 0 ? findSlotOf(offset) : -1;
+                if (entry->keySize == 0) {
+                    unlinkFreeBlock(offset);
+                } else if (slotIndex == -1) {
+                    // No slot points here; the block is lost anyway
+                    std::cerr << "Shared memory " << name_ << " has an unreferenced block at " << offset << std::endl;
+                } else {
+                    if (header->compactTo != offset) {
+                        if (!moved) {
+                            beginLayoutChange();
+                            moved = true;
+                        }
+                        memmove(static_cast<void*>(getEntryHeader(header->compactTo)), static_cast<const void*>(entry), size);
+                        getSlots()[slotIndex].offset.store(static_cast<uint32_t>(header->compactTo), std::memory_order_relaxed);
+                        budget -= std::min(budget, size);
+                    }
+                    header->compactTo += size;
+                }
+                budget -= std::min(budget, sizeof(EntryHeader));
+                header->compactScan += size;
+            }
+            
+            bool more = header->compactScan < header->usedBytes;
+            if (!more) {
+                header->usedBytes = header->compactTo;
+                header->compacting = 0;
+            }
+            if (moved) {
+                endLayoutChange();
+            }
+            unlock();
+            return more;
+        } catch (const std::exception& e) {
+            std::cerr << "Error compacting shared memory: " << e.what() << std::endl;
+            unlock();
+            return false;
+        }
+    }
+    
     std::string name_;  // Name of shared memory segment
     size_t size_;       // Size of shared memory
     int fd_;            // File descriptor
     void* data_;        // Mapped memory
     sem_t* sem_;        // Semaphore for synchronization
+    
+    // Background compactor (startCompactor())
+    std::thread compactor_;
+    std::mutex compactorMutex_;
+    std::condition_variable compactorWake_;
+    std::atomic<bool> stopCompactor_{false};
 };
 
-#endif // POSIX_SHARED_MEMORY_H
\ No newline at end of file
+#endif // POSIX_SHARED_MEMORY_H
@@ -0,0 +1,109 @@
+#ifndef QUERY_KEY_H
+#define QUERY_KEY_H
+
+#include <string>
+#include <string_view>
+#include <cctype>
+#include "movie.grpc.pb.h"
+#include "substring_search.h"
+#include "cached_response.h"
+
+/**
+ * Canonical query keys and reuse of cached results between queries.
+ *
+ * Matching is a case-insensitive substring test, so queries that only
+ * differ in case or in surrounding / repeated whitespace are the same
+ * query. Every node matches the canonical form, and A caches under it.
+ */
+class QueryKey {
+public:
+    static constexpr size_t MAX_DERIVATION_LENGTH = 128;       // Longer queries aren't derived
+    static constexpr size_t MAX_DERIVATION_BYTES = 256 * 1024;  // Bigger bases cost more to check than a search
+
+    /**
+     * Canonical form of a query: lowercased, whitespace runs collapsed to
+     * one space, leading and trailing whitespace removed
+     * @param query The query as sent by the client
+     * @return The query every node matches and A caches under
+     */
+    static std::string canonical(std::string_view query) {
+        std::string key;
+        key.reserve(query.size());
+        bool space = false;
+        for (unsigned char ch : query) {
+            if (std::isspace(ch)) {
+                space = !key.empty();
+                continue;
+            }
+            if (space) {
+                key.push_back(' ');
+                space = false;
+            }
+            key.push_back(static_cast<char>(std::tolower(ch)));
+        }
+        return key;
+    }
+
+    /**
+     * Check whether the result of a shorter query contained in `key` is
+     * also the exact result of `key`.
+     *
+     * Every movie matching `key` matches the contained query, so it is in
+     * `base`. If each movie in `base` has `key` in its title or genre,
+     * they all match `key` and `base` is its result. Otherwise the movie
+     * may still match through its overview or keywords, which aren't part
+     * of MovieInfo, so it can't be decided here.
+     * @param base Cached result of a query contained in `key`
+     * @param key Canonical query
+     */
+    static bool answers(const CachedResponse& base, std::string_view key) {
+        if (base.size() > MAX_DERIVATION_BYTES) {
+            return false;
+        }
+        movie::SearchResponse response;
+        if (!base.parseTo(response)) {
+            return false;
+        }
+        for (const auto& movie : response.results()) {
+            if (!CaseInsensitiveSearch::contains(movie.title(), key) &&
+                !CaseInsensitiveSearch::contains(movie.genre(), key)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Find a cached result of a shorter query that answers `key` (see
+     * answers()). The proper prefixes and suffixes of `key` are tried,
+     * longest first. Each of the two lists is a chain of nested queries
+     * whose results only grow, so the first cached one decides its chain.
+     * @param key Canonical query
+     * @param lookup Returns the cached response of a canonical query, or null
+     * @return The reusable response, or null
+     */
+    template <typename Lookup>
+    static CachedResponsePtr derive(const std::string& key, Lookup lookup) {
+        if (key.size() < 2 || key.size() > MAX_DERIVATION_LENGTH) {
+            return nullptr;
+        }
+        for (bool prefixes : {true, false}) {
+            for (size_t length = key.size() - 1; length > 0; length--) {
+                std::string base = prefixes ? key.substr(0, length) : key.substr(key.size() - length);
+                if (base.front() == ' ' || base.back() == ' ') {
+                    continue;  // Not canonical, so never cached
+                }
+                CachedResponsePtr cached = lookup(base);
+                if (cached) {
+                    if (answers(*cached, key)) {
+                        return cached;
+                    }
+                    break;
+                }
+            }
+        }
+        return nullptr;
+    }
+};
+
+#endif // QUERY_KEY_H
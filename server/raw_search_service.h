@@ -0,0 +1,60 @@
+#ifndef RAW_SEARCH_SERVICE_H
+#define RAW_SEARCH_SERVICE_H
+
+#include <grpcpp/grpcpp.h>
+#include <grpcpp/impl/rpc_method.h>
+#include <grpcpp/impl/rpc_service_method.h>
+#include <grpcpp/support/method_handler.h>
+#include <grpcpp/support/byte_buffer.h>
+#include "movie.grpc.pb.h"
+#include "cached_response.h"
+
+/**
+ * Synchronous MovieSearch service whose Search handler replies with a
+ * serialized SearchResponse instead of a message object.
+ *
+ * It registers the same method name and wire format as the generated
+ * MovieSearch::Service, so clients and upstream servers are unaffected.
+ * It uses the same sync unary handler the generated code uses, with
+ * grpc::ByteBuffer as the response type, so a handler can send cached
+ * bytes as they are.
+ */
+class RawSearchService : public grpc::Service {
+public:
+    RawSearchService() {
+        AddMethod(new grpc::internal::RpcServiceMethod(
+            "/movie.MovieSearch/Search",
+            grpc::internal::RpcMethod::NORMAL_RPC,
+            new grpc::internal::RpcMethodHandler<RawSearchService, movie::SearchRequest, grpc::ByteBuffer>(
+                [](RawSearchService* service, grpc::ServerContext* context,
+                   const movie::SearchRequest* request, grpc::ByteBuffer* reply) {
+                    return service->Search(context, request, reply);
+                },
+                this)));
+    }
+
+    /**
+     * Handle a search
+     * @param context The call context
+     * @param request The search request
+     * @param reply Receives the serialized SearchResponse
+     */
+    virtual grpc::Status Search(grpc::ServerContext* context, const movie::SearchRequest* request,
+                                grpc::ByteBuffer* reply) = 0;
+
+    /**
+     * Serialize a response that isn't cached into a reply
+     */
+    static grpc::ByteBuffer serialize(const movie::SearchResponse& response) {
+        return CachedResponse(response).buffer();
+    }
+
+    /**
+     * Reply with an already serialized response (no copy of the bytes)
+     */
+    static grpc::ByteBuffer serialize(std::string&& bytes) {
+        return CachedResponse(std::move(bytes)).buffer();
+    }
+};
+
+#endif // RAW_SEARCH_SERVICE_H
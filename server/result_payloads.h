@@ -0,0 +1,101 @@
+#ifndef RESULT_PAYLOADS_H
+#define RESULT_PAYLOADS_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include "movie.grpc.pb.h"
+#include "movie_store.h"
+
+/**
+ * The search result of every movie on a node, serialized once at load time.
+ *
+ * Each movie is stored as its complete `results` entry of a SearchResponse
+ * (field tag, length and MovieInfo bytes), with the year already parsed
+ * from the release date. Entries of a repeated field concatenate into a
+ * valid message, so a reply is built by copying the byte ranges of the
+ * matching movies one after another: no MovieInfo is built, and no string
+ * is allocated per match.
+ */
+class ResultPayloads {
+public:
+    /**
+     * Build the payloads for all movies of a store (replaces any previous ones)
+     * @param movies The node's movies
+     */
+    void build(const MovieStore& movies) {
+        bytes_.clear();
+        offsets_.assign(1, 0);
+        offsets_.reserve(movies.size() + 1);
+        movie::SearchResponse entry;
+        for (size_t row = 0; row < movies.size(); row++) {
+            MovieStore::ResultFields fields = movies.resultFields(row);
+            movie::MovieInfo* result = entry.add_results();
+            result->set_title(std::string(fields.title));
+            result->set_director(std::string(fields.production_companies)); // Using production companies as "director"
+            result->set_genre(std::string(fields.genres));
+
+            // Parse year from release date (format: MM/DD/YY)
+            if (!fields.release_date.empty()) {
+                try {
+                    result->set_year(2000 + std::stoi(std::string(fields.release_date.substr(fields.release_date.length() - 2))));
+                } catch (...) {
+                    result->set_year(0); // Default if parsing fails
+                }
+            }
+
+            entry.AppendToString(&bytes_);
+            entry.clear_results();
+            offsets_.push_back(bytes_.size());
+        }
+        bytes_.shrink_to_fit();
+    }
+
+    /**
+     * Append the serialized results of matching movies to a serialized SearchResponse
+     * @param rows Indices of the matching movies
+     * @param out Bytes to append to
+     */
+    void appendTo(const std::vector<uint32_t>& rows, std::string* out) const {
+        size_t total = out->size();
+        for (uint32_t row : rows) {
+            total += offsets_[row + 1] - offsets_[row];
+        }
+        out->reserve(total);
+        for (uint32_t row : rows) {
+            out->append(bytes_, offsets_[row], offsets_[row + 1] - offsets_[row]);
+        }
+    }
+
+    /**
+     * Append the results of matching movies to a response (parses them; for
+     * nodes that have to look at the messages)
+     * @param rows Indices of the matching movies
+     * @param response The response to append to
+     * @return Whether the results could be parsed
+     */
+    bool append(const std::vector<uint32_t>& rows, movie::SearchResponse* response) const {
+        std::string bytes;
+        appendTo(rows, &bytes);
+        return response->MergeFromString(bytes);
+    }
+
+    /**
+     * Get a movie's serialized `results` entry
+     * @param row Index of the movie
+     */
+    std::string_view operator[](size_t row) const {
+        return std::string_view(bytes_).substr(offsets_[row], offsets_[row + 1] - offsets_[row]);
+    }
+
+    size_t size() const {
+        return offsets_.empty() ? 0 : offsets_.size() - 1;
+    }
+
+private:
+    std::string bytes_;             // Every movie's entry, in row order
+    std::vector<size_t> offsets_;   // Entry of row i is bytes_[offsets_[i], offsets_[i + 1])
+};
+
+#endif // RESULT_PAYLOADS_H
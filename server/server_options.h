@@ -0,0 +1,62 @@
+#ifndef SERVER_OPTIONS_H
+#define SERVER_OPTIONS_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <stdexcept>
+
+/**
+ * Command line helper for the servers. Arguments of the form
+ * --name=value are options; everything else keeps its meaning as a
+ * positional argument, so existing invocations continue to work.
+ */
+class ServerOptions {
+public:
+    ServerOptions(int argc, char** argv) {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg.rfind("--", 0) == 0) {
+                size_t eq = arg.find('=');
+                if (eq == std::string::npos) {
+                    options_[arg.substr(2)] = "true";
+                } else {
+                    options_[arg.substr(2, eq - 2)] = arg.substr(eq + 1);
+                }
+            } else {
+                positional_.push_back(arg);
+            }
+        }
+    }
+
+    const std::vector<std::string>& positional() const {
+        return positional_;
+    }
+
+    bool has(const std::string& name) const {
+        return options_.count(name) > 0;
+    }
+
+    std::string getString(const std::string& name, const std::string& default_value) const {
+        auto it = options_.find(name);
+        return it == options_.end() ? default_value : it->second;
+    }
+
+    long long getInt(const std::string& name, long long default_value) const {
+        auto it = options_.find(name);
+        if (it == options_.end()) {
+            return default_value;
+        }
+        try {
+            return std::stoll(it->second);
+        } catch (const std::exception&) {
+            throw std::invalid_argument("Invalid value for --" + name + ": " + it->second);
+        }
+    }
+
+private:
+    std::vector<std::string> positional_;
+    std::unordered_map<std::string, std::string> options_;
+};
+
+#endif // SERVER_OPTIONS_H
@@ -0,0 +1,236 @@
+#ifndef SHARDED_CACHE_H
+#define SHARDED_CACHE_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include "cache.h"
+
+/**
+ * Lock-striped query cache for multi-threaded gRPC handlers.
+ *
+ * Keys are spread over independent Cache shards by hash. Each shard has
+ * its own mutex, LRU list and hit/miss counters, so handlers only contend
+ * when they hit the same shard. Shards are cache-line aligned, so two
+ * shards never share a line through their locks or counters. LRU and the
+ * size bound are per shard: max_size (and max_bytes, if set) is split
+ * evenly, and eviction and admission only consider the key's shard.
+ */
+class ShardedCache {
+public:
+    static constexpr size_t MIN_SHARD_ENTRIES = 32;  // Smaller shards make LRU too coarse
+
+    /**
+     * Constructor
+     * @param ttl_seconds Time-to-live for cache entries in seconds
+     * @param max_size Maximum number of entries across all shards
+     * @param shards Number of shards (0 = 4 per hardware thread); capped so
+     *               each shard holds at least MIN_SHARD_ENTRIES entries
+     * @param max_bytes Byte budget across all shards (0 = entry limit only)
+     * @param soft_ttl_seconds Age after which entries are reported stale (0 = never)
+     */
+    explicit ShardedCache(int ttl_seconds = 300, size_t max_size = 100, size_t shards = 0, size_t max_bytes = 0,
+                          int soft_ttl_seconds = 0) {
+        if (shards == 0) {
+            shards = 4 * std::max(1u, std::thread::hardware_concurrency());
+        }
+        shards = std::max<size_t>(1, std::min(shards, max_size / MIN_SHARD_ENTRIES));
+
+        size_t per_shard = (max_size + shards - 1) / shards;
+        size_t bytes_per_shard = (max_bytes + shards - 1) / shards;
+        shards_.reserve(shards);
+        for (size_t i = 0; i < shards; i++) {
+            shards_.push_back(std::make_unique<Shard>(ttl_seconds, per_shard, bytes_per_shard, soft_ttl_seconds));
+        }
+    }
+
+    /**
+     * Try to get result from cache without copying it
+     * @param query The search query
+     * @param stale Set to whether the entry is past the soft TTL (optional)
+     * @return The shared cached response, or null on a cache miss
+     */
+    CachedResponsePtr get(const std::string& query, bool* stale = nullptr) {
+        return shardFor(query).get(query, stale);
+    }
+
+    /**
+     * Try to get result from cache as a message (parses a copy)
+     * @param query The search query
+     * @param response The response to populate (if cache hit)
+     * @return Whether the item was found in cache (cache hit)
+     */
+    bool get(const std::string& query, movie::SearchResponse& response) {
+        return shardFor(query).get(query, response);
+    }
+
+    /**
+     * Look at an entry without counting a hit or miss or refreshing it
+     * @param query The search query
+     * @return The shared cached response, or null if absent or expired
+     */
+    CachedResponsePtr peek(const std::string& query) {
+        return shardFor(query).peek(query);
+    }
+
+    /**
+     * Count a miss of `query` that was answered from another query's result
+     */
+    void recordDerivedHit(const std::string& query) {
+        shardFor(query).recordDerivedHit();
+    }
+
+    /**
+     * Store result in cache
+     * @param query The search query
+     * @param response The response to cache
+     */
+    void put(const std::string& query, const movie::SearchResponse& response) {
+        shardFor(query).put(query, response);
+    }
+
+    void put(const std::string& query, CachedResponsePtr payload) {
+        shardFor(query).put(query, std::move(payload));
+    }
+
+    /**
+     * Get the most frequently hit live entries across all shards
+     * @param limit Maximum number of entries
+     * @return Up to `limit` entries, hottest first
+     */
+    std::vector<Cache::Record> hottest(size_t limit) const {
+        std::vector<Cache::Record> records;
+        for (const auto& shard : shards_) {
+            std::vector<Cache::Record> shard_records = shard->cache.hottest(limit);
+            records.insert(records.end(), std::make_move_iterator(shard_records.begin()),
+                           std::make_move_iterator(shard_records.end()));
+        }
+        std::stable_sort(records.begin(), records.end(),
+                         [](const Cache::Record& a, const Cache::Record& b) { return a.hits > b.hits; });
+        records.resize(std::min(limit, records.size()));
+        return records;
+    }
+
+    /**
+     * Put back an entry exported by hottest() (see Cache::restore())
+     * @return Whether the entry was stored
+     */
+    bool restore(const Cache::Record& record) {
+        return shardFor(record.query).restore(record);
+    }
+
+    /**
+     * Clear all entries from the cache
+     */
+    void clear() {
+        for (auto& shard : shards_) shard->cache.clear();
+    }
+
+    /**
+     * Get current cache size
+     * @return The number of entries in all shards
+     */
+    size_t size() const {
+        size_t total = 0;
+        for (const auto& shard : shards_) total += shard->cache.size();
+        return total;
+    }
+
+    /**
+     * Get the bytes charged in all shards
+     */
+    size_t bytes() const {
+        size_t total = 0;
+        for (const auto& shard : shards_) total += shard->cache.bytes();
+        return total;
+    }
+
+    /**
+     * Get cache hit ratio
+     * @return Hit ratio (0.0 to 1.0)
+     */
+    double hit_ratio() const {
+        uint64_t hits = hit_count();
+        uint64_t total = hits + miss_count();
+        return total == 0 ? 0.0 : static_cast<double>(hits) / static_cast<double>(total);
+    }
+
+    /**
+     * Get cache hit count (summed over shards)
+     * @return Number of cache hits
+     */
+    uint64_t hit_count() const {
+        uint64_t total = 0;
+        for (const auto& shard : shards_) total += shard->cache.hit_count();
+        return total;
+    }
+
+    /**
+     * Get cache miss count (summed over shards)
+     * @return Number of cache misses
+     */
+    uint64_t miss_count() const {
+        uint64_t total = 0;
+        for (const auto& shard : shards_) total += shard->cache.miss_count();
+        return total;
+    }
+
+    /**
+     * Get the number of misses answered from another query's result (summed over shards)
+     */
+    uint64_t derived_hit_count() const {
+        uint64_t total = 0;
+        for (const auto& shard : shards_) total += shard->cache.derived_hit_count();
+        return total;
+    }
+
+    /**
+     * Get the number of hits on entries past the soft TTL (summed over shards)
+     */
+    uint64_t stale_hit_count() const {
+        uint64_t total = 0;
+        for (const auto& shard : shards_) total += shard->cache.stale_hit_count();
+        return total;
+    }
+
+    /**
+     * Get the number of entries refused by admission (summed over shards)
+     */
+    uint64_t rejected_count() const {
+        uint64_t total = 0;
+        for (const auto& shard : shards_) total += shard->cache.rejected_count();
+        return total;
+    }
+
+    /**
+     * Get the number of shards
+     */
+    size_t shard_count() const {
+        return shards_.size();
+    }
+
+private:
+    // One shard per cache line (or more), so neighbouring shards don't false-share
+    struct alignas(64) Shard {
+        Shard(int ttl_seconds, size_t max_size, size_t max_bytes, int soft_ttl_seconds)
+            : cache(ttl_seconds, max_size, max_bytes, soft_ttl_seconds) {}
+        Cache cache;
+    };
+
+    Cache& shardFor(const std::string& query) {
+        // Mix the hash so shard selection doesn't depend on its low bits alone
+        uint64_t h = std::hash<std::string>()(query);
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        return shards_[h % shards_.size()]->cache;
+    }
+
+    std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+#endif // SHARDED_CACHE_H
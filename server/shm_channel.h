@@ -0,0 +1,606 @@
+#ifndef SHM_CHANNEL_H
+#define SHM_CHANNEL_H
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <climits>
+#include <cstring>
+#include <cstdint>
+#include <cerrno>
+#include <stdexcept>
+#include <algorithm>
+#include <fcntl.h>      // For O_* constants
+#include <sys/mman.h>   // For mmap, munmap
+#include <sys/stat.h>   // For mode constants
+#include <signal.h>     // For kill(pid, 0)
+#include <unistd.h>     // For ftruncate, close, getpid, syscall
+#include <time.h>       // For timespec
+#include <sys/syscall.h>  // For SYS_futex
+#include <linux/futex.h>  // For FUTEX_WAIT, FUTEX_WAKE
+
+/**
+ * Request/response channel between processes on one machine (A -> B).
+ *
+ * Layout (CHANNEL_VERSION 3):
+ *   ChannelHeader        submission head and tail, each on its own cache line,
+ *                        and the request futex word
+ *   RequestSlot[slots]   submission ring, one request per slot
+ *   ResponseSlot[slots]  completion ring; slot i answers request slot i
+ *
+ * Clients claim a ticket with one compare-and-swap on the head. Ticket t
+ * uses slot t % slots, whose sequence number says what the slot holds: t
+ * while it is free for ticket t, t + 1 once the request is written, and
+ * t + slots once the client has collected the response. The server takes
+ * requests in ticket order at the tail, so both finding the next request
+ * and finding a request's response are O(1), whatever the ticket count.
+ * Nothing takes a lock, and every slot is cache-line aligned, so clients
+ * writing neighbouring slots don't share lines.
+ *
+ * A response slot moves from WAITING to READY when the server completes
+ * it. A client that times out moves it to ABANDONED instead, and whichever
+ * side comes second frees the slot. A server that starts after another
+ * died completes the requests that were taken but never answered
+ * (recoverTaken()), and a client finding its slot held by a response
+ * nobody collected frees it if the requesting process is gone.
+ *
+ * A response larger than MAX_RESPONSE_SIZE is written to a segment of its
+ * own, named after the channel and the ticket, and the slot only records
+ * its size. The client removes that segment once it has read it; if the
+ * client gave up or exited, whoever frees the slot removes it.
+ *
+ * waitForRequest() and wait() spin briefly and then sleep on a futex in
+ * the segment: the request counter in the header for the server, the
+ * slot's state for a client. The other side only makes the wake syscall
+ * when someone is asleep, so a busy channel never enters the kernel and
+ * an idle one uses no CPU. The spin length adapts: it doubles when
+ * spinning caught the event and halves when the waiter had to sleep.
+ */
+class SharedMemoryChannel {
+public:
+    static constexpr size_t MAX_QUERY_SIZE = 256;
+    static constexpr size_t MAX_RESPONSE_SIZE = 64 * 1024;  // Larger responses are spilled, see above
+    static constexpr uint32_t DEFAULT_SLOTS = 32;
+
+    // A request as seen by the server
+    struct Request {
+        uint64_t ticket;      // Pass to complete()
+        uint64_t request_id;  // Chosen by the client, for logging
+        std::string query;
+    };
+
+    // What a client's poll found
+    enum PollResult {
+        POLL_PENDING,         // No response yet
+        POLL_READY,           // Response copied out, slot freed
+        POLL_FAILED           // The server could not answer; slot freed
+    };
+
+    /**
+     * Constructor - creates or opens the channel segment
+     * @param name Name of the shared memory segment (must start with /)
+     * @param create Whether to create the segment if it doesn't exist
+     * @param slots Ring size when creating (a power of two)
+     */
+    explicit SharedMemoryChannel(const std::string& name, bool create = true, uint32_t slots = DEFAULT_SLOTS)
+        : name_(name) {
+        if (name.empty() || name[0] != '/') {
+            throw std::invalid_argument("Shared memory name must start with '/'");
+        }
+        if (slots == 0 || (slots & (slots - 1)) != 0) {
+            throw std::invalid_argument("Channel slot count must be a power of two");
+        }
+
+        fd_ = shm_open(name.c_str(), create ? (O_CREAT | O_RDWR) : O_RDWR, S_IRUSR | S_IWUSR);
+        if (fd_ == -1) {
+            throw std::runtime_error("Failed to open channel " + name + ": " + std::string(strerror(errno)));
+        }
+
+        struct stat sb;
+        if (fstat(fd_, &sb) == -1) {
+            close(fd_);
+            throw std::runtime_error("Failed to get channel size: " + std::string(strerror(errno)));
+        }
+        size_ = static_cast<size_t>(sb.st_size);
+        if (create && size_ < segmentSize(slots)) {
+            size_ = segmentSize(slots);
+            if (ftruncate(fd_, static_cast<off_t>(size_)) == -1) {
+                close(fd_);
+                throw std::runtime_error("Failed to set channel size: " + std::string(strerror(errno)));
+            }
+        }
+        if (size_ < sizeof(ChannelHeader)) {
+            close(fd_);
+            throw std::runtime_error("Channel " + name + " is not initialized");
+        }
+
+        data_ = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (data_ == MAP_FAILED) {
+            close(fd_);
+            throw std::runtime_error("Failed to map channel: " + std::string(strerror(errno)));
+        }
+
+        if (!validLayout()) {
+            if (!create) {
+                munmap(data_, size_);
+                close(fd_);
+                throw std::runtime_error("Channel " + name + " has an incompatible layout");
+            }
+            initialize(slots);
+        }
+        mask_ = header()->slotCount - 1;
+    }
+
+    ~SharedMemoryChannel() {
+        munmap(data_, size_);
+        close(fd_);
+    }
+
+    SharedMemoryChannel(const SharedMemoryChannel&) = delete;
+    SharedMemoryChannel& operator=(const SharedMemoryChannel&) = delete;
+
+    /**
+     * Queue a request (client side)
+     * @param query The query; longer ones are cut to MAX_QUERY_SIZE - 1 bytes
+     * @param request_id Id shown in the server's logs
+     * @param ticket Receives the ticket to poll for the response
+     * @return Whether a slot was free
+     */
+    bool submit(const std::string& query, uint64_t request_id, uint64_t& ticket) {
+        ChannelHeader* h = header();
+        uint64_t pos = h->submitHead.load(std::memory_order_relaxed);
+        for (;;) {
+            RequestSlot& slot = requestSlot(pos);
+            int64_t diff = static_cast<int64_t>(slot.sequence.load(std::memory_order_acquire) - pos);
+            if (diff == 0) {
+                if (h->submitHead.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                // Still held by the ticket one lap earlier
+                if (!reclaimOrphan(pos - slotCount())) {
+                    return false;
+                }
+                pos = h->submitHead.load(std::memory_order_relaxed);
+            } else {
+                pos = h->submitHead.load(std::memory_order_relaxed);
+            }
+        }
+
+        RequestSlot& slot = requestSlot(pos);
+        size_t size = std::min(query.size(), MAX_QUERY_SIZE - 1);
+        memcpy(slot.query, query.data(), size);
+        slot.querySize = static_cast<uint32_t>(size);
+        slot.requestId = request_id;
+        slot.clientPid = static_cast<int32_t>(getpid());
+        responseSlot(pos).state.store(WAITING, std::memory_order_relaxed);
+        slot.sequence.store(pos + 1, std::memory_order_release);
+        ticket = pos;
+
+        // Wake the server if it sleeps
+        h->requestSignal.fetch_add(1, std::memory_order_seq_cst);
+        if (h->serverWaiters.load(std::memory_order_seq_cst) > 0) {
+            futexWake(&h->requestSignal, 1);
+        }
+        return true;
+    }
+
+    /**
+     * Check for a request's response without waiting (client side)
+     * @param ticket Ticket from submit()
+     * @param response Receives the serialized response when ready
+     * @return What was found
+     */
+    PollResult poll(uint64_t ticket, std::vector<uint8_t>& response) {
+        ResponseSlot& slot = responseSlot(ticket);
+        if (slot.state.load(std::memory_order_acquire) != READY) {
+            return POLL_PENDING;
+        }
+        bool valid = slot.valid != 0;
+        if (valid && slot.spilled) {
+            valid = readSpill(ticket, slot.size, response);
+            removeSpill(ticket);
+        } else {
+            response.assign(slot.data, slot.data + (valid ? slot.size : 0));
+        }
+        release(ticket);
+        return valid ? POLL_READY : POLL_FAILED;
+    }
+
+    /**
+     * Wait for a request's response (client side); spins briefly, then sleeps until woken
+     * @param ticket Ticket from submit()
+     * @param response Receives the serialized response when ready
+     * @param timeout How long to wait; POLL_PENDING after that
+     * @return What was found
+     */
+    PollResult wait(uint64_t ticket, std::vector<uint8_t>& response, std::chrono::milliseconds timeout) {
+        ResponseSlot& slot = responseSlot(ticket);
+        spinUntil(responseSpins_, [&]() { return slot.state.load(std::memory_order_acquire) != WAITING; });
+
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        for (;;) {
+            PollResult result = poll(ticket, response);
+            if (result != POLL_PENDING) {
+                return result;
+            }
+            auto now = std::chrono::steady_clock::now();
+            if (now >= deadline) {
+                return POLL_PENDING;
+            }
+
+            // Announce the sleep before the last check, so complete() either
+            // sees the flag or its answer is seen here
+            slot.clientWaiting.store(1, std::memory_order_seq_cst);
+            if (slot.state.load(std::memory_order_seq_cst) == WAITING) {
+                futexWait(&slot.state, WAITING,
+                          std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - now));
+            }
+            slot.clientWaiting.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * Give up on a request (client side); its slot is freed once the server is done with it
+     * @param ticket Ticket from submit()
+     */
+    void abandon(uint64_t ticket) {
+        ResponseSlot& slot = responseSlot(ticket);
+        uint32_t expected = WAITING;
+        if (!slot.state.compare_exchange_strong(expected, ABANDONED, std::memory_order_acq_rel)) {
+            // Answered meanwhile
+            if (slot.spilled) {
+                removeSpill(ticket);
+            }
+            release(ticket);
+        }
+    }
+
+    /**
+     * Take the next request, if any (server side)
+     * @param request Receives the request
+     * @return Whether there was one
+     */
+    bool receive(Request& request) {
+        ChannelHeader* h = header();
+        uint64_t pos = h->submitTail.load(std::memory_order_relaxed);
+        for (;;) {
+            RequestSlot& slot = requestSlot(pos);
+            if (slot.sequence.load(std::memory_order_acquire) != pos + 1) {
+                return false;
+            }
+            request.ticket = pos;
+            request.request_id = slot.requestId;
+            request.query.assign(slot.query, std::min<size_t>(slot.querySize, MAX_QUERY_SIZE - 1));
+            if (h->submitTail.compare_exchange_weak(pos, pos + 1, std::memory_order_acq_rel)) {
+                return true;
+            }
+        }
+    }
+
+    /**
+     * Take the next request, waiting up to `timeout` for one (server side);
+     * spins briefly, then sleeps until a client submits or wakeServer() is called
+     * @param request Receives the request
+     * @param timeout Longest time to sleep
+     * @return Whether there was one; false after a timeout or a wakeServer()
+     */
+    bool waitForRequest(Request& request, std::chrono::milliseconds timeout) {
+        if (spinUntil(requestSpins_, [&]() { return receive(request); })) {
+            return true;
+        }
+
+        // A submit after this load changes the word, so the futex won't sleep through it
+        ChannelHeader* h = header();
+        uint32_t signal = h->requestSignal.load(std::memory_order_seq_cst);
+        if (receive(request)) {
+            return true;
+        }
+        h->serverWaiters.fetch_add(1, std::memory_order_seq_cst);
+        futexWait(&h->requestSignal, signal, timeout);
+        h->serverWaiters.fetch_sub(1, std::memory_order_relaxed);
+        return receive(request);
+    }
+
+    /**
+     * Wake servers sleeping in waitForRequest(), e.g. so they notice a shutdown
+     */
+    void wakeServer() {
+        header()->requestSignal.fetch_add(1, std::memory_order_seq_cst);
+        futexWake(&header()->requestSignal, INT_MAX);
+    }
+
+    /**
+     * Answer a request (server side)
+     * @param ticket Ticket of the request
+     * @param data Serialized response
+     * @param size Bytes of data; beyond MAX_RESPONSE_SIZE they are spilled to a segment of their own
+     * @param valid False to report that the request could not be answered
+     * @return Whether the response was stored and the client was still waiting
+     */
+    bool complete(uint64_t ticket, const uint8_t* data, size_t size, bool valid = true) {
+        ResponseSlot& slot = responseSlot(ticket);
+        slot.spilled = 0;
+        if (valid && size > MAX_RESPONSE_SIZE) {
+            valid = writeSpill(ticket, data, size);
+            slot.spilled = valid ? 1 : 0;
+        } else if (valid && size > 0) {
+            memcpy(slot.data, data, size);
+        }
+        slot.valid = valid ? 1 : 0;
+        slot.size = valid ? size : 0;
+
+        uint32_t expected = WAITING;
+        if (slot.state.compare_exchange_strong(expected, READY, std::memory_order_seq_cst)) {
+            if (slot.clientWaiting.load(std::memory_order_seq_cst)) {
+                futexWake(&slot.state, INT_MAX);
+            }
+            return valid;
+        }
+        if (slot.spilled) {
+            removeSpill(ticket);
+        }
+        release(ticket);  // The client gave up
+        return false;
+    }
+
+    /**
+     * Fail the requests a previous server took but never answered; call
+     * once when a server starts on an existing channel
+     * @return The number of requests failed
+     */
+    size_t recoverTaken() {
+        uint64_t tail = header()->submitTail.load(std::memory_order_acquire);
+        size_t recovered = 0;
+        for (uint64_t ticket = tail > slotCount() ? tail - slotCount() : 0; ticket < tail; ticket++) {
+            if (requestSlot(ticket).sequence.load(std::memory_order_acquire) != ticket + 1) {
+                continue;
+            }
+            uint32_t state = responseSlot(ticket).state.load(std::memory_order_acquire);
+            if (state == WAITING || state == ABANDONED) {
+                complete(ticket, nullptr, 0, false);
+                recovered++;
+            }
+        }
+        return recovered;
+    }
+
+    uint32_t slotCount() const {
+        return static_cast<uint32_t>(mask_ + 1);
+    }
+
+    /**
+     * Remove the channel segment
+     * @param name The name of the segment to destroy
+     */
+    static void destroy(const std::string& name) {
+        shm_unlink(name.c_str());
+    }
+
+private:
+    static constexpr uint32_t CHANNEL_MAGIC = 0x43484E4C;  // "CHNL"
+    static constexpr uint32_t CHANNEL_VERSION = 3;          // Bump when the layout below changes
+    static constexpr uint32_t MIN_SPINS = 32;               // Bounds of the adaptive spin, in pause
+    static constexpr uint32_t MAX_SPINS = 4096;             // instructions (about 1-150 us)
+
+    enum ResponseState : uint32_t {
+        EMPTY = 0,
+        WAITING = 1,      // Submitted, not answered
+        READY = 2,        // Answered, not collected
+        ABANDONED = 3     // The client stopped waiting
+    };
+
+    struct ChannelHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t slotCount;
+        alignas(64) std::atomic<uint64_t> submitHead;  // Next ticket a client claims
+        alignas(64) std::atomic<uint64_t> submitTail;  // Next ticket the server takes
+        alignas(64) std::atomic<uint32_t> requestSignal;  // Futex word, bumped by every submit
+        std::atomic<uint32_t> serverWaiters;               // Servers asleep on requestSignal
+    };
+
+    struct alignas(64) RequestSlot {
+        std::atomic<uint64_t> sequence;  // See the class comment
+        uint64_t requestId;
+        int32_t clientPid;               // For reclaimOrphan()
+        uint32_t querySize;
+        char query[MAX_QUERY_SIZE];
+    };
+
+    struct alignas(64) ResponseSlot {
+        std::atomic<uint32_t> state;     // ResponseState, and the futex word clients sleep on
+        std::atomic<uint32_t> clientWaiting;  // Whether the client sleeps, so complete() wakes it
+        uint32_t valid;
+        uint32_t spilled;                // The response is in spillName(ticket), not in data
+        uint64_t size;
+        char data[MAX_RESPONSE_SIZE];
+    };
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+                  "Atomics shared between processes must be lock-free");
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "Futex words must be plain 32-bit integers");
+
+    static void futexWait(std::atomic<uint32_t>* word, uint32_t expected, std::chrono::nanoseconds timeout) {
+        struct timespec ts;
+        ts.tv_sec = static_cast<time_t>(timeout.count() / 1000000000);
+        ts.tv_nsec = static_cast<long>(timeout.count() % 1000000000);
+        // Not FUTEX_PRIVATE_FLAG: the word is shared between processes
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, expected, &ts, nullptr, 0);
+    }
+
+    static void futexWake(std::atomic<uint32_t>* word, int waiters) {
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, waiters, nullptr, nullptr, 0);
+    }
+
+    static inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield");
+#endif
+    }
+
+    // Spin for up to `budget` rounds until ready(); on one CPU the other side can't run meanwhile, so don't
+    template <typename ReadyFn>
+    static bool spinUntil(std::atomic<uint32_t>& budget, ReadyFn ready) {
+        static const bool multiCore = std::thread::hardware_concurrency() > 1;
+        uint32_t spins = multiCore ? budget.load(std::memory_order_relaxed) : 0;
+        for (uint32_t i = 0; i < spins; i++) {
+            if (ready()) {
+                budget.store(std::min(spins * 2, MAX_SPINS), std::memory_order_relaxed);
+                return true;
+            }
+            cpuRelax();
+        }
+        if (multiCore) {
+            budget.store(std::max(spins / 2, MIN_SPINS), std::memory_order_relaxed);
+        }
+        return ready();
+    }
+
+    static size_t segmentSize(uint32_t slots) {
+        return sizeof(ChannelHeader) + slots * (sizeof(RequestSlot) + sizeof(ResponseSlot));
+    }
+
+    ChannelHeader* header() const {
+        return reinterpret_cast<ChannelHeader*>(data_);
+    }
+
+    RequestSlot& requestSlot(uint64_t ticket) const {
+        RequestSlot* slots = reinterpret_cast<RequestSlot*>(static_cast<uint8_t*>(data_) + sizeof(ChannelHeader));
+        return slots[ticket & mask_];
+    }
+
+    ResponseSlot& responseSlot(uint64_t ticket) const {
+        ResponseSlot* slots = reinterpret_cast<ResponseSlot*>(
+            static_cast<uint8_t*>(data_) + sizeof(ChannelHeader) + (mask_ + 1) * sizeof(RequestSlot));
+        return slots[ticket & mask_];
+    }
+
+    bool validLayout() const {
+        const ChannelHeader* h = header();
+        return h->magic == CHANNEL_MAGIC && h->version == CHANNEL_VERSION && h->slotCount > 0 &&
+               (h->slotCount & (h->slotCount - 1)) == 0 && segmentSize(h->slotCount) <= size_;
+    }
+
+    // Write an empty ring; slot i starts free for ticket i
+    void initialize(uint32_t slots) {
+        ChannelHeader* h = header();
+        h->magic = 0;
+        h->slotCount = std::min<uint32_t>(slots, static_cast<uint32_t>((size_ - sizeof(ChannelHeader)) /
+                                                                        (sizeof(RequestSlot) + sizeof(ResponseSlot))));
+        mask_ = h->slotCount - 1;
+        h->submitHead.store(0, std::memory_order_relaxed);
+        h->submitTail.store(0, std::memory_order_relaxed);
+        h->requestSignal.store(0, std::memory_order_relaxed);
+        h->serverWaiters.store(0, std::memory_order_relaxed);
+        for (uint64_t i = 0; i < h->slotCount; i++) {
+            requestSlot(i).sequence.store(i, std::memory_order_relaxed);
+            responseSlot(i).state.store(EMPTY, std::memory_order_relaxed);
+            responseSlot(i).clientWaiting.store(0, std::memory_order_relaxed);
+            responseSlot(i).spilled = 0;
+        }
+        h->version = CHANNEL_VERSION;
+        std::atomic_thread_fence(std::memory_order_release);
+        h->magic = CHANNEL_MAGIC;
+    }
+
+    // Hand a ticket's slot to the ticket one lap later
+    void release(uint64_t ticket) {
+        responseSlot(ticket).state.store(EMPTY, std::memory_order_relaxed);
+        requestSlot(ticket).sequence.store(ticket + slotCount(), std::memory_order_release);
+    }
+
+    // Free a slot whose response was never collected because its client exited
+    bool reclaimOrphan(uint64_t ticket) {
+        RequestSlot& slot = requestSlot(ticket);
+        if (slot.sequence.load(std::memory_order_acquire) != ticket + 1) {
+            return false;
+        }
+        pid_t pid = slot.clientPid;
+        if (pid == getpid() || kill(pid, 0) == 0 || errno != ESRCH) {
+            return false;
+        }
+        uint32_t expected = READY;
+        if (!responseSlot(ticket).state.compare_exchange_strong(expected, EMPTY, std::memory_order_acq_rel)) {
+            return false;
+        }
+        if (responseSlot(ticket).spilled) {
+            removeSpill(ticket);
+        }
+        slot.sequence.store(ticket + slotCount(), std::memory_order_release);
+        return true;
+    }
+
+    std::string spillName(uint64_t ticket) const {
+        return name_ + "." + std::to_string(ticket);
+    }
+
+    // Write a response too large for its slot to a segment of its own
+    bool writeSpill(uint64_t ticket, const uint8_t* data, size_t size) {
+        std::string name = spillName(ticket);
+        int fd = shm_open(name.c_str(), O_CREAT | O_TRUNC | O_RDWR, S_IRUSR | S_IWUSR);
+        if (fd == -1) {
+            return false;
+        }
+        size_t written = 0;
+        while (written < size) {
+            ssize_t n = ::write(fd, data + written, size - written);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                break;
+            }
+            written += static_cast<size_t>(n);
+        }
+        close(fd);
+        if (written < size) {
+            shm_unlink(name.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    bool readSpill(uint64_t ticket, size_t size, std::vector<uint8_t>& response) const {
+        int fd = shm_open(spillName(ticket).c_str(), O_RDONLY, 0);
+        if (fd == -1) {
+            return false;
+        }
+        response.resize(size);
+        size_t done = 0;
+        while (done < size) {
+            ssize_t n = ::read(fd, response.data() + done, size - done);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                break;
+            }
+            done += static_cast<size_t>(n);
+        }
+        close(fd);
+        if (done < size) {
+            response.clear();
+            return false;
+        }
+        return true;
+    }
+
+    void removeSpill(uint64_t ticket) const {
+        shm_unlink(spillName(ticket).c_str());
+    }
+
+    std::string name_;
+    int fd_ = -1;
+    size_t size_ = 0;
+    void* data_ = nullptr;
+    uint64_t mask_ = 0;
+    std::atomic<uint32_t> requestSpins_{MAX_SPINS / 4};   // Adaptive spin lengths, see spinUntil()
+    std::atomic<uint32_t> responseSpins_{MAX_SPINS / 4};
+};
+
+#endif // SHM_CHANNEL_H
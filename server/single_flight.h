@@ -0,0 +1,90 @@
+#ifndef SINGLE_FLIGHT_H
+#define SINGLE_FLIGHT_H
+
+#include <string>
+#include <unordered_map>
+#include <mutex>
+#include <future>
+#include <atomic>
+#include <exception>
+
+/**
+ * Coalesces concurrent calls for the same key into one.
+ *
+ * The first caller for a key (the leader) runs the work; callers that
+ * arrive while it runs wait for the leader's result instead of repeating
+ * the work. When a cached query expires, the burst of requests for it
+ * therefore costs one search and fan-out instead of one per request.
+ * A key is only in flight while its work runs; the next call after that
+ * starts a new one, so the work should publish its result (e.g. to the
+ * cache) before returning.
+ */
+template <typename Value>
+class SingleFlight {
+public:
+    /**
+     * Run `work` for a key, or wait for the run already in flight for it
+     * @param key Key identifying the work
+     * @param work Callable returning Value; exceptions reach every waiter
+     * @param shared Set to whether the result came from another caller's run
+     * @return The result of the run
+     */
+    template <typename Work>
+    Value run(const std::string& key, Work work, bool* shared = nullptr) {
+        std::promise<Value> promise;
+        std::shared_future<Value> result;
+        bool leader = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = calls_.find(key);
+            if (it != calls_.end()) {
+                result = it->second;
+            } else {
+                result = promise.get_future().share();
+                calls_.emplace(key, result);
+                leader = true;
+            }
+        }
+
+        if (shared) {
+            *shared = !leader;
+        }
+        if (!leader) {
+            coalesced_count_++;
+            return result.get();
+        }
+
+        try {
+            promise.set_value(work());
+        } catch (...) {
+            promise.set_exception(std::current_exception());
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            calls_.erase(key);
+        }
+        return result.get();
+    }
+
+    /**
+     * Get the number of calls that waited for another caller's run
+     */
+    uint64_t coalesced_count() const {
+        return coalesced_count_;
+    }
+
+    /**
+     * Get the number of keys currently being worked on
+     */
+    size_t in_flight() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return calls_.size();
+    }
+
+private:
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, std::shared_future<Value>> calls_;
+    std::atomic<uint64_t> coalesced_count_{0};
+};
+
+#endif // SINGLE_FLIGHT_H
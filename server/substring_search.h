@@ -0,0 +1,196 @@
+#ifndef SUBSTRING_SEARCH_H
+#define SUBSTRING_SEARCH_H
+
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define SUBSTRING_SEARCH_X86 1
+#include <immintrin.h>
+#endif
+
+/**
+ * Case-insensitive (ASCII) substring search used by the match path.
+ *
+ * The vector kernels compare the first and the last byte of the needle
+ * against 16 (SSE4.2) or 32 (AVX2) haystack positions at once and only
+ * verify the bytes in between for positions where both ends match. The
+ * kernel is chosen once at runtime from the CPU features; non-x86 builds
+ * and older CPUs use the scalar kernel.
+ *
+ * The needle must already be lowercased; the haystack may be in any case.
+ */
+class CaseInsensitiveSearch {
+public:
+    enum class Kernel { Scalar, SSE42, AVX2 };
+
+    /**
+     * Check whether a haystack contains a needle, ignoring ASCII case
+     * @param haystack Text to search in
+     * @param lowerNeedle Lowercased text to search for
+     * @return Whether the needle occurs in the haystack
+     */
+    static bool contains(std::string_view haystack, std::string_view lowerNeedle) {
+        static const SearchFn fn = resolve(selectedKernel());
+        return fn(haystack.data(), haystack.size(), lowerNeedle.data(), lowerNeedle.size());
+    }
+
+    /**
+     * Same as contains() but with an explicit kernel (for tests and benchmarks)
+     * @param kernel Kernel to use; must be supported on this CPU
+     */
+    static bool containsWith(Kernel kernel, std::string_view haystack, std::string_view lowerNeedle) {
+        return resolve(kernel)(haystack.data(), haystack.size(), lowerNeedle.data(), lowerNeedle.size());
+    }
+
+    /**
+     * Check whether a kernel can run on this CPU
+     */
+    static bool supported(Kernel kernel) {
+        switch (kernel) {
+            case Kernel::Scalar:
+                return true;
+#ifdef SUBSTRING_SEARCH_X86
+            case Kernel::SSE42:
+                return __builtin_cpu_supports("sse4.2");
+            case Kernel::AVX2:
+                return __builtin_cpu_supports("avx2");
+#endif
+            default:
+                return false;
+        }
+    }
+
+    /**
+     * Get the best kernel supported by this CPU
+     */
+    static Kernel selectedKernel() {
+        if (supported(Kernel::AVX2)) return Kernel::AVX2;
+        if (supported(Kernel::SSE42)) return Kernel::SSE42;
+        return Kernel::Scalar;
+    }
+
+    static const char* kernelName(Kernel kernel) {
+        switch (kernel) {
+            case Kernel::SSE42: return "SSE4.2";
+            case Kernel::AVX2: return "AVX2";
+            default: return "scalar";
+        }
+    }
+
+private:
+    using SearchFn = bool (*)(const char*, size_t, const char*, size_t);
+
+    static SearchFn resolve(Kernel kernel) {
+#ifdef SUBSTRING_SEARCH_X86
+        if (kernel == Kernel::AVX2) return &containsAvx2;
+        if (kernel == Kernel::SSE42) return &containsSse42;
+#endif
+        (void)kernel;
+        return &containsScalar;
+    }
+
+    static inline unsigned char foldAscii(unsigned char c) {
+        return (c >= 'A' && c <= 'Z') ? static_cast<unsigned char>(c + ('a' - 'A')) : c;
+    }
+
+    // OR mask that folds a byte onto `c` when `c` is a lowercase letter
+    static inline char foldMask(unsigned char c) {
+        return (c >= 'a' && c <= 'z') ? 0x20 : 0x00;
+    }
+
+    // Compare `len` haystack bytes against lowercased needle bytes
+    static inline bool equalsFolded(const char* hay, const char* lowerNeedle, size_t len) {
+        for (size_t i = 0; i < len; i++) {
+            if (foldAscii(static_cast<unsigned char>(hay[i])) != static_cast<unsigned char>(lowerNeedle[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Scalar search over the positions starting at `from`
+    static bool containsScalarFrom(const char* hay, size_t n, const char* needle, size_t m, size_t from) {
+        if (m == 0) return true;
+        if (m > n) return false;
+        const unsigned char first = static_cast<unsigned char>(needle[0]);
+        const unsigned char last = static_cast<unsigned char>(needle[m - 1]);
+        for (size_t i = from; i + m <= n; i++) {
+            if (foldAscii(static_cast<unsigned char>(hay[i])) == first &&
+                foldAscii(static_cast<unsigned char>(hay[i + m - 1])) == last &&
+                equalsFolded(hay + i + 1, needle + 1, m > 2 ? m - 2 : 0)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static bool containsScalar(const char* hay, size_t n, const char* needle, size_t m) {
+        return containsScalarFrom(hay, n, needle, m, 0);
+    }
+
+#ifdef SUBSTRING_SEARCH_X86
+    __attribute__((target("sse4.2")))
+    static bool containsSse42(const char* hay, size_t n, const char* needle, size_t m) {
+        if (m == 0) return true;
+        if (m > n) return false;
+
+        const unsigned char f = static_cast<unsigned char>(needle[0]);
+        const unsigned char l = static_cast<unsigned char>(needle[m - 1]);
+        const __m128i first = _mm_set1_epi8(static_cast<char>(f));
+        const __m128i last = _mm_set1_epi8(static_cast<char>(l));
+        const __m128i firstMask = _mm_set1_epi8(foldMask(f));
+        const __m128i lastMask = _mm_set1_epi8(foldMask(l));
+
+        size_t i = 0;
+        for (; i + m - 1 + 16 <= n; i += 16) {
+            __m128i blockFirst = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hay + i));
+            __m128i blockLast = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hay + i + m - 1));
+            __m128i eqFirst = _mm_cmpeq_epi8(_mm_or_si128(blockFirst, firstMask), first);
+            __m128i eqLast = _mm_cmpeq_epi8(_mm_or_si128(blockLast, lastMask), last);
+            uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_and_si128(eqFirst, eqLast)));
+            while (mask != 0) {
+                unsigned bit = static_cast<unsigned>(__builtin_ctz(mask));
+                if (m <= 2 || equalsFolded(hay + i + bit + 1, needle + 1, m - 2)) {
+                    return true;
+                }
+                mask &= mask - 1;
+            }
+        }
+        return containsScalarFrom(hay, n, needle, m, i);
+    }
+
+    __attribute__((target("avx2")))
+    static bool containsAvx2(const char* hay, size_t n, const char* needle, size_t m) {
+        if (m == 0) return true;
+        if (m > n) return false;
+
+        const unsigned char f = static_cast<unsigned char>(needle[0]);
+        const unsigned char l = static_cast<unsigned char>(needle[m - 1]);
+        const __m256i first = _mm256_set1_epi8(static_cast<char>(f));
+        const __m256i last = _mm256_set1_epi8(static_cast<char>(l));
+        const __m256i firstMask = _mm256_set1_epi8(foldMask(f));
+        const __m256i lastMask = _mm256_set1_epi8(foldMask(l));
+
+        size_t i = 0;
+        for (; i + m - 1 + 32 <= n; i += 32) {
+            __m256i blockFirst = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(hay + i));
+            __m256i blockLast = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(hay + i + m - 1));
+            __m256i eqFirst = _mm256_cmpeq_epi8(_mm256_or_si256(blockFirst, firstMask), first);
+            __m256i eqLast = _mm256_cmpeq_epi8(_mm256_or_si256(blockLast, lastMask), last);
+            uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_and_si256(eqFirst, eqLast)));
+            while (mask != 0) {
+                unsigned bit = static_cast<unsigned>(__builtin_ctz(mask));
+                if (m <= 2 || equalsFolded(hay + i + bit + 1, needle + 1, m - 2)) {
+                    return true;
+                }
+                mask &= mask - 1;
+            }
+        }
+        return containsScalarFrom(hay, n, needle, m, i);
+    }
+#endif
+};
+
+#endif // SUBSTRING_SEARCH_H
@@ -0,0 +1,179 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <memory>
+#include <chrono>
+
+/**
+ * Fixed-size work-stealing thread pool.
+ *
+ * Every worker owns a task deque. Tasks are spread over the deques round
+ * robin; a worker pops from the back of its own deque and, when that is
+ * empty, steals from the front of the others. Threads waiting in
+ * parallelFor help run queued tasks instead of blocking, so nested or
+ * concurrent parallel loops from several gRPC handler threads cannot
+ * starve each other.
+ */
+class WorkStealingPool {
+public:
+    /**
+     * Constructor
+     * @param threads Number of worker threads (at least 1)
+     */
+    explicit WorkStealingPool(size_t threads)
+        : queues_(threads > 0 ? threads : 1) {
+        for (size_t i = 0; i < queues_.size(); i++) {
+            queues_[i] = std::make_unique<WorkQueue>();
+        }
+        for (size_t i = 0; i < queues_.size(); i++) {
+            workers_.emplace_back(&WorkStealingPool::workerLoop, this, i);
+        }
+    }
+
+    ~WorkStealingPool() {
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex_);
+            stopping_ = true;
+        }
+        wake_cv_.notify_all();
+        for (auto& worker : workers_) {
+            worker.join();
+        }
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    size_t threadCount() const {
+        return workers_.size();
+    }
+
+    /**
+     * Queue a task without waiting for it
+     * @param task Task to run on a worker
+     */
+    void submit(std::function<void()> task) {
+        size_t target = next_queue_.fetch_add(1) % queues_.size();
+        {
+            std::lock_guard<std::mutex> lock(queues_[target]->mutex);
+            queues_[target]->tasks.push_back(std::move(task));
+            pending_.fetch_add(1);
+        }
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        wake_cv_.notify_one();
+    }
+
+    /**
+     * Run fn(0) ... fn(tasks - 1) on the pool and wait for all of them.
+     * The calling thread runs tasks too while it waits.
+     * @param tasks Number of tasks
+     * @param fn Task body, called once per task index
+     */
+    void parallelFor(size_t tasks, const std::function<void(size_t)>& fn) {
+        if (tasks == 0) {
+            return;
+        }
+
+        auto job = std::make_shared<Job>();
+        job->remaining = tasks;
+
+        for (size_t i = 0; i < tasks; i++) {
+            submit([job, i, &fn]() {
+                fn(i);
+                if (job->remaining.fetch_sub(1) == 1) {
+                    std::lock_guard<std::mutex> lock(job->mutex);
+                    job->cv.notify_all();
+                }
+            });
+        }
+
+        // Help out until our own tasks are done
+        while (job->remaining.load() > 0) {
+            std::function<void()> task;
+            if (steal(0, task)) {
+                task();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(job->mutex);
+            job->cv.wait_for(lock, std::chrono::milliseconds(1), [&job]() {
+                return job->remaining.load() == 0;
+            });
+        }
+    }
+
+private:
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    struct Job {
+        std::atomic<size_t> remaining{0};
+        std::mutex mutex;
+        std::condition_variable cv;
+    };
+
+    // Pop from the back of our own queue
+    bool popLocal(size_t self, std::function<void()>& task) {
+        WorkQueue& queue = *queues_[self];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty()) {
+            return false;
+        }
+        task = std::move(queue.tasks.back());
+        queue.tasks.pop_back();
+        pending_.fetch_sub(1);
+        return true;
+    }
+
+    // Steal from the front of any queue, starting after `self`
+    bool steal(size_t self, std::function<void()>& task) {
+        for (size_t k = 1; k <= queues_.size(); k++) {
+            WorkQueue& queue = *queues_[(self + k) % queues_.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.tasks.empty()) {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+                pending_.fetch_sub(1);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void workerLoop(size_t self) {
+        while (true) {
+            std::function<void()> task;
+            if (popLocal(self, task) || steal(self, task)) {
+                task();
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(wake_mutex_);
+            wake_cv_.wait(lock, [this]() {
+                return stopping_ || pending_.load() > 0;
+            });
+            if (stopping_ && pending_.load() == 0) {
+                return;
+            }
+        }
+    }
+
+    std::vector<std::unique_ptr<WorkQueue>> queues_;
+    std::vector<std::thread> workers_;
+    std::atomic<size_t> next_queue_{0};
+    std::atomic<size_t> pending_{0};
+
+    std::mutex wake_mutex_;
+    std::condition_variable wake_cv_;
+    bool stopping_ = false;
+};
+
+#endif // THREAD_POOL_H
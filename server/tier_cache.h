@@ -0,0 +1,136 @@
+#ifndef TIER_CACHE_H
+#define TIER_CACHE_H
+
+#include <string>
+#include <memory>
+#include <iostream>
+#include <algorithm>
+#include "movie.grpc.pb.h"
+#include "sharded_cache.h"
+#include "server_options.h"
+
+/**
+ * Optional result cache of an interior node (B, C, D).
+ *
+ * It holds the node's whole answer for a canonical query: its local
+ * matches merged with everything from downstream. Empty answers go to a
+ * separate negative cache with their own, usually shorter, TTL, so
+ * repeated no-match queries stop scanning every node below without
+ * pinning results that might appear. Only answers for which every
+ * downstream node replied are stored. Disabled unless --cache-size is
+ * given.
+ */
+class TierCache {
+public:
+    static constexpr long long DEFAULT_TTL = 300;          // Seconds
+    static constexpr long long DEFAULT_NEGATIVE_TTL = 30;  // Seconds
+
+    /**
+     * Create the cache from --cache-size, --cache-ttl and --negative-ttl
+     * @param options Parsed command line
+     * @param tag Log prefix of the server, e.g. "[B]"
+     */
+    static TierCache fromOptions(const ServerOptions& options, const std::string& tag) {
+        TierCache cache;
+        long long size = options.getInt("cache-size", 0);
+        if (size <= 0) {
+            std::cout << tag << " Result cache disabled" << std::endl;
+            return cache;
+        }
+        int ttl = static_cast<int>(std::max(1LL, options.getInt("cache-ttl", DEFAULT_TTL)));
+        int negative_ttl = static_cast<int>(std::max(1LL, options.getInt("negative-ttl", DEFAULT_NEGATIVE_TTL)));
+
+        cache.results_ = std::make_shared<ShardedCache>(ttl, static_cast<size_t>(size));
+        cache.empty_ = std::make_shared<ShardedCache>(negative_ttl, static_cast<size_t>(size));
+        std::cout << tag << " Result cache: " << size << " entries, TTL " << ttl
+                  << " seconds, empty results " << negative_ttl << " seconds" << std::endl;
+        return cache;
+    }
+
+    bool enabled() const {
+        return results_ != nullptr;
+    }
+
+    /**
+     * Look up a query's cached answer
+     * @param key Canonical query
+     * @param response Receives the cached answer (left empty for a negative hit)
+     * @return Whether the answer was cached
+     */
+    bool get(const std::string& key, movie::SearchResponse& response) {
+        if (!enabled()) {
+            return false;
+        }
+        if (results_->get(key, response)) {
+            return true;
+        }
+        return empty_->get(key) != nullptr;
+    }
+
+    /**
+     * Look up a query's cached answer, serialized
+     * @param key Canonical query
+     * @return The cached answer (an empty response for a negative hit), or null
+     */
+    CachedResponsePtr get(const std::string& key) {
+        if (!enabled()) {
+            return nullptr;
+        }
+        CachedResponsePtr cached = results_->get(key);
+        return cached ? cached : empty_->get(key);
+    }
+
+    /**
+     * Store a query's answer
+     * @param key Canonical query
+     * @param response The node's answer
+     * @param complete Whether every downstream node replied; partial answers aren't stored
+     */
+    void put(const std::string& key, const movie::SearchResponse& response, bool complete) {
+        if (!enabled() || !complete) {
+            return;
+        }
+        if (response.results_size() > 0) {
+            results_->put(key, response);
+        } else {
+            empty_->put(key, emptyResponse());
+        }
+    }
+
+    /**
+     * Store a query's serialized answer
+     * @param key Canonical query
+     * @param payload The node's answer
+     * @param complete Whether every downstream node replied; partial answers aren't stored
+     */
+    void put(const std::string& key, CachedResponsePtr payload, bool complete) {
+        if (!enabled() || !complete) {
+            return;
+        }
+        if (payload->size() > 0) {
+            results_->put(key, std::move(payload));
+        } else {
+            empty_->put(key, emptyResponse());
+        }
+    }
+
+    uint64_t hit_count() const {
+        return enabled() ? results_->hit_count() : 0;
+    }
+
+    uint64_t negative_hit_count() const {
+        return enabled() ? empty_->hit_count() : 0;
+    }
+
+private:
+    // One shared payload for every negative entry
+    static CachedResponsePtr emptyResponse() {
+        static const CachedResponsePtr empty = std::make_shared<const CachedResponse>(movie::SearchResponse());
+        return empty;
+    }
+
+    std::shared_ptr<ShardedCache> results_;  // Null when disabled
+    std::shared_ptr<ShardedCache> empty_;
+};
+
+#endif // TIER_CACHE_H
@@ -0,0 +1,199 @@
+#ifndef TRIGRAM_INDEX_H
+#define TRIGRAM_INDEX_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <iterator>
+#include "movie_store.h"
+
+/**
+ * Trigram inverted index over the searched movie fields (title, genres,
+ * overview and keywords). Every distinct 3-byte sequence of the lowercased
+ * fields maps to the sorted list of movies containing it. A substring query
+ * of 3+ bytes can only match movies that contain all of its trigrams, so the
+ * posting lists are intersected to get candidates which are then verified
+ * against the store. Shorter queries fall back to a full scan.
+ *
+ * Postings are stored in compressed-sparse-row form: a sorted key array, an
+ * offset array and one flat array of movie indices.
+ */
+class TrigramIndex {
+public:
+    /**
+     * Memory footprint statistics of the index
+     */
+    struct Stats {
+        size_t documents = 0;   // Number of indexed movies
+        size_t trigrams = 0;    // Number of distinct trigrams
+        size_t postings = 0;    // Total number of (trigram, movie) pairs
+        size_t bytes = 0;       // Bytes held by the index arrays
+    };
+
+    static constexpr size_t MIN_QUERY_LENGTH = 3;
+
+    /**
+     * Build the index over a movie store (replaces any previous contents)
+     * @param movies The node's movies
+     */
+    void build(const MovieStore& movies) {
+        keys_.clear();
+        offsets_.clear();
+        postings_.clear();
+        documents_ = movies.size();
+
+        // Collect (trigram, movie) pairs, unique per movie
+        std::vector<uint64_t> pairs;
+        std::vector<uint32_t> docTrigrams;
+        for (size_t doc = 0; doc < movies.size(); doc++) {
+            docTrigrams.clear();
+            for (int field = 0; field < MovieStore::SEARCH_FIELD_COUNT; field++) {
+                addTrigrams(movies.searchField(static_cast<MovieStore::SearchField>(field), doc), docTrigrams);
+            }
+
+            std::sort(docTrigrams.begin(), docTrigrams.end());
+            docTrigrams.erase(std::unique(docTrigrams.begin(), docTrigrams.end()), docTrigrams.end());
+
+            for (uint32_t trigram : docTrigrams) {
+                pairs.push_back((static_cast<uint64_t>(trigram) << 32) | doc);
+            }
+        }
+
+        // Sorting by (trigram, movie) groups the postings and keeps each list ordered
+        std::sort(pairs.begin(), pairs.end());
+
+        postings_.reserve(pairs.size());
+        for (uint64_t pair : pairs) {
+            uint32_t trigram = static_cast<uint32_t>(pair >> 32);
+            if (keys_.empty() || keys_.back() != trigram) {
+                keys_.push_back(trigram);
+                offsets_.push_back(static_cast<uint32_t>(postings_.size()));
+            }
+            postings_.push_back(static_cast<uint32_t>(pair & 0xFFFFFFFFu));
+        }
+        offsets_.push_back(static_cast<uint32_t>(postings_.size()));
+
+        keys_.shrink();
+        offsets_.shrink();
+    }
+
+    /**
+     * Find candidate movies for a query
+     * @param lowerQuery The lowercased query
+     * @param out Sorted indices of movies that may match (if index was used)
+     * @return Whether the index could be used; false means the caller must scan
+     */
+    bool candidates(std::string_view lowerQuery, std::vector<uint32_t>& out) const {
+        out.clear();
+        if (lowerQuery.size() < MIN_QUERY_LENGTH) {
+            return false;
+        }
+
+        std::vector<uint32_t> queryTrigrams;
+        addTrigrams(lowerQuery, queryTrigrams);
+        std::sort(queryTrigrams.begin(), queryTrigrams.end());
+        queryTrigrams.erase(std::unique(queryTrigrams.begin(), queryTrigrams.end()), queryTrigrams.end());
+
+        // Look up every posting list; a missing trigram means no movie can match
+        std::vector<std::pair<const uint32_t*, const uint32_t*>> lists;
+        lists.reserve(queryTrigrams.size());
+        for (uint32_t trigram : queryTrigrams) {
+            auto it = std::lower_bound(keys_.begin(), keys_.end(), trigram);
+            if (it == keys_.end() || *it != trigram) {
+                return true;
+            }
+            size_t k = static_cast<size_t>(it - keys_.begin());
+            lists.emplace_back(postings_.data() + offsets_[k], postings_.data() + offsets_[k + 1]);
+        }
+
+        // Intersect starting from the shortest list
+        std::sort(lists.begin(), lists.end(), [](const auto& a, const auto& b) {
+            return (a.second - a.first) < (b.second - b.first);
+        });
+
+        out.assign(lists[0].first, lists[0].second);
+        std::vector<uint32_t> next;
+        for (size_t i = 1; i < lists.size() && !out.empty(); i++) {
+            next.clear();
+            std::set_intersection(out.begin(), out.end(),
+                                  lists[i].first, lists[i].second,
+                                  std::back_inserter(next));
+            out.swap(next);
+        }
+        return true;
+    }
+
+    /**
+     * Get memory footprint statistics
+     * @return Index statistics
+     */
+    Stats stats() const {
+        Stats stats;
+        stats.documents = documents_;
+        stats.trigrams = keys_.size();
+        stats.postings = postings_.size();
+        stats.bytes = keys_.bytes() + offsets_.bytes() + postings_.bytes();
+        return stats;
+    }
+
+    /**
+     * Check the CSR structure (used after mapping a snapshot)
+     * @param documents Number of movies in the store the index belongs to
+     * @return Whether the index is consistent
+     */
+    bool valid(size_t documents) const {
+        if (documents_ != documents || offsets_.size() != keys_.size() + 1 ||
+            offsets_.back() != postings_.size() || offsets_[0] != 0) {
+            return false;
+        }
+        for (size_t k = 0; k < keys_.size(); k++) {
+            if ((k > 0 && keys_[k - 1] >= keys_[k]) || offsets_[k] > offsets_[k + 1]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Call visit(...) on every index array and the document count in a
+     * fixed order (the snapshot layout)
+     */
+    template <typename Visitor>
+    void visitColumns(Visitor& visit) {
+        visit(keys_);
+        visit(offsets_);
+        visit(postings_);
+        visit(documents_);
+    }
+
+    template <typename Visitor>
+    void visitColumns(Visitor& visit) const {
+        visit(keys_);
+        visit(offsets_);
+        visit(postings_);
+        visit(documents_);
+    }
+
+private:
+    // Append the trigrams of a lowercased text
+    static void addTrigrams(std::string_view text, std::vector<uint32_t>& out) {
+        if (text.size() < MIN_QUERY_LENGTH) {
+            return;
+        }
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(text.data());
+        for (size_t i = 0; i + 2 < text.size(); i++) {
+            out.push_back((static_cast<uint32_t>(p[i]) << 16) |
+                          (static_cast<uint32_t>(p[i + 1]) << 8) |
+                          static_cast<uint32_t>(p[i + 2]));
+        }
+    }
+
+    ColumnArray<uint32_t> keys_;      // Sorted distinct trigrams
+    ColumnArray<uint32_t> offsets_;   // Start of each trigram's postings (plus end sentinel)
+    ColumnArray<uint32_t> postings_;  // Movie indices, sorted within each trigram
+    uint64_t documents_ = 0;
+};
+
+#endif // TRIGRAM_INDEX_H